@@ -40,6 +40,11 @@ public class Seahorse.AppSettings : GLib.Settings {
         set { set_boolean("server-auto-retrieve", value); }
     }
 
+    public uint server_refresh_days {
+        get { return get_uint("server-refresh-days"); }
+        set { set_uint("server-refresh-days", value); }
+    }
+
     public string server_publish_to {
         owned get { return get_string("server-publish-to"); }
         set {
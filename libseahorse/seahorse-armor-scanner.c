@@ -0,0 +1,367 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "seahorse-armor-scanner.h"
+
+#include <string.h>
+
+/* The minimum amount of bytes we ask from the input stream at once */
+#define READ_CHUNK_SIZE (64 * 1024)
+
+struct _SeahorseArmorScanner {
+    GObject parent;
+
+    GInputStream *input;
+    char *begin_marker;
+    size_t begin_len;
+    char *end_marker;
+    size_t end_len;
+
+    /* The data that has been read, but not yet returned. Blocks are handed
+     * out as slices of this buffer. */
+    GBytes *buffer;
+    size_t offset;
+
+    /* Whether buffer (at offset) starts with a begin marker, and how far
+     * we already looked for the end marker */
+    gboolean in_block;
+    size_t scanned;
+
+    gboolean eof;
+};
+
+G_DEFINE_TYPE (SeahorseArmorScanner, seahorse_armor_scanner, G_TYPE_OBJECT);
+
+static void
+seahorse_armor_scanner_init (SeahorseArmorScanner *self)
+{
+}
+
+static void
+seahorse_armor_scanner_finalize (GObject *obj)
+{
+    SeahorseArmorScanner *self = SEAHORSE_ARMOR_SCANNER (obj);
+
+    g_clear_object (&self->input);
+    g_clear_pointer (&self->buffer, g_bytes_unref);
+    g_free (self->begin_marker);
+    g_free (self->end_marker);
+
+    G_OBJECT_CLASS (seahorse_armor_scanner_parent_class)->finalize (obj);
+}
+
+static void
+seahorse_armor_scanner_class_init (SeahorseArmorScannerClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->finalize = seahorse_armor_scanner_finalize;
+}
+
+/**
+ * seahorse_armor_scanner_new:
+ * @input: The input stream to read from
+ * @begin_marker: The start signature to look for
+ * @end_marker: The end signature to look for
+ *
+ * Returns: (transfer full): A new scanner
+ */
+SeahorseArmorScanner *
+seahorse_armor_scanner_new (GInputStream *input,
+                            const char   *begin_marker,
+                            const char   *end_marker)
+{
+    SeahorseArmorScanner *self;
+
+    g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
+    g_return_val_if_fail (begin_marker && begin_marker[0], NULL);
+    g_return_val_if_fail (end_marker && end_marker[0], NULL);
+
+    self = g_object_new (SEAHORSE_TYPE_ARMOR_SCANNER, NULL);
+    self->input = g_object_ref (input);
+    self->begin_marker = g_strdup (begin_marker);
+    self->begin_len = strlen (begin_marker);
+    self->end_marker = g_strdup (end_marker);
+    self->end_len = strlen (end_marker);
+
+    return self;
+}
+
+/* Like memmem(), but memchr() does the heavy lifting (it is vectorized in
+ * most C libraries), and it's available everywhere */
+static const char *
+find_marker (const char *data,
+             size_t      len,
+             const char *marker,
+             size_t      marker_len)
+{
+    const char *end = data + len;
+
+    while ((size_t) (end - data) >= marker_len) {
+        data = memchr (data, marker[0], (end - data) - marker_len + 1);
+        if (data == NULL)
+            return NULL;
+        if (memcmp (data, marker, marker_len) == 0)
+            return data;
+        data++;
+    }
+
+    return NULL;
+}
+
+/* Returns TRUE if we're done (*block is set, or NULL at the end of the
+ * stream), FALSE if we need more data */
+static gboolean
+scanner_extract (SeahorseArmorScanner *self,
+                 GBytes              **block)
+{
+    const char *data, *pos;
+    size_t size, avail, block_end;
+
+    *block = NULL;
+
+    if (self->buffer == NULL)
+        return self->eof;
+
+    data = g_bytes_get_data (self->buffer, &size);
+
+    /* Look for the beginning */
+    if (!self->in_block) {
+        pos = find_marker (data + self->offset, size - self->offset,
+                           self->begin_marker, self->begin_len);
+
+        if (pos == NULL) {
+            /* Drop everything but what might be the start of a marker */
+            if (size - self->offset >= self->begin_len)
+                self->offset = size - (self->begin_len - 1);
+            return self->eof;
+        }
+
+        self->offset = pos - data;
+        self->in_block = TRUE;
+        self->scanned = self->begin_len;
+    }
+
+    /* Look for the end */
+    avail = size - self->offset;
+    pos = find_marker (data + self->offset + self->scanned, avail - self->scanned,
+                       self->end_marker, self->end_len);
+
+    if (pos == NULL) {
+        /* Don't search the same data again after the next read */
+        if (avail >= self->scanned + self->end_len)
+            self->scanned = avail - (self->end_len - 1);
+
+        if (self->eof) {
+            g_message ("Ignoring truncated block at end of input");
+            self->in_block = FALSE;
+            self->offset = size;
+            return TRUE;
+        }
+
+        return FALSE;
+    }
+
+    block_end = (pos - data) + self->end_len;
+    *block = g_bytes_new_from_bytes (self->buffer, self->offset,
+                                     block_end - self->offset);
+
+    self->offset = block_end;
+    self->in_block = FALSE;
+    self->scanned = 0;
+    return TRUE;
+}
+
+static void
+scanner_append (SeahorseArmorScanner *self,
+                GBytes               *chunk)
+{
+    const char *data;
+    size_t size;
+    GByteArray *array;
+
+    if (g_bytes_get_size (chunk) == 0) {
+        self->eof = TRUE;
+        return;
+    }
+
+    if (self->buffer == NULL ||
+        self->offset == g_bytes_get_size (self->buffer)) {
+        g_clear_pointer (&self->buffer, g_bytes_unref);
+        self->buffer = g_bytes_ref (chunk);
+        self->offset = 0;
+        return;
+    }
+
+    /* Only the unconsumed tail (a partial block) gets copied */
+    data = g_bytes_get_data (self->buffer, &size);
+    array = g_byte_array_sized_new ((size - self->offset) + g_bytes_get_size (chunk));
+    g_byte_array_append (array, (const guint8 *) data + self->offset, size - self->offset);
+    g_byte_array_append (array, g_bytes_get_data (chunk, NULL), g_bytes_get_size (chunk));
+
+    g_bytes_unref (self->buffer);
+    self->buffer = g_byte_array_free_to_bytes (array);
+    self->offset = 0;
+}
+
+static size_t
+scanner_read_size (SeahorseArmorScanner *self)
+{
+    size_t pending = 0;
+
+    /* Grow the reads with the size of the block, so that large blocks
+     * don't get copied over and over again */
+    if (self->buffer != NULL)
+        pending = g_bytes_get_size (self->buffer) - self->offset;
+
+    return MAX (READ_CHUNK_SIZE, pending);
+}
+
+/**
+ * seahorse_armor_scanner_next:
+ * @self: The scanner
+ * @cancellable: (nullable): A #GCancellable
+ * @error: A location to store an error
+ *
+ * Reads the next block from the input, blocking if needed.
+ *
+ * Returns: (transfer full) (nullable): The next block, including the
+ *   markers. %NULL at the end of the input or on error.
+ */
+GBytes *
+seahorse_armor_scanner_next (SeahorseArmorScanner *self,
+                             GCancellable         *cancellable,
+                             GError              **error)
+{
+    GBytes *block;
+
+    g_return_val_if_fail (SEAHORSE_IS_ARMOR_SCANNER (self), NULL);
+    g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+    while (!scanner_extract (self, &block)) {
+        g_autoptr(GBytes) chunk = NULL;
+
+        chunk = g_input_stream_read_bytes (self->input,
+                                           scanner_read_size (self),
+                                           cancellable, error);
+        if (chunk == NULL)
+            return NULL;
+
+        scanner_append (self, chunk);
+    }
+
+    return block;
+}
+
+static void      scanner_read_more        (GTask *task);
+
+static void
+on_scanner_read (GObject      *source,
+                 GAsyncResult *result,
+                 void         *user_data)
+{
+    g_autoptr(GTask) task = G_TASK (user_data);
+    SeahorseArmorScanner *self = g_task_get_source_object (task);
+    g_autoptr(GBytes) chunk = NULL;
+    g_autoptr(GError) error = NULL;
+    GBytes *block;
+
+    chunk = g_input_stream_read_bytes_finish (G_INPUT_STREAM (source), result, &error);
+    if (chunk == NULL) {
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    scanner_append (self, chunk);
+
+    if (scanner_extract (self, &block))
+        g_task_return_pointer (task, block, (GDestroyNotify) g_bytes_unref);
+    else
+        scanner_read_more (task);
+}
+
+static void
+scanner_read_more (GTask *task)
+{
+    SeahorseArmorScanner *self = g_task_get_source_object (task);
+
+    g_input_stream_read_bytes_async (self->input,
+                                     scanner_read_size (self),
+                                     g_task_get_priority (task),
+                                     g_task_get_cancellable (task),
+                                     on_scanner_read,
+                                     g_object_ref (task));
+}
+
+/**
+ * seahorse_armor_scanner_next_async:
+ * @self: The scanner
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: Called when the next block is available
+ * @user_data: Data for @callback
+ *
+ * Asynchronously reads the next block from the input. Only one operation
+ * may be pending at a time.
+ */
+void
+seahorse_armor_scanner_next_async (SeahorseArmorScanner *self,
+                                   GCancellable         *cancellable,
+                                   GAsyncReadyCallback   callback,
+                                   void                 *user_data)
+{
+    g_autoptr(GTask) task = NULL;
+    GBytes *block;
+
+    g_return_if_fail (SEAHORSE_IS_ARMOR_SCANNER (self));
+    g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, seahorse_armor_scanner_next_async);
+
+    /* Maybe we still have a complete block buffered */
+    if (scanner_extract (self, &block)) {
+        g_task_return_pointer (task, block, (GDestroyNotify) g_bytes_unref);
+        return;
+    }
+
+    scanner_read_more (task);
+}
+
+/**
+ * seahorse_armor_scanner_next_finish:
+ * @self: The scanner
+ * @result: The result passed to the callback
+ * @error: A location to store an error
+ *
+ * Returns: (transfer full) (nullable): The next block, including the
+ *   markers. %NULL at the end of the input or on error.
+ */
+GBytes *
+seahorse_armor_scanner_next_finish (SeahorseArmorScanner *self,
+                                    GAsyncResult         *result,
+                                    GError              **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+    g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                          seahorse_armor_scanner_next_async, NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
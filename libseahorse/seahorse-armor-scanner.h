@@ -0,0 +1,59 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SeahorseArmorScanner: Splits a stream into ASCII armored blocks.
+ *
+ * - Reads the input in large chunks instead of byte per byte.
+ * - Each block is returned as a slice of the read buffer (no copying),
+ *   including the begin and end markers.
+ * - Can be iterated synchronously or asynchronously.
+ */
+
+#ifndef __SEAHORSE_ARMOR_SCANNER_H__
+#define __SEAHORSE_ARMOR_SCANNER_H__
+
+#include <gio/gio.h>
+
+#define SEAHORSE_ARMOR_PGP_PUBLIC_KEY_BEGIN   "-----BEGIN PGP PUBLIC KEY BLOCK-----"
+#define SEAHORSE_ARMOR_PGP_PUBLIC_KEY_END     "-----END PGP PUBLIC KEY BLOCK-----"
+
+#define SEAHORSE_TYPE_ARMOR_SCANNER (seahorse_armor_scanner_get_type ())
+G_DECLARE_FINAL_TYPE (SeahorseArmorScanner, seahorse_armor_scanner,
+                      SEAHORSE, ARMOR_SCANNER,
+                      GObject)
+
+SeahorseArmorScanner *  seahorse_armor_scanner_new          (GInputStream *input,
+                                                             const char   *begin_marker,
+                                                             const char   *end_marker);
+
+GBytes *                seahorse_armor_scanner_next         (SeahorseArmorScanner *self,
+                                                             GCancellable         *cancellable,
+                                                             GError              **error);
+
+void                    seahorse_armor_scanner_next_async   (SeahorseArmorScanner *self,
+                                                             GCancellable         *cancellable,
+                                                             GAsyncReadyCallback   callback,
+                                                             void                 *user_data);
+
+GBytes *                seahorse_armor_scanner_next_finish  (SeahorseArmorScanner *self,
+                                                             GAsyncResult         *result,
+                                                             GError              **error);
+
+#endif /* __SEAHORSE_ARMOR_SCANNER_H__ */
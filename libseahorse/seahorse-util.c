@@ -107,61 +107,6 @@ seahorse_util_printf_fd (int fd, const char* fmt, ...)
     return seahorse_util_print_fd (fd, t);
 }
 
-/**
- * seahorse_util_read_data_block:
- * @buf: A string buffer to write the data to.
- * @input: The input stream to read from.
- * @start: The start signature to look for.
- * @end: The end signature to look for.
- *
- * Breaks out one block of data (usually a key)
- *
- * Returns: The number of bytes copied.
- */
-guint
-seahorse_util_read_data_block (GString      *buf,
-                               GInputStream *input,
-                               const char   *start,
-                               const char   *end)
-{
-    const char *t;
-    guint copied = 0;
-    char ch;
-    gsize read;
-
-    /* Look for the beginning */
-    t = start;
-    while (g_input_stream_read_all (input, &ch, 1, &read, NULL, NULL) && read == 1) {
-        /* Match next char */
-        if (*t == ch)
-            t++;
-
-        /* Did we find the whole string? */
-        if (!*t) {
-            buf = g_string_append (buf, start);
-            copied += strlen (start);
-            break;
-        }
-    }
-
-    /* Look for the end */
-    t = end;
-    while (g_input_stream_read_all (input, &ch, 1, &read, NULL, NULL) && read == 1) {
-        /* Match next char */
-        if (*t == ch)
-            t++;
-
-        buf = g_string_append_c (buf, ch);
-        copied++;
-
-        /* Did we find the whole string? */
-        if (!*t)
-            break;
-    }
-
-    return copied;
-}
-
 guint
 seahorse_ulong_hash (gconstpointer v)
 {
@@ -33,11 +33,6 @@
 
 GQuark          seahorse_util_error_domain              (void);
 
-unsigned int    seahorse_util_read_data_block           (GString      *buf,
-                                                         GInputStream *input,
-                                                         const char   *start,
-                                                         const char   *end);
-
 gboolean        seahorse_util_print_fd                  (int         fd,
                                                          const char *data);
 
@@ -0,0 +1,204 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmarks for SeahorseHKPSource against a local HkpTestServer, so they
+ * can run without network access. Run with "meson test --benchmark" or
+ * directly with "-m perf" to use the large data sets.
+ */
+
+#include "seahorse-hkp-source.h"
+#include "seahorse-pgp-key.h"
+
+#include "test-hkp-server.h"
+#include "test-util.h"
+
+#include <glib.h>
+
+typedef struct _HkpBenchFixture {
+    HkpTestServer *server;
+    SeahorseHKPSource *source;
+} HkpBenchFixture;
+
+static unsigned int
+bench_n_keys (void)
+{
+    return g_test_perf () ? 20000 : 2000;
+}
+
+static unsigned int
+bench_n_rounds (void)
+{
+    return g_test_perf () ? 20 : 3;
+}
+
+static void
+hkp_bench_fixture_setup (HkpBenchFixture *fixture,
+                         const void      *user_data)
+{
+    fixture->server = hkp_test_server_new (bench_n_keys ());
+    hkp_test_server_set_latency (fixture->server, GPOINTER_TO_UINT (user_data));
+    fixture->source = seahorse_hkp_source_new (hkp_test_server_get_uri (fixture->server));
+}
+
+static void
+hkp_bench_fixture_teardown (HkpBenchFixture *fixture,
+                            const void      *user_data)
+{
+    g_clear_object (&fixture->source);
+    g_clear_pointer (&fixture->server, hkp_test_server_free);
+}
+
+static void
+bench_hkp_search (HkpBenchFixture *fixture,
+                  const void      *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    unsigned int n_rounds = bench_n_rounds ();
+    double total_ms = 0, total_first_ms = 0, best_ms = G_MAXDOUBLE;
+
+    for (unsigned int i = 0; i < n_rounds; i++) {
+        g_autoptr(GListStore) results = NULL;
+        g_autoptr(GAsyncResult) result = NULL;
+        g_autoptr(GError) error = NULL;
+        int64_t start, end, first_result = 0;
+        double ms;
+
+        results = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+        g_signal_connect (results, "items-changed",
+                          G_CALLBACK (test_util_on_first_result), &first_result);
+
+        start = g_get_monotonic_time ();
+        seahorse_server_source_search_async (source, "Test User", results, NULL,
+                                             test_util_async_ready, &result);
+        seahorse_server_source_search_finish (source, test_util_wait_for_result (&result), &error);
+        end = g_get_monotonic_time ();
+        g_assert_no_error (error);
+        g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (results)), ==,
+                          hkp_test_server_get_n_keys (fixture->server));
+
+        ms = (end - start) / 1000.0;
+        total_ms += ms;
+        best_ms = MIN (best_ms, ms);
+        total_first_ms += (first_result - start) / 1000.0;
+    }
+
+    g_test_minimized_result (best_ms, "search %u keys: best %.2f ms",
+                             hkp_test_server_get_n_keys (fixture->server), best_ms);
+    g_test_message ("search %u keys: mean %.2f ms, first result after %.2f ms",
+                    hkp_test_server_get_n_keys (fixture->server),
+                    total_ms / n_rounds, total_first_ms / n_rounds);
+    g_test_message ("peak RSS: %.1f MiB", test_util_peak_rss_mib ());
+}
+
+static void
+bench_hkp_bulk_get (HkpBenchFixture *fixture,
+                    const void      *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    unsigned int n_keyids = g_test_perf () ? 1000 : 100;
+    g_autofree const char **keyids = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    int64_t start, end;
+    double seconds;
+
+    keyids = g_new0 (const char *, n_keyids + 1);
+    for (unsigned int i = 0; i < n_keyids; i++)
+        keyids[i] = hkp_test_server_get_keyid (fixture->server, i);
+
+    start = g_get_monotonic_time ();
+    seahorse_server_source_export_async (source, keyids, NULL, test_util_async_ready, &result);
+    bytes = seahorse_server_source_export_finish (source, test_util_wait_for_result (&result), &error);
+    end = g_get_monotonic_time ();
+    g_assert_no_error (error);
+    g_assert_nonnull (bytes);
+
+    seconds = (end - start) / (double) G_USEC_PER_SEC;
+    g_test_maximized_result (n_keyids / seconds, "bulk get: %.1f keys/s", n_keyids / seconds);
+    g_test_message ("bulk get %u keys: %.2f ms, %.2f MiB/s",
+                    n_keyids, seconds * 1000,
+                    g_bytes_get_size (bytes) / seconds / (1024 * 1024));
+    g_test_message ("peak RSS: %.1f MiB", test_util_peak_rss_mib ());
+}
+
+static void
+bench_hkp_parse_index (void)
+{
+    unsigned int n_entries = 100000;
+    GString *response;
+    g_autoptr(GBytes) bytes = NULL;
+    unsigned int n_rounds = bench_n_rounds ();
+    double best_ms = G_MAXDOUBLE;
+
+    response = g_string_sized_new (n_entries * 110);
+    g_string_append_printf (response, "info:1:%u\n", n_entries);
+    for (unsigned int i = 0; i < n_entries; i++) {
+        g_string_append_printf (response, "pub:%08X%032X:1:4096:1609459200::\r\n", i, i);
+        g_string_append_printf (response, "uid:Test%%20User%%20%u%%20%%3Cuser%u@example.org%%3E:1609459200::\r\n", i, i);
+    }
+    bytes = g_string_free_to_bytes (response);
+
+    for (unsigned int i = 0; i < n_rounds; i++) {
+        GList *keys;
+        int64_t start, end;
+
+        start = g_get_monotonic_time ();
+        keys = seahorse_hkp_parse_lookup_response_bytes (bytes);
+        end = g_get_monotonic_time ();
+
+        g_assert_cmpuint (g_list_length (keys), ==, n_entries);
+        g_list_free_full (keys, g_object_unref);
+
+        best_ms = MIN (best_ms, (end - start) / 1000.0);
+    }
+
+    g_test_minimized_result (best_ms, "parse %u index entries: best %.2f ms",
+                             n_entries, best_ms);
+    g_test_message ("parse %u index entries (%.1f MiB): %.0f entries/s",
+                    n_entries, g_bytes_get_size (bytes) / (1024.0 * 1024.0),
+                    n_entries / (best_ms / 1000.0));
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/hkp/bench/parse-index", bench_hkp_parse_index);
+    g_test_add ("/hkp/bench/search", HkpBenchFixture, GUINT_TO_POINTER (0),
+                hkp_bench_fixture_setup,
+                bench_hkp_search,
+                hkp_bench_fixture_teardown);
+    g_test_add ("/hkp/bench/search-latency", HkpBenchFixture, GUINT_TO_POINTER (50),
+                hkp_bench_fixture_setup,
+                bench_hkp_search,
+                hkp_bench_fixture_teardown);
+    g_test_add ("/hkp/bench/bulk-get", HkpBenchFixture, GUINT_TO_POINTER (0),
+                hkp_bench_fixture_setup,
+                bench_hkp_bulk_get,
+                hkp_bench_fixture_teardown);
+    g_test_add ("/hkp/bench/bulk-get-latency", HkpBenchFixture, GUINT_TO_POINTER (50),
+                hkp_bench_fixture_setup,
+                bench_hkp_bulk_get,
+                hkp_bench_fixture_teardown);
+
+    return g_test_run ();
+}
@@ -0,0 +1,169 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmarks for SeahorseLDAPSource against a local LdapTestServer, so they
+ * can run without network access. Run with "meson test --benchmark" or
+ * directly with "-m perf" to use the large data sets.
+ */
+
+#include "seahorse-ldap-source.h"
+#include "seahorse-pgp-key.h"
+
+#include "test-ldap-server.h"
+#include "test-util.h"
+
+#include <glib.h>
+
+typedef struct _LdapBenchFixture {
+    LdapTestServer *server;
+    SeahorseLDAPSource *source;
+} LdapBenchFixture;
+
+static unsigned int
+bench_n_keys (void)
+{
+    return g_test_perf () ? 20000 : 2000;
+}
+
+static unsigned int
+bench_n_rounds (void)
+{
+    return g_test_perf () ? 20 : 3;
+}
+
+static void
+ldap_bench_fixture_setup (LdapBenchFixture *fixture,
+                          const void       *user_data)
+{
+    fixture->server = ldap_test_server_new (bench_n_keys ());
+    ldap_test_server_set_latency (fixture->server, GPOINTER_TO_UINT (user_data));
+    fixture->source = seahorse_ldap_source_new (ldap_test_server_get_uri (fixture->server));
+}
+
+static void
+ldap_bench_fixture_teardown (LdapBenchFixture *fixture,
+                             const void       *user_data)
+{
+    g_clear_object (&fixture->source);
+    g_clear_pointer (&fixture->server, ldap_test_server_free);
+}
+
+static void
+bench_ldap_search (LdapBenchFixture *fixture,
+                   const void       *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    unsigned int n_rounds = bench_n_rounds ();
+    double total_ms = 0, total_first_ms = 0, best_ms = G_MAXDOUBLE;
+
+    for (unsigned int i = 0; i < n_rounds; i++) {
+        g_autoptr(GListStore) results = NULL;
+        g_autoptr(GAsyncResult) result = NULL;
+        g_autoptr(GError) error = NULL;
+        int64_t start, end, first_result = 0;
+        double ms;
+
+        results = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+        g_signal_connect (results, "items-changed",
+                          G_CALLBACK (test_util_on_first_result), &first_result);
+
+        start = g_get_monotonic_time ();
+        seahorse_server_source_search_async (source, "Test User", results, NULL,
+                                             test_util_async_ready, &result);
+        seahorse_server_source_search_finish (source, test_util_wait_for_result (&result), &error);
+        end = g_get_monotonic_time ();
+        g_assert_no_error (error);
+        g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (results)), ==,
+                          ldap_test_server_get_n_keys (fixture->server));
+
+        ms = (end - start) / 1000.0;
+        total_ms += ms;
+        best_ms = MIN (best_ms, ms);
+        total_first_ms += (first_result - start) / 1000.0;
+    }
+
+    g_test_minimized_result (best_ms, "search %u keys: best %.2f ms",
+                             ldap_test_server_get_n_keys (fixture->server), best_ms);
+    g_test_message ("search %u keys: mean %.2f ms, first result after %.2f ms",
+                    ldap_test_server_get_n_keys (fixture->server),
+                    total_ms / n_rounds, total_first_ms / n_rounds);
+    g_test_message ("%u binds, %u searches, peak RSS: %.1f MiB",
+                    ldap_test_server_get_n_binds (fixture->server),
+                    ldap_test_server_get_n_searches (fixture->server),
+                    test_util_peak_rss_mib ());
+}
+
+static void
+bench_ldap_bulk_get (LdapBenchFixture *fixture,
+                     const void       *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    unsigned int n_keyids = g_test_perf () ? 1000 : 100;
+    g_autofree const char **keyids = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    int64_t start, end;
+    double seconds;
+
+    keyids = g_new0 (const char *, n_keyids + 1);
+    for (unsigned int i = 0; i < n_keyids; i++)
+        keyids[i] = ldap_test_server_get_keyid (fixture->server, i);
+
+    start = g_get_monotonic_time ();
+    seahorse_server_source_export_async (source, keyids, NULL, test_util_async_ready, &result);
+    bytes = seahorse_server_source_export_finish (source, test_util_wait_for_result (&result), &error);
+    end = g_get_monotonic_time ();
+    g_assert_no_error (error);
+    g_assert_nonnull (bytes);
+
+    seconds = (end - start) / (double) G_USEC_PER_SEC;
+    g_test_maximized_result (n_keyids / seconds, "bulk get: %.1f keys/s", n_keyids / seconds);
+    g_test_message ("bulk get %u keys: %.2f ms, %.2f MiB/s, %u searches",
+                    n_keyids, seconds * 1000,
+                    g_bytes_get_size (bytes) / seconds / (1024 * 1024),
+                    ldap_test_server_get_n_searches (fixture->server));
+    g_test_message ("peak RSS: %.1f MiB", test_util_peak_rss_mib ());
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/ldap/bench/search", LdapBenchFixture, GUINT_TO_POINTER (0),
+                ldap_bench_fixture_setup,
+                bench_ldap_search,
+                ldap_bench_fixture_teardown);
+    g_test_add ("/ldap/bench/search-latency", LdapBenchFixture, GUINT_TO_POINTER (50),
+                ldap_bench_fixture_setup,
+                bench_ldap_search,
+                ldap_bench_fixture_teardown);
+    g_test_add ("/ldap/bench/bulk-get", LdapBenchFixture, GUINT_TO_POINTER (0),
+                ldap_bench_fixture_setup,
+                bench_ldap_bulk_get,
+                ldap_bench_fixture_teardown);
+    g_test_add ("/ldap/bench/bulk-get-latency", LdapBenchFixture, GUINT_TO_POINTER (50),
+                ldap_bench_fixture_setup,
+                bench_ldap_bulk_get,
+                ldap_bench_fixture_teardown);
+
+    return g_test_run ();
+}
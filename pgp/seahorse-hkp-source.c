@@ -33,6 +33,7 @@
 
 #include "seahorse-common.h"
 
+#include "libseahorse/seahorse-armor-scanner.h"
 #include "libseahorse/seahorse-progress.h"
 #include "libseahorse/seahorse-util.h"
 
@@ -199,6 +200,81 @@ dehtmlize (char *line)
     }
 }
 
+/* A column of an HKP index line, pointing into the response buffer */
+typedef struct {
+    const char *data;
+    size_t len;
+} HkpField;
+
+/* pub:<keyid>:<algo>:<keylen>:<creationdate>:<expirationdate>:<flags> */
+#define HKP_MAX_FIELDS 7
+
+static gboolean
+hkp_field_has_prefix (const HkpField *field,
+                      const char     *prefix)
+{
+    size_t len = strlen (prefix);
+    return field->len >= len && g_ascii_strncasecmp (field->data, prefix, len) == 0;
+}
+
+static long
+hkp_field_to_long (const HkpField *field)
+{
+    long value = 0;
+    size_t i = 0;
+    gboolean negative = FALSE;
+
+    if (field->len > 0 && field->data[0] == '-') {
+        negative = TRUE;
+        i++;
+    }
+
+    for (; i < field->len && g_ascii_isdigit (field->data[i]); i++) {
+        if (value > (G_MAXLONG - 9) / 10)
+            break;
+        value = value * 10 + (field->data[i] - '0');
+    }
+
+    return negative ? -value : value;
+}
+
+/**
+ * hkp_split_fields:
+ * @line: The start of the line
+ * @len: The length of the line, without the line terminator
+ * @fields: (out caller-allocates): The columns of the line
+ *
+ * Splits an HKP index line on ':' without copying, the same way as
+ * g_strsplit_set (line, ":", HKP_MAX_FIELDS) would: the last column
+ * contains the remainder of the line.
+ *
+ * Returns: The amount of columns
+ */
+static unsigned int
+hkp_split_fields (const char *line,
+                  size_t      len,
+                  HkpField   *fields)
+{
+    const char *end = line + len;
+    unsigned int n_fields = 0;
+
+    while (n_fields < HKP_MAX_FIELDS - 1) {
+        const char *colon = memchr (line, ':', end - line);
+
+        if (colon == NULL)
+            break;
+
+        fields[n_fields].data = line;
+        fields[n_fields].len = colon - line;
+        n_fields++;
+        line = colon + 1;
+    }
+
+    fields[n_fields].data = line;
+    fields[n_fields].len = end - line;
+    return n_fields + 1;
+}
+
 /**
 * flags: combintation of [rei] representing the key's status
 *
@@ -207,14 +283,12 @@ dehtmlize (char *line)
 * returns 0 on error or a combination of seahorse flags based on input
 **/
 static guint
-parse_hkp_flags (char *flags)
+parse_hkp_flags (const HkpField *flags)
 {
-    char flag = 0;
-
-    g_return_val_if_fail (flags, 0);
+    guint flag = 0;
 
-    for (char *f = flags; *f; f++){
-        switch (*f){
+    for (size_t i = 0; i < flags->len; i++) {
+        switch (flags->data[i]) {
             case 'r':
                 flag |= SEAHORSE_FLAG_REVOKED;
                 break;
@@ -229,155 +303,165 @@ parse_hkp_flags (char *flags)
     return flag;
 }
 
+static SeahorsePgpKey *
+parse_hkp_pub_line (const HkpField *columns,
+                    unsigned int    n_columns)
+{
+    SeahorsePgpKey *key;
+    g_autofree char *fpr = NULL;
+    g_autofree char *fingerprint = NULL;
+    const char *algo = NULL;
+    g_autoptr (SeahorsePgpSubkey) subkey = NULL;
+    long created, expired;
+    g_autoptr(GDateTime) created_date = NULL;
+    g_autoptr(GDateTime) expired_date = NULL;
+    SeahorseFlags flags = 0;
+
+    /* Check out the key type */
+    switch (hkp_field_to_long (&columns[2])) {
+        case 1:
+        case 2:
+        case 3:
+            algo = "RSA";
+            break;
+        case 17:
+            algo = "DSA";
+            break;
+        default:
+            break;
+    }
+
+    /* set dates */
+    created = hkp_field_to_long (&columns[4]);
+    if (created > 0)
+        created_date = g_date_time_new_from_unix_utc (created);
+
+    /* expires (optional) */
+    if (n_columns > 5) {
+        expired = hkp_field_to_long (&columns[5]);
+        if (expired > 0)
+            expired_date = g_date_time_new_from_unix_utc (expired);
+    }
+
+    /* set flags (optional) */
+    if (n_columns > 6)
+        flags |= parse_hkp_flags (&columns[6]);
+
+    /* create key */
+    key = seahorse_pgp_key_new ();
+    seahorse_pgp_key_set_item_flags (key, flags);
+
+    /* Add all the info to the key */
+    fpr = g_strndup (columns[1].data, columns[1].len);
+    subkey = seahorse_pgp_subkey_new ();
+    seahorse_pgp_subkey_set_keyid (subkey, fpr);
+
+    fingerprint = seahorse_pgp_subkey_calc_fingerprint (fpr);
+    seahorse_pgp_subkey_set_fingerprint (subkey, fingerprint);
+
+    seahorse_pgp_subkey_set_flags (subkey, flags);
+    seahorse_pgp_subkey_set_created (subkey, created_date);
+    seahorse_pgp_subkey_set_expires (subkey, expired_date);
+    seahorse_pgp_subkey_set_length (subkey, hkp_field_to_long (&columns[3]));
+    if (algo)
+        seahorse_pgp_subkey_set_algorithm (subkey, algo);
+    seahorse_pgp_key_add_subkey (key, subkey);
+
+    return key;
+}
+
 /**
- * parse_hkp_index:
- * response: The HKP server response to parse
+ * seahorse_hkp_parse_lookup_response_bytes:
+ * @response: The HKP server response to parse
  *
- * Extracts the key data from the HKP server response
+ * Extracts the key data from the HKP server response. The buffer is walked
+ * in place; memory is only allocated for the resulting keys.
  *
  * Returns: (transfer full): The parsed list of keys
  */
 GList *
-seahorse_hkp_parse_lookup_response (const char *response)
+seahorse_hkp_parse_lookup_response_bytes (GBytes *response)
 {
     /* Use The OpenPGP HTTP Keyserver Protocol (HKP) to search and get keys
      * https://tools.ietf.org/html/draft-shaw-openpgp-hkp-00#section-5 */
-    g_auto(GStrv) lines = NULL;
     SeahorsePgpKey *key = NULL;
     GList *keys = NULL;
     guint key_total = 0, key_count = 0;
+    const char *line, *end;
+    size_t size;
 
-    lines = g_strsplit (response, "\n", 0);
-    for (char **l = lines; *l; l++) {
-        char *line = *l;
-        g_auto(GStrv) columns = NULL;
+    g_return_val_if_fail (response != NULL, NULL);
+
+    line = g_bytes_get_data (response, &size);
+    end = line + size;
+
+    while (line < end) {
+        const char *eol;
+        size_t len;
+        HkpField columns[HKP_MAX_FIELDS];
+        unsigned int n_columns;
+
+        eol = memchr (line, '\n', end - line);
+        if (eol == NULL)
+            eol = end;
 
-        if (!*line) {
-          g_debug ("HKP Parser: skip empty line");
-          continue;
+        /* HKP servers may use \r\n as line endings */
+        len = eol - line;
+        if (len > 0 && line[len - 1] == '\r')
+            len--;
+
+        if (len == 0) {
+            line = eol + 1;
+            continue;
         }
 
-        g_debug ("%s", line);
+        g_debug ("%.*s", (int) len, line);
 
         /* split the line using hkp delimiter */
-        columns = g_strsplit_set (line, ":", 7);
+        n_columns = hkp_split_fields (line, len, columns);
 
         /* info header */
         /* info:<version>:<count> */
-        if (g_ascii_strncasecmp (columns[0], "info", 4) == 0) {
-            if (!columns[1] && !columns[2]){
-                g_debug("HKP Parse: Invalid info line: %s", line);
-            } else {
-                key_total = strtol(columns[2], NULL, 10);
-            }
+        if (hkp_field_has_prefix (&columns[0], "info")) {
+            if (n_columns < 3)
+                g_debug ("HKP Parse: Invalid info line: %.*s", (int) len, line);
+            else
+                key_total = hkp_field_to_long (&columns[2]);
 
         /* start a new key */
-        /* pub:<keyid>:<algo>:<keylen>:<creationdate>:<expirationdate>:<flags> */
-        } else if (g_ascii_strncasecmp (columns[0], "pub", 3) == 0) {
-            const char *fpr;
-            g_autofree char *fingerprint = NULL;
-            const char *algo = NULL;
-            g_autoptr (SeahorsePgpSubkey) subkey = NULL;
-            long created = 0, expired = 0;
-            g_autoptr(GDateTime) created_date = NULL;
-            g_autoptr(GDateTime) expired_date = NULL;
-            SeahorseFlags flags;
-
+        } else if (hkp_field_has_prefix (&columns[0], "pub")) {
             key_count++;
 
-            if (!columns[0] || !columns[1] || !columns[2] || !columns[3] || !columns[4]) {
-                g_message ("Invalid key line from server: %s", line);
+            if (n_columns < 5) {
+                g_message ("Invalid key line from server: %.*s", (int) len, line);
+                line = eol + 1;
                 continue;
             }
 
-            /* Cut the length and fingerprint */
-            fpr = columns[1];
-            if (fpr == NULL)
-                g_message ("couldn't find key fingerprint in line from server: %s", line);
-
-            /* Check out the key type */
-            switch (strtol(columns[2], NULL, 10)) {
-                case 1:
-                case 2:
-                case 3:
-                     algo = "RSA";
-                    break;
-                case 17:
-                    algo = "DSA";
-                    break;
-                default:
-                   break;
-            }
-            g_debug ("Algo: %s", algo);
-
-            /* set dates */
-            /* created */
-            if (!columns[4]) {
-                g_debug ("HKP Parse: No created date for key on line: %s", line);
-            } else {
-                created = strtol (columns[4], NULL, 10);
-                if (created > 0)
-                    created_date = g_date_time_new_from_unix_utc (created);
-            }
-
-            /* expires (optional) */
-            if (columns[5]) {
-                expired = strtol (columns[5], NULL, 10);
-                if (expired > 0)
-                    expired_date = g_date_time_new_from_unix_utc (expired);
-            }
-
-            /* set flags (optional) */
-            flags = 0;
-            if (columns[6])
-                flags |= parse_hkp_flags (columns[6]);
-
-            /* create key */
-            g_debug("HKP Parse: found new key");
-            key = seahorse_pgp_key_new ();
-            seahorse_pgp_key_set_item_flags (key, flags);
-
-            /* Add all the info to the key */
-            subkey = seahorse_pgp_subkey_new ();
-            seahorse_pgp_subkey_set_keyid (subkey, fpr);
-
-            fingerprint = seahorse_pgp_subkey_calc_fingerprint (fpr);
-            seahorse_pgp_subkey_set_fingerprint (subkey, fingerprint);
-
-            seahorse_pgp_subkey_set_flags (subkey, flags);
-            seahorse_pgp_subkey_set_created (subkey, created_date);
-            seahorse_pgp_subkey_set_expires (subkey, expired_date);
-            seahorse_pgp_subkey_set_length (subkey, strtol (columns[3], NULL, 10));
-            if (algo)
-                seahorse_pgp_subkey_set_algorithm (subkey, algo);
-            seahorse_pgp_key_add_subkey (key, subkey);
-
-            /* Now add it to the list */
+            key = parse_hkp_pub_line (columns, n_columns);
             keys = g_list_prepend (keys, key);
 
         /* A UID for the key */
-        } else if (g_ascii_strncasecmp (columns[0], "uid", 3) == 0) {
+        } else if (hkp_field_has_prefix (&columns[0], "uid")) {
             g_autoptr (SeahorsePgpUid) uid = NULL;
             g_autofree char *uid_string = NULL;
 
             if (!key) {
-                g_debug("HKP Parse: Warning: seen uid line before keyline, skipping");
-                continue;
-            }
-
-            g_debug("HKP Parse: handle uid");
+                g_debug ("HKP Parse: Warning: seen uid line before keyline, skipping");
+            } else if (n_columns < 3) {
+                g_message ("HKP Parse: Invalid uid line from server: %.*s", (int) len, line);
+            } else {
+                uid_string = g_uri_unescape_segment (columns[1].data,
+                                                     columns[1].data + columns[1].len,
+                                                     NULL);
+                g_debug ("HKP Parse: decoded uid string: %s", uid_string);
 
-            if (!columns[0] || !columns[1] || !columns[2]) {
-                g_message ("HKP Parse: Invalid uid line from server: %s", line);
-                continue;
+                uid = seahorse_pgp_uid_new (key, uid_string);
+                seahorse_pgp_key_add_uid (key, uid);
             }
-
-            uid_string = g_uri_unescape_string (columns[1], NULL);
-            g_debug("HKP Parse: decoded uid string: %s", uid_string);
-
-            uid = seahorse_pgp_uid_new (key, uid_string);
-            seahorse_pgp_key_add_uid (key, uid);
         }
+
+        line = eol + 1;
     }
 
     if (key_total != 0 && key_total != key_count) {
@@ -389,6 +473,25 @@ seahorse_hkp_parse_lookup_response (const char *response)
     return keys;
 }
 
+/**
+ * seahorse_hkp_parse_lookup_response:
+ * @response: The HKP server response to parse
+ *
+ * Extracts the key data from a NUL-terminated HKP server response.
+ *
+ * Returns: (transfer full): The parsed list of keys
+ */
+GList *
+seahorse_hkp_parse_lookup_response (const char *response)
+{
+    g_autoptr(GBytes) bytes = NULL;
+
+    g_return_val_if_fail (response != NULL, NULL);
+
+    bytes = g_bytes_new_static (response, strlen (response));
+    return seahorse_hkp_parse_lookup_response_bytes (bytes);
+}
+
 /**
 * response: The server response
 *
@@ -462,6 +565,32 @@ detect_key (const char *text, int len, const char **start, const char **end)
     return TRUE;
 }
 
+/**
+ * check_message_status:
+ * @message: A finished message
+ * @error: Returned, the error if the server reported failure
+ *
+ * Keyservers answer with a 404 when nothing matched the query, which we
+ * treat as an empty (successful) result.
+ *
+ * Returns: FALSE if the server reported an error, TRUE else
+ */
+static gboolean
+check_message_status (SoupMessage *message,
+                      GError     **error)
+{
+    unsigned int status;
+
+    status = soup_message_get_status (message);
+    if (SOUP_STATUS_IS_SUCCESSFUL (status) || status == SOUP_STATUS_NOT_FOUND)
+        return TRUE;
+
+    g_set_error (error, HKP_ERROR_DOMAIN, status,
+                 _("Keyserver returned an error: %s"),
+                 soup_message_get_reason_phrase (message));
+    return FALSE;
+}
+
 static void
 on_session_cancelled (GCancellable *cancellable,
                      void *user_data)
@@ -474,7 +603,6 @@ typedef struct {
     SeahorseHKPSource *source;
     SoupSession *session;
     SoupMessage *message;
-    GString *response;
     int requests;
     GListStore *results;
 } SearchClosure;
@@ -485,8 +613,6 @@ source_search_free (void *data)
     SearchClosure *closure = data;
     g_clear_object (&closure->source);
     g_clear_object (&closure->message);
-    if (closure->response != NULL)
-        g_string_free (closure->response, TRUE);
     g_clear_object (&closure->session);
     g_clear_object (&closure->results);
     g_free (closure);
@@ -508,14 +634,12 @@ on_search_message_complete (GObject *object,
     seahorse_progress_end (cancellable, closure->message);
 
     response = soup_session_send_and_read_finish (session, result, &error);
-    if (response == NULL) {
+    if (response == NULL || !check_message_status (closure->message, &error)) {
         g_task_return_error (task, g_steal_pointer (&error));
         return;
     }
 
-    closure->response = g_string_new_len (g_bytes_get_data (response, NULL),
-                                          g_bytes_get_size (response));
-    keys = seahorse_hkp_parse_lookup_response (closure->response->str);
+    keys = seahorse_hkp_parse_lookup_response_bytes (response);
     for (GList *l = keys; l; l = g_list_next (l)) {
         g_object_set (l->data, "place", closure->source, NULL);
         g_list_store_append (closure->results, l->data);
@@ -613,10 +737,11 @@ seahorse_hkp_source_search_finish (SeahorseServerSource *source,
 
 typedef struct {
     SeahorseHKPSource *source;
-    GInputStream *input;
+    SeahorseArmorScanner *scanner;
     SoupSession *session;
-    SoupMessage *message;
+    GUri *uri;
     int requests;
+    gboolean read_done;
 } ImportClosure;
 
 static void
@@ -624,12 +749,24 @@ source_import_free (void *data)
 {
     ImportClosure *closure = data;
     g_object_unref (closure->source);
-    g_object_unref (closure->input);
-    g_object_unref (closure->message);
+    g_object_unref (closure->scanner);
     g_object_unref (closure->session);
+    g_clear_pointer (&closure->uri, g_uri_unref);
     g_free (closure);
 }
 
+static void
+import_complete_if_done (GTask *task)
+{
+    ImportClosure *closure = g_task_get_task_data (task);
+
+    /* A successful status from the server is all we want in this case */
+    if (closure->read_done && closure->requests == 0) {
+        /* We don't know which keys got imported, so just return NULL */
+        g_task_return_pointer (task, NULL, NULL);
+    }
+}
+
 static void
 on_import_message_complete (GObject *object,
                             GAsyncResult *result,
@@ -639,16 +776,19 @@ on_import_message_complete (GObject *object,
     g_autoptr(GTask) task = G_TASK (user_data);
     ImportClosure *closure = g_task_get_task_data (task);
     GCancellable *cancellable = g_task_get_cancellable (task);
+    SoupMessage *message = soup_session_get_async_result_message (session, result);
     g_autoptr(GBytes) response = NULL;
     g_autoptr(GString) response_str = NULL;
     g_autoptr(GError) error = NULL;
     g_autofree char *errmsg = NULL;
 
     g_assert (closure->requests > 0);
-    seahorse_progress_end (cancellable, GUINT_TO_POINTER (closure->requests));
+    seahorse_progress_end (cancellable, message);
     closure->requests--;
 
     response = soup_session_send_and_read_finish (session, result, &error);
+    if (g_task_had_error (task))
+        return;
     if (!response) {
         g_task_return_error (task, g_steal_pointer (&error));
         return;
@@ -658,16 +798,76 @@ on_import_message_complete (GObject *object,
                                      g_bytes_get_size (response));
     if ((errmsg = get_send_result (response_str->str)) != NULL) {
         g_task_return_new_error (task, HKP_ERROR_DOMAIN,
-                                 soup_message_get_status (closure->message),
+                                 soup_message_get_status (message),
                                  "%s", errmsg);
         return;
     }
 
-    /* A successful status from the server is all we want in this case */
-    if (closure->requests == 0) {
-        /* We don't know which keys got imported, so just return NULL */
-        g_task_return_pointer (task, NULL, NULL);
+    import_complete_if_done (task);
+}
+
+static void
+import_send_block (GTask  *task,
+                   GBytes *block)
+{
+    ImportClosure *closure = g_task_get_task_data (task);
+    GCancellable *cancellable = g_task_get_cancellable (task);
+    g_autoptr(SoupMessage) message = NULL;
+    g_autofree char *keytext = NULL;
+    char *key;
+    g_autoptr(GBytes) bytes = NULL;
+
+    message = soup_message_new_from_uri ("POST", closure->uri);
+
+    keytext = g_strndup (g_bytes_get_data (block, NULL), g_bytes_get_size (block));
+    key = soup_form_encode ("keytext", keytext, NULL);
+    bytes = g_bytes_new_take (key, strlen (key));
+    soup_message_set_request_body_from_bytes (message,
+                                              "application/x-www-form-urlencoded",
+                                              bytes);
+
+    closure->requests++;
+    seahorse_progress_prep_and_begin (cancellable, message, NULL);
+
+    soup_session_send_and_read_async (closure->session,
+                                      message,
+                                      G_PRIORITY_DEFAULT,
+                                      cancellable,
+                                      on_import_message_complete,
+                                      g_object_ref (task));
+}
+
+static void
+on_import_block_read (GObject      *object,
+                      GAsyncResult *result,
+                      void         *user_data)
+{
+    SeahorseArmorScanner *scanner = SEAHORSE_ARMOR_SCANNER (object);
+    g_autoptr(GTask) task = G_TASK (user_data);
+    ImportClosure *closure = g_task_get_task_data (task);
+    g_autoptr(GBytes) block = NULL;
+    g_autoptr(GError) error = NULL;
+
+    block = seahorse_armor_scanner_next_finish (scanner, result, &error);
+    if (g_task_had_error (task))
+        return;
+    if (error != NULL) {
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    if (block == NULL) {
+        closure->read_done = TRUE;
+        import_complete_if_done (task);
+        return;
     }
+
+    /* Send off each key as soon as we have it, while reading the next */
+    import_send_block (task, block);
+    seahorse_armor_scanner_next_async (scanner,
+                                       g_task_get_cancellable (task),
+                                       on_import_block_read,
+                                       g_steal_pointer (&task));
 }
 
 static void
@@ -680,67 +880,28 @@ seahorse_hkp_source_import_async (SeahorseServerSource *source,
     SeahorseHKPSource *self = SEAHORSE_HKP_SOURCE (source);
     g_autoptr(GTask) task = NULL;
     ImportClosure *closure;
-    g_autoptr(GPtrArray) keydata = NULL;
-    g_autoptr(GUri) uri = NULL;
 
     task = g_task_new (source, cancellable, callback, user_data);
     closure = g_new0 (ImportClosure, 1);
-    closure->input = g_object_ref (input);
+    closure->scanner = seahorse_armor_scanner_new (input,
+                                                   SEAHORSE_ARMOR_PGP_PUBLIC_KEY_BEGIN,
+                                                   SEAHORSE_ARMOR_PGP_PUBLIC_KEY_END);
     closure->source = g_object_ref (self);
     closure->session = create_hkp_soup_session ();
     g_task_set_task_data (task, closure, source_import_free);
 
-    keydata = g_ptr_array_new_with_free_func (g_free);
-    for (;;) {
-        g_autoptr(GString) buf = g_string_sized_new (2048);
-        guint len;
-
-        len = seahorse_util_read_data_block (buf, input,
-                                             "-----BEGIN PGP PUBLIC KEY BLOCK-----",
-                                             "-----END PGP PUBLIC KEY BLOCK-----");
-        if (len <= 0)
-            break;
-
-        g_ptr_array_add (keydata, g_string_free (g_steal_pointer (&buf), FALSE));
-    }
-
-    if (keydata->len == 0) {
-        g_task_return_pointer (task, NULL, NULL);
-        return;
-    }
-
     /* Figure out the URI we're sending to */
-    uri = get_http_server_uri (self, "/pks/add", NULL);
-    g_return_if_fail (uri);
-
-    for (unsigned int i = 0; i < keydata->len; i++) {
-        const char *keytext = g_ptr_array_index (keydata, i);
-        g_autofree char *key = NULL;
-        g_autoptr(GBytes) bytes = NULL;
-
-        closure->message = soup_message_new_from_uri ("POST", uri);
-
-        key = soup_form_encode ("keytext", keytext, NULL);
-        bytes = g_bytes_new_static (key, strlen (key));
-        soup_message_set_request_body_from_bytes (closure->message,
-                                                  "application/x-www-form-urlencoded",
-                                                  bytes);
-
-        soup_session_send_and_read_async (closure->session,
-                                          closure->message,
-                                          G_PRIORITY_DEFAULT,
-                                          cancellable,
-                                          on_import_message_complete,
-                                          g_steal_pointer (&task));
-
-        closure->requests++;
-        seahorse_progress_prep_and_begin (cancellable, GUINT_TO_POINTER (closure->requests), NULL);
-    }
+    closure->uri = get_http_server_uri (self, "/pks/add", NULL);
+    g_return_if_fail (closure->uri);
 
     if (cancellable)
         g_cancellable_connect (cancellable,
                                G_CALLBACK (on_session_cancelled),
                                closure->session, NULL);
+
+    seahorse_armor_scanner_next_async (closure->scanner, cancellable,
+                                       on_import_block_read,
+                                       g_steal_pointer (&task));
 }
 
 static GList *
@@ -758,7 +919,6 @@ typedef struct {
     SeahorseHKPSource *source;
     GString *data;
     SoupSession *session;
-    SoupMessage *message;
     int requests;
 } ExportClosure;
 
@@ -769,7 +929,6 @@ export_closure_free (void *data)
     g_clear_object (&closure->source);
     if (closure->data)
         g_string_free (closure->data, TRUE);
-    g_clear_object (&closure->message);
     g_clear_object (&closure->session);
     g_free (closure);
 }
@@ -785,13 +944,16 @@ on_export_message_complete (GObject *object,
     GCancellable *cancellable = g_task_get_cancellable (task);
     g_autoptr(GBytes) response = NULL;
     g_autoptr(GError) error = NULL;
+    SoupMessage *message = soup_session_get_async_result_message (session, result);
     const char *start, *end, *text;
     size_t len;
 
-    seahorse_progress_end (cancellable, closure->message);
+    seahorse_progress_end (cancellable, message);
 
     response = soup_session_send_and_read_finish (session, result, &error);
-    if (response == NULL) {
+    if (g_task_had_error (task))
+        return;
+    if (response == NULL || !check_message_status (message, &error)) {
         g_task_return_error (task, g_steal_pointer (&error));
         return;
     }
@@ -851,6 +1013,7 @@ seahorse_hkp_source_export_async (SeahorseServerSource *source,
         g_autofree char *hexfpr = NULL;
         g_autoptr(GHashTable) form = NULL;
         g_autoptr(GUri) uri = NULL;
+        g_autoptr(SoupMessage) message = NULL;
 
         form = g_hash_table_new (g_str_hash, g_str_equal);
 
@@ -869,17 +1032,17 @@ seahorse_hkp_source_export_async (SeahorseServerSource *source,
         uri = get_http_server_uri (self, "/pks/lookup", form);
         g_return_if_fail (uri);
 
-        closure->message = soup_message_new_from_uri ("GET", uri);
+        message = soup_message_new_from_uri ("GET", uri);
+
+        closure->requests++;
+        seahorse_progress_prep_and_begin (cancellable, message, NULL);
 
         soup_session_send_and_read_async (closure->session,
-                                          closure->message,
+                                          message,
                                           G_PRIORITY_DEFAULT,
                                           cancellable,
                                           on_export_message_complete,
-                                          g_steal_pointer (&task));
-
-        closure->requests++;
-        seahorse_progress_prep_and_begin (cancellable, closure->message, NULL);
+                                          g_object_ref (task));
     }
 
     if (cancellable)
@@ -43,6 +43,8 @@ gboolean              seahorse_hkp_is_valid_uri    (const char *uri);
 
 GList *               seahorse_hkp_parse_lookup_response  (const char *response);
 
+GList *               seahorse_hkp_parse_lookup_response_bytes (GBytes *response);
+
 
 #define HKP_ERROR_DOMAIN (seahorse_hkp_error_quark())
 GQuark            seahorse_hkp_error_quark       (void);
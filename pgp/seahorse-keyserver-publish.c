@@ -0,0 +1,661 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "seahorse-keyserver-publish.h"
+
+#include "seahorse-pgp-key.h"
+#include "seahorse-server-source.h"
+#include "seahorse-transfer.h"
+
+#include <errno.h>
+
+/* The most keys we send to a server in one go */
+#define PUBLISH_BATCH_SIZE 100
+
+/* How long to wait after the first failure, doubled after every failure
+ * after that, up to the maximum */
+#define PUBLISH_RETRY_MIN_DELAY (30 * G_TIME_SPAN_SECOND)
+#define PUBLISH_RETRY_MAX_DELAY (6 * G_TIME_SPAN_HOUR)
+
+/* How much (in percent) the retry delays are moved around randomly */
+#define PUBLISH_RETRY_JITTER 20
+
+/* Changes to the queue are written out after this many seconds */
+#define PUBLISH_SAVE_DELAY 2
+
+typedef struct {
+    char *fingerprint;
+    char *uri;
+    unsigned int attempts;          /* Failed ones */
+    int64_t next_attempt;           /* Wall clock, 0 for right away */
+    gboolean sending;
+    gboolean requeued;              /* Added again while it was sending */
+    gboolean report;                /* Someone waits to hear if it fails */
+} PublishEntry;
+
+struct _SeahorseKeyserverPublish {
+    GObject parent;
+
+    SeahorsePlace *from;
+    GListModel *keys;
+    GListModel *remotes;
+    char *state_path;
+
+    GHashTable *entries;            /* "fingerprint uri" -> PublishEntry */
+    GHashTable *busy_uris;          /* Servers with a batch on its way */
+
+    GCancellable *cancellable;
+    unsigned int process_id;
+    unsigned int save_id;
+};
+
+enum {
+    FAILED,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE (SeahorseKeyserverPublish, seahorse_keyserver_publish, G_TYPE_OBJECT);
+
+static void      publish_schedule      (SeahorseKeyserverPublish *self,
+                                        int64_t                   delay);
+
+static void
+publish_entry_free (void *data)
+{
+    PublishEntry *entry = data;
+
+    g_free (entry->fingerprint);
+    g_free (entry->uri);
+    g_free (entry);
+}
+
+static char *
+publish_entry_id (const char *fingerprint,
+                  const char *uri)
+{
+    return g_strdup_printf ("%s %s", fingerprint, uri);
+}
+
+static void
+publish_save (SeahorseKeyserverPublish *self)
+{
+    g_autoptr(GKeyFile) file = NULL;
+    g_autofree char *dir = NULL;
+    g_autofree char *data = NULL;
+    g_autoptr(GError) error = NULL;
+    GHashTableIter iter;
+    void *key, *value;
+    size_t length;
+
+    file = g_key_file_new ();
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        PublishEntry *entry = value;
+
+        g_key_file_set_string (file, key, "fingerprint", entry->fingerprint);
+        g_key_file_set_string (file, key, "uri", entry->uri);
+        g_key_file_set_uint64 (file, key, "attempts", entry->attempts);
+        g_key_file_set_int64 (file, key, "next-attempt", entry->next_attempt);
+    }
+
+    dir = g_path_get_dirname (self->state_path);
+    data = g_key_file_to_data (file, &length, NULL);
+
+    if (g_mkdir_with_parents (dir, 0700) < 0 ||
+        !g_file_set_contents_full (self->state_path, data, length,
+                                   G_FILE_SET_CONTENTS_CONSISTENT, 0600, &error))
+        g_message ("Couldn't save the publish queue: %s",
+                   error ? error->message : g_strerror (errno));
+}
+
+static void
+publish_load (SeahorseKeyserverPublish *self)
+{
+    g_autoptr(GKeyFile) file = NULL;
+    g_auto(GStrv) groups = NULL;
+    g_autoptr(GError) error = NULL;
+
+    file = g_key_file_new ();
+    if (!g_key_file_load_from_file (file, self->state_path, G_KEY_FILE_NONE, &error)) {
+        if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_message ("Couldn't load the publish queue: %s", error->message);
+        return;
+    }
+
+    groups = g_key_file_get_groups (file, NULL);
+    for (unsigned int i = 0; groups[i] != NULL; i++) {
+        PublishEntry *entry;
+
+        entry = g_new0 (PublishEntry, 1);
+        entry->fingerprint = g_key_file_get_string (file, groups[i], "fingerprint", NULL);
+        entry->uri = g_key_file_get_string (file, groups[i], "uri", NULL);
+        entry->attempts = g_key_file_get_uint64 (file, groups[i], "attempts", NULL);
+        entry->next_attempt = g_key_file_get_int64 (file, groups[i], "next-attempt", NULL);
+
+        if (entry->fingerprint == NULL || entry->uri == NULL) {
+            publish_entry_free (entry);
+            continue;
+        }
+
+        g_hash_table_insert (self->entries,
+                             publish_entry_id (entry->fingerprint, entry->uri),
+                             entry);
+    }
+}
+
+static gboolean
+on_save_timeout (void *user_data)
+{
+    SeahorseKeyserverPublish *self = SEAHORSE_KEYSERVER_PUBLISH (user_data);
+
+    self->save_id = 0;
+    publish_save (self);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+publish_queue_changed (SeahorseKeyserverPublish *self)
+{
+    if (self->save_id == 0)
+        self->save_id = g_timeout_add_seconds (PUBLISH_SAVE_DELAY, on_save_timeout, self);
+}
+
+static GTimeSpan
+publish_retry_delay (unsigned int attempts)
+{
+    GTimeSpan delay = PUBLISH_RETRY_MIN_DELAY;
+    double jitter;
+
+    for (unsigned int i = 1; i < attempts && delay < PUBLISH_RETRY_MAX_DELAY; i++)
+        delay *= 2;
+    delay = MIN (delay, PUBLISH_RETRY_MAX_DELAY);
+
+    jitter = g_random_double_range (-PUBLISH_RETRY_JITTER, PUBLISH_RETRY_JITTER) / 100.0;
+    return delay + (GTimeSpan) (jitter * delay);
+}
+
+static SeahorseServerSource *
+publish_lookup_remote (SeahorseKeyserverPublish *self,
+                       const char               *uri)
+{
+    for (unsigned int i = 0; i < g_list_model_get_n_items (self->remotes); i++) {
+        g_autoptr(SeahorseServerSource) remote = g_list_model_get_item (self->remotes, i);
+        g_autofree char *remote_uri = seahorse_place_get_uri (SEAHORSE_PLACE (remote));
+
+        if (g_ascii_strcasecmp (uri, remote_uri) == 0)
+            return g_steal_pointer (&remote);
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    SeahorseKeyserverPublish *self;     /* Not owned, gone when cancelled */
+    GCancellable *cancellable;
+    char *uri;
+    GPtrArray *ids;
+} BatchClosure;
+
+static void
+batch_closure_free (BatchClosure *closure)
+{
+    g_object_unref (closure->cancellable);
+    g_free (closure->uri);
+    g_ptr_array_unref (closure->ids);
+    g_free (closure);
+}
+
+static void
+on_batch_transfer_ready (GObject      *source,
+                         GAsyncResult *result,
+                         void         *user_data)
+{
+    BatchClosure *closure = user_data;
+    SeahorseKeyserverPublish *self = closure->self;
+    g_autoptr(GError) error = NULL;
+    int64_t now = g_get_real_time ();
+    unsigned int n_report = 0;
+
+    /* Cancelled when the queue went away */
+    if (!seahorse_transfer_finish (result, &error) &&
+        g_cancellable_is_cancelled (closure->cancellable)) {
+        batch_closure_free (closure);
+        return;
+    }
+
+    if (error != NULL)
+        g_message ("Couldn't publish %u keys to %s, will try again later: %s",
+                   closure->ids->len, closure->uri, error->message);
+
+    for (unsigned int i = 0; i < closure->ids->len; i++) {
+        const char *id = g_ptr_array_index (closure->ids, i);
+        PublishEntry *entry;
+
+        entry = g_hash_table_lookup (self->entries, id);
+        if (entry == NULL)
+            continue;
+
+        if (error != NULL && entry->report)
+            n_report++;
+        entry->report = FALSE;
+        entry->sending = FALSE;
+
+        /* A newer version of the key is waiting, so it stays queued */
+        if (error == NULL && entry->requeued) {
+            entry->requeued = FALSE;
+            entry->attempts = 0;
+            entry->next_attempt = 0;
+        } else if (error == NULL) {
+            g_hash_table_remove (self->entries, id);
+        } else {
+            entry->requeued = FALSE;
+            entry->attempts++;
+            entry->next_attempt = now + publish_retry_delay (entry->attempts);
+        }
+    }
+
+    g_hash_table_remove (self->busy_uris, closure->uri);
+    publish_queue_changed (self);
+    publish_schedule (self, 0);
+
+    /* Only once per time the keys were added, the retries stay quiet */
+    if (n_report > 0)
+        g_signal_emit (self, signals[FAILED], 0, closure->uri, n_report, error);
+
+    batch_closure_free (closure);
+}
+
+static void
+publish_send_batch (SeahorseKeyserverPublish *self,
+                    const char               *uri,
+                    GPtrArray                *ids,
+                    GHashTable               *keys_by_fingerprint)
+{
+    g_autoptr(SeahorseServerSource) remote = NULL;
+    g_autolist(SeahorsePgpKey) keys = NULL;
+    BatchClosure *closure;
+
+    closure = g_new0 (BatchClosure, 1);
+    closure->self = self;
+    closure->cancellable = g_object_ref (self->cancellable);
+    closure->uri = g_strdup (uri);
+    closure->ids = g_ptr_array_new_with_free_func (g_free);
+
+    remote = publish_lookup_remote (self, uri);
+
+    for (unsigned int i = 0; i < ids->len; i++) {
+        const char *id = g_ptr_array_index (ids, i);
+        PublishEntry *entry = g_hash_table_lookup (self->entries, id);
+        SeahorsePgpKey *key;
+
+        /* The key is gone, nothing to publish anymore */
+        key = g_hash_table_lookup (keys_by_fingerprint, entry->fingerprint);
+        if (key == NULL) {
+            g_hash_table_remove (self->entries, id);
+            publish_queue_changed (self);
+            continue;
+        }
+
+        /* No such server (anymore): wait, it might be configured again */
+        if (remote == NULL) {
+            entry->attempts++;
+            entry->next_attempt = g_get_real_time () + publish_retry_delay (entry->attempts);
+            publish_queue_changed (self);
+            continue;
+        }
+
+        entry->sending = TRUE;
+        entry->requeued = FALSE;
+        keys = g_list_prepend (keys, g_object_ref (key));
+        g_ptr_array_add (closure->ids, g_strdup (id));
+    }
+
+    if (keys == NULL) {
+        batch_closure_free (closure);
+        return;
+    }
+
+    g_debug ("Publishing %u keys to %s", closure->ids->len, uri);
+    g_hash_table_add (self->busy_uris, g_strdup (uri));
+    seahorse_transfer_keys_async (self->from, SEAHORSE_PLACE (remote), keys,
+                                  self->cancellable,
+                                  on_batch_transfer_ready, closure);
+}
+
+static gboolean
+on_process_timeout (void *user_data)
+{
+    SeahorseKeyserverPublish *self = SEAHORSE_KEYSERVER_PUBLISH (user_data);
+    g_autoptr(GHashTable) keys_by_fingerprint = NULL;
+    g_autoptr(GHashTable) batches = NULL;
+    GHashTableIter iter;
+    void *key, *value;
+    int64_t now = g_get_real_time ();
+    int64_t next = 0;
+
+    self->process_id = 0;
+
+    /* Collect what's due, one batch per server */
+    batches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                     (GDestroyNotify) g_ptr_array_unref);
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        PublishEntry *entry = value;
+        GPtrArray *batch;
+
+        if (entry->sending || g_hash_table_contains (self->busy_uris, entry->uri))
+            continue;
+
+        batch = g_hash_table_lookup (batches, entry->uri);
+        if (entry->next_attempt > now ||
+            (batch != NULL && batch->len >= PUBLISH_BATCH_SIZE)) {
+            if (next == 0 || entry->next_attempt < next)
+                next = MAX (entry->next_attempt, now);
+            continue;
+        }
+
+        if (batch == NULL) {
+            batch = g_ptr_array_new_with_free_func (g_free);
+            g_hash_table_insert (batches, g_strdup (entry->uri), batch);
+        }
+        g_ptr_array_add (batch, g_strdup (key));
+    }
+
+    if (g_hash_table_size (batches) > 0) {
+        keys_by_fingerprint = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     NULL, g_object_unref);
+        for (unsigned int i = 0; i < g_list_model_get_n_items (self->keys); i++) {
+            SeahorsePgpKey *pkey = g_list_model_get_item (self->keys, i);
+            g_hash_table_replace (keys_by_fingerprint,
+                                  (char *) seahorse_pgp_key_get_fingerprint (pkey),
+                                  pkey);
+        }
+
+        g_hash_table_iter_init (&iter, batches);
+        while (g_hash_table_iter_next (&iter, &key, &value))
+            publish_send_batch (self, key, value, keys_by_fingerprint);
+    }
+
+    /* The rest of the queue: the servers that are busy pick it up when
+     * they're done, the others when it's time */
+    if (next != 0)
+        publish_schedule (self, next - now);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+publish_schedule (SeahorseKeyserverPublish *self,
+                  int64_t                   delay)
+{
+    g_clear_handle_id (&self->process_id, g_source_remove);
+    self->process_id = g_timeout_add (MIN (delay / 1000, G_MAXUINT),
+                                      on_process_timeout, self);
+}
+
+static void
+on_network_changed (GNetworkMonitor *monitor,
+                    gboolean         available,
+                    void            *user_data)
+{
+    SeahorseKeyserverPublish *self = SEAHORSE_KEYSERVER_PUBLISH (user_data);
+
+    /* Back online: no need to wait for the back-off */
+    if (available && g_hash_table_size (self->entries) > 0)
+        seahorse_keyserver_publish_retry_now (self);
+}
+
+static void
+seahorse_keyserver_publish_init (SeahorseKeyserverPublish *self)
+{
+    self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, publish_entry_free);
+    self->busy_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    self->cancellable = g_cancellable_new ();
+}
+
+static void
+seahorse_keyserver_publish_dispose (GObject *obj)
+{
+    SeahorseKeyserverPublish *self = SEAHORSE_KEYSERVER_PUBLISH (obj);
+
+    g_cancellable_cancel (self->cancellable);
+    g_clear_handle_id (&self->process_id, g_source_remove);
+    seahorse_keyserver_publish_flush (self);
+
+    G_OBJECT_CLASS (seahorse_keyserver_publish_parent_class)->dispose (obj);
+}
+
+static void
+seahorse_keyserver_publish_finalize (GObject *obj)
+{
+    SeahorseKeyserverPublish *self = SEAHORSE_KEYSERVER_PUBLISH (obj);
+
+    g_clear_object (&self->from);
+    g_clear_object (&self->keys);
+    g_clear_object (&self->remotes);
+    g_clear_object (&self->cancellable);
+    g_hash_table_unref (self->entries);
+    g_hash_table_unref (self->busy_uris);
+    g_free (self->state_path);
+
+    G_OBJECT_CLASS (seahorse_keyserver_publish_parent_class)->finalize (obj);
+}
+
+static void
+seahorse_keyserver_publish_class_init (SeahorseKeyserverPublishClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->dispose = seahorse_keyserver_publish_dispose;
+    gobject_class->finalize = seahorse_keyserver_publish_finalize;
+
+    /**
+     * SeahorseKeyserverPublish::failed:
+     * @uri: The key server
+     * @n_keys: How many of the keys that were added failed
+     * @error: What went wrong
+     *
+     * Emitted when keys that were added couldn't be published the first
+     * time. They are tried again later.
+     */
+    signals[FAILED] = g_signal_new ("failed", SEAHORSE_TYPE_KEYSERVER_PUBLISH,
+                                    G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+                                    G_TYPE_NONE, 3,
+                                    G_TYPE_STRING, G_TYPE_UINT, G_TYPE_ERROR);
+}
+
+/**
+ * seahorse_keyserver_publish_new:
+ * @from: The place the keys are published from
+ * @keys: The keys in @from, to find the queued keys in
+ * @remotes: The key servers that keys can be published to
+ * @state_path: Where to keep the queue
+ *
+ * Creates the publish queue, picking up where the last session left off.
+ *
+ * Returns: (transfer full): The new queue
+ */
+SeahorseKeyserverPublish *
+seahorse_keyserver_publish_new (SeahorsePlace *from,
+                                GListModel    *keys,
+                                GListModel    *remotes,
+                                const char    *state_path)
+{
+    SeahorseKeyserverPublish *self;
+
+    g_return_val_if_fail (SEAHORSE_IS_PLACE (from), NULL);
+    g_return_val_if_fail (G_IS_LIST_MODEL (keys), NULL);
+    g_return_val_if_fail (G_IS_LIST_MODEL (remotes), NULL);
+    g_return_val_if_fail (state_path != NULL, NULL);
+
+    self = g_object_new (SEAHORSE_TYPE_KEYSERVER_PUBLISH, NULL);
+    self->from = g_object_ref (from);
+    self->keys = g_object_ref (keys);
+    self->remotes = g_object_ref (remotes);
+    self->state_path = g_strdup (state_path);
+
+    g_signal_connect_object (g_network_monitor_get_default (), "network-changed",
+                             G_CALLBACK (on_network_changed), self, 0);
+
+    publish_load (self);
+    if (g_hash_table_size (self->entries) > 0)
+        publish_schedule (self, 0);
+
+    return self;
+}
+
+/**
+ * seahorse_keyserver_publish_add:
+ * @self: The publish queue
+ * @keys: The keys to publish
+ * @uri: The key server to publish them to
+ *
+ * Queues the keys to be published. Keys that are already queued for the
+ * same server are sent as soon as possible again. If the first attempt
+ * fails, #SeahorseKeyserverPublish::failed is emitted.
+ */
+void
+seahorse_keyserver_publish_add (SeahorseKeyserverPublish *self,
+                                GListModel               *keys,
+                                const char               *uri)
+{
+    g_return_if_fail (SEAHORSE_IS_KEYSERVER_PUBLISH (self));
+    g_return_if_fail (G_IS_LIST_MODEL (keys));
+    g_return_if_fail (uri && *uri);
+
+    for (unsigned int i = 0; i < g_list_model_get_n_items (keys); i++) {
+        g_autoptr(SeahorsePgpKey) key = g_list_model_get_item (keys, i);
+        const char *fingerprint = seahorse_pgp_key_get_fingerprint (key);
+        g_autofree char *id = NULL;
+        PublishEntry *entry;
+
+        if (fingerprint == NULL || fingerprint[0] == '\0')
+            continue;
+
+        id = publish_entry_id (fingerprint, uri);
+        entry = g_hash_table_lookup (self->entries, id);
+        if (entry == NULL) {
+            entry = g_new0 (PublishEntry, 1);
+            entry->fingerprint = g_strdup (fingerprint);
+            entry->uri = g_strdup (uri);
+            g_hash_table_insert (self->entries, g_steal_pointer (&id), entry);
+        }
+
+        /* If it's on its way, the newer version will go in the next batch */
+        if (entry->sending)
+            entry->requeued = TRUE;
+        entry->next_attempt = 0;
+        entry->report = TRUE;
+    }
+
+    publish_queue_changed (self);
+    publish_schedule (self, 0);
+}
+
+/**
+ * seahorse_keyserver_publish_get_state:
+ * @self: The publish queue
+ * @fingerprint: The fingerprint of a key
+ * @uri: A key server
+ *
+ * Returns: Where the key is in the queue for the given server
+ */
+SeahorsePublishState
+seahorse_keyserver_publish_get_state (SeahorseKeyserverPublish *self,
+                                      const char               *fingerprint,
+                                      const char               *uri)
+{
+    g_autofree char *id = NULL;
+    PublishEntry *entry;
+
+    g_return_val_if_fail (SEAHORSE_IS_KEYSERVER_PUBLISH (self), SEAHORSE_PUBLISH_NONE);
+    g_return_val_if_fail (fingerprint != NULL, SEAHORSE_PUBLISH_NONE);
+    g_return_val_if_fail (uri != NULL, SEAHORSE_PUBLISH_NONE);
+
+    id = publish_entry_id (fingerprint, uri);
+    entry = g_hash_table_lookup (self->entries, id);
+    if (entry == NULL)
+        return SEAHORSE_PUBLISH_NONE;
+    if (entry->sending)
+        return SEAHORSE_PUBLISH_SENDING;
+    if (entry->attempts > 0)
+        return SEAHORSE_PUBLISH_RETRYING;
+    return SEAHORSE_PUBLISH_PENDING;
+}
+
+/**
+ * seahorse_keyserver_publish_get_n_queued:
+ * @self: The publish queue
+ *
+ * Returns: How many keys are waiting to be published
+ */
+unsigned int
+seahorse_keyserver_publish_get_n_queued (SeahorseKeyserverPublish *self)
+{
+    g_return_val_if_fail (SEAHORSE_IS_KEYSERVER_PUBLISH (self), 0);
+
+    return g_hash_table_size (self->entries);
+}
+
+/**
+ * seahorse_keyserver_publish_retry_now:
+ * @self: The publish queue
+ *
+ * Tries the keys that failed before again right away, instead of waiting
+ * for their turn.
+ */
+void
+seahorse_keyserver_publish_retry_now (SeahorseKeyserverPublish *self)
+{
+    GHashTableIter iter;
+    void *value;
+
+    g_return_if_fail (SEAHORSE_IS_KEYSERVER_PUBLISH (self));
+
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        PublishEntry *entry = value;
+        entry->next_attempt = 0;
+    }
+
+    publish_schedule (self, 0);
+}
+
+/**
+ * seahorse_keyserver_publish_flush:
+ * @self: The publish queue
+ *
+ * Writes out pending changes to the queue right away.
+ */
+void
+seahorse_keyserver_publish_flush (SeahorseKeyserverPublish *self)
+{
+    g_return_if_fail (SEAHORSE_IS_KEYSERVER_PUBLISH (self));
+
+    if (self->save_id == 0)
+        return;
+
+    g_clear_handle_id (&self->save_id, g_source_remove);
+    publish_save (self);
+}
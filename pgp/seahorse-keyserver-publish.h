@@ -0,0 +1,62 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SeahorseKeyserverPublish: A queue of keys waiting to be published.
+ *
+ * - Keys stay queued (also across sessions) until the server accepted them.
+ * - Queued keys for the same server are sent together, in batches.
+ * - After a failure, a key waits longer and longer before it's tried
+ *   again, or until the network comes back.
+ */
+
+#pragma once
+
+#include "seahorse-common.h"
+
+typedef enum {
+    SEAHORSE_PUBLISH_NONE,          /* Not queued (anymore) */
+    SEAHORSE_PUBLISH_PENDING,       /* Waiting for its turn */
+    SEAHORSE_PUBLISH_SENDING,
+    SEAHORSE_PUBLISH_RETRYING,      /* Failed before, waiting to try again */
+} SeahorsePublishState;
+
+#define SEAHORSE_TYPE_KEYSERVER_PUBLISH (seahorse_keyserver_publish_get_type ())
+G_DECLARE_FINAL_TYPE (SeahorseKeyserverPublish, seahorse_keyserver_publish,
+                      SEAHORSE, KEYSERVER_PUBLISH,
+                      GObject)
+
+SeahorseKeyserverPublish *  seahorse_keyserver_publish_new          (SeahorsePlace *from,
+                                                                     GListModel    *keys,
+                                                                     GListModel    *remotes,
+                                                                     const char    *state_path);
+
+void                        seahorse_keyserver_publish_add          (SeahorseKeyserverPublish *self,
+                                                                     GListModel               *keys,
+                                                                     const char               *uri);
+
+SeahorsePublishState        seahorse_keyserver_publish_get_state    (SeahorseKeyserverPublish *self,
+                                                                     const char               *fingerprint,
+                                                                     const char               *uri);
+
+unsigned int                seahorse_keyserver_publish_get_n_queued (SeahorseKeyserverPublish *self);
+
+void                        seahorse_keyserver_publish_retry_now    (SeahorseKeyserverPublish *self);
+
+void                        seahorse_keyserver_publish_flush        (SeahorseKeyserverPublish *self);
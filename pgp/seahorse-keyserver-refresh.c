@@ -0,0 +1,633 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "seahorse-keyserver-refresh.h"
+
+#include "seahorse-pgp-key.h"
+#include "seahorse-server-source.h"
+#include "seahorse-transfer.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* The most keys we ask a server for at once */
+#define REFRESH_BATCH_SIZE 50
+
+/* How much (in percent of the window) a key's next refresh is moved around
+ * randomly, so keys refreshed together drift apart again */
+#define REFRESH_JITTER 10
+
+/* When to try again if the server failed, at most */
+#define REFRESH_RETRY_DELAY (15 * G_TIME_SPAN_MINUTE)
+
+/* Bounds for the time between two batches */
+#define REFRESH_MIN_GAP (100 * G_TIME_SPAN_MILLISECOND)
+#define REFRESH_MAX_GAP (5 * G_TIME_SPAN_MINUTE)
+
+/* How long we wait after the keys changed, before looking at them */
+#define REFRESH_SYNC_DELAY 1
+
+/* Changes to the state are written out after this many seconds */
+#define REFRESH_SAVE_DELAY 5
+
+typedef struct {
+    int64_t refreshed;              /* Wall clock, 0 if never */
+    int64_t due;
+} RefreshEntry;
+
+struct _SeahorseKeyserverRefresh {
+    GObject parent;
+
+    GListModel *keys;
+    GListModel *remotes;
+    SeahorsePlace *to;
+    char *state_path;
+    GTimeSpan window;
+
+    GHashTable *entries;            /* Fingerprint -> RefreshEntry */
+    gboolean keys_changed;
+    gulong keys_changed_sig;
+
+    GCancellable *cancellable;
+    gboolean in_flight;
+    int64_t last_batch;
+    unsigned int next_remote;
+    unsigned int tick_id;
+    unsigned int save_id;
+};
+
+G_DEFINE_TYPE (SeahorseKeyserverRefresh, seahorse_keyserver_refresh, G_TYPE_OBJECT);
+
+static void      refresh_schedule      (SeahorseKeyserverRefresh *self);
+
+static void
+refresh_save (SeahorseKeyserverRefresh *self)
+{
+    g_autoptr(GKeyFile) file = NULL;
+    g_autofree char *dir = NULL;
+    g_autofree char *data = NULL;
+    g_autoptr(GError) error = NULL;
+    GHashTableIter iter;
+    void *key, *value;
+    size_t length;
+
+    file = g_key_file_new ();
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        RefreshEntry *entry = value;
+
+        if (entry->refreshed != 0)
+            g_key_file_set_int64 (file, "refreshed", key, entry->refreshed);
+        g_key_file_set_int64 (file, "due", key, entry->due);
+    }
+
+    dir = g_path_get_dirname (self->state_path);
+    data = g_key_file_to_data (file, &length, NULL);
+
+    if (g_mkdir_with_parents (dir, 0700) < 0 ||
+        !g_file_set_contents_full (self->state_path, data, length,
+                                   G_FILE_SET_CONTENTS_CONSISTENT, 0600, &error))
+        g_message ("Couldn't save key refresh state: %s",
+                   error ? error->message : g_strerror (errno));
+}
+
+/* Fingerprints are shown with spaces in between, but key servers and the
+ * state file want the plain hex digits */
+static char *
+refresh_normalize_fingerprint (const char *fingerprint)
+{
+    GString *result;
+
+    result = g_string_sized_new (40);
+    for (const char *p = fingerprint; *p; p++) {
+        if (!g_ascii_isspace (*p))
+            g_string_append_c (result, g_ascii_toupper (*p));
+    }
+
+    return g_string_free (result, FALSE);
+}
+
+static void
+refresh_load (SeahorseKeyserverRefresh *self)
+{
+    g_autoptr(GKeyFile) file = NULL;
+    g_auto(GStrv) fingerprints = NULL;
+    g_autoptr(GError) error = NULL;
+
+    file = g_key_file_new ();
+    if (!g_key_file_load_from_file (file, self->state_path, G_KEY_FILE_NONE, &error)) {
+        if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_message ("Couldn't load key refresh state: %s", error->message);
+        return;
+    }
+
+    fingerprints = g_key_file_get_keys (file, "due", NULL, NULL);
+    for (unsigned int i = 0; fingerprints && fingerprints[i] != NULL; i++) {
+        RefreshEntry *entry = g_new0 (RefreshEntry, 1);
+
+        entry->due = g_key_file_get_int64 (file, "due", fingerprints[i], NULL);
+        entry->refreshed = g_key_file_get_int64 (file, "refreshed", fingerprints[i], NULL);
+        g_hash_table_replace (self->entries,
+                              refresh_normalize_fingerprint (fingerprints[i]), entry);
+    }
+}
+
+static gboolean
+on_save_timeout (void *user_data)
+{
+    SeahorseKeyserverRefresh *self = SEAHORSE_KEYSERVER_REFRESH (user_data);
+
+    self->save_id = 0;
+    refresh_save (self);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+refresh_state_changed (SeahorseKeyserverRefresh *self)
+{
+    if (self->save_id == 0)
+        self->save_id = g_timeout_add_seconds (REFRESH_SAVE_DELAY, on_save_timeout, self);
+}
+
+/* A random moment in the next window, give or take the jitter */
+static int64_t
+refresh_next_due (SeahorseKeyserverRefresh *self,
+                  int64_t                   now)
+{
+    double jitter;
+
+    jitter = g_random_double_range (-REFRESH_JITTER, REFRESH_JITTER) / 100.0;
+    return now + self->window + (int64_t) (jitter * self->window);
+}
+
+/* Picks up new keys, and forgets about the ones that are gone */
+static void
+refresh_sync_keys (SeahorseKeyserverRefresh *self,
+                   int64_t                   now)
+{
+    g_autoptr(GHashTable) present = NULL;
+    GHashTableIter iter;
+    void *key;
+
+    present = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (unsigned int i = 0; i < g_list_model_get_n_items (self->keys); i++) {
+        g_autoptr(SeahorsePgpKey) pkey = g_list_model_get_item (self->keys, i);
+        const char *fingerprint;
+        char *normalized;
+        RefreshEntry *entry;
+
+        fingerprint = seahorse_pgp_key_get_fingerprint (pkey);
+        if (fingerprint == NULL || fingerprint[0] == '\0')
+            continue;
+
+        normalized = refresh_normalize_fingerprint (fingerprint);
+        g_hash_table_add (present, normalized);
+        if (g_hash_table_contains (self->entries, normalized))
+            continue;
+
+        /* A new key: somewhere in the coming window, so that a keyring
+         * full of new keys doesn't get refreshed all at once */
+        entry = g_new0 (RefreshEntry, 1);
+        entry->due = now + (int64_t) g_random_double_range (0, self->window);
+        g_hash_table_insert (self->entries, g_strdup (normalized), entry);
+        refresh_state_changed (self);
+    }
+
+    /* Probably not loaded yet, don't throw away what we know */
+    if (g_hash_table_size (present) == 0) {
+        self->keys_changed = FALSE;
+        return;
+    }
+
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, &key, NULL)) {
+        if (!g_hash_table_contains (present, key)) {
+            g_hash_table_iter_remove (&iter);
+            refresh_state_changed (self);
+        }
+    }
+
+    self->keys_changed = FALSE;
+}
+
+/* How long to wait between batches: the whole keyring should fit in the
+ * window, but never with long pauses or in a burst */
+static GTimeSpan
+refresh_batch_gap (SeahorseKeyserverRefresh *self)
+{
+    unsigned int n_batches;
+
+    n_batches = g_hash_table_size (self->entries) / REFRESH_BATCH_SIZE + 1;
+    return CLAMP (self->window / n_batches, REFRESH_MIN_GAP, REFRESH_MAX_GAP);
+}
+
+typedef struct {
+    SeahorseKeyserverRefresh *self;     /* Not owned, gone when cancelled */
+    GCancellable *cancellable;
+    GPtrArray *fingerprints;
+} BatchClosure;
+
+static void
+batch_closure_free (BatchClosure *closure)
+{
+    g_object_unref (closure->cancellable);
+    g_ptr_array_unref (closure->fingerprints);
+    g_free (closure);
+}
+
+static void
+on_batch_transfer_ready (GObject      *source,
+                         GAsyncResult *result,
+                         void         *user_data)
+{
+    BatchClosure *closure = user_data;
+    SeahorseKeyserverRefresh *self = closure->self;
+    g_autoptr(GError) error = NULL;
+    int64_t now = g_get_real_time ();
+
+    if (!seahorse_transfer_finish (result, &error) &&
+        g_cancellable_is_cancelled (closure->cancellable)) {
+        batch_closure_free (closure);
+        return;
+    }
+
+    self->in_flight = FALSE;
+    if (error != NULL)
+        g_message ("Couldn't refresh keys: %s", error->message);
+
+    for (unsigned int i = 0; i < closure->fingerprints->len; i++) {
+        RefreshEntry *entry;
+
+        entry = g_hash_table_lookup (self->entries,
+                                     g_ptr_array_index (closure->fingerprints, i));
+        if (entry == NULL)
+            continue;
+
+        if (error == NULL) {
+            entry->refreshed = now;
+            entry->due = refresh_next_due (self, now);
+        } else {
+            entry->due = now + MIN (REFRESH_RETRY_DELAY, self->window);
+        }
+    }
+
+    refresh_state_changed (self);
+    refresh_schedule (self);
+    batch_closure_free (closure);
+}
+
+static int
+compare_due (const void *a,
+             const void *b,
+             void       *user_data)
+{
+    GHashTable *entries = user_data;
+    RefreshEntry *ea = g_hash_table_lookup (entries, *(char **) a);
+    RefreshEntry *eb = g_hash_table_lookup (entries, *(char **) b);
+
+    return (ea->due > eb->due) - (ea->due < eb->due);
+}
+
+static void
+refresh_start_batch (SeahorseKeyserverRefresh *self)
+{
+    g_autoptr(SeahorseServerSource) remote = NULL;
+    g_autoptr(GPtrArray) due = NULL;
+    g_autoptr(GPtrArray) keyids = NULL;
+    unsigned int n_remotes;
+    BatchClosure *closure;
+    GHashTableIter iter;
+    void *key, *value;
+    int64_t now = g_get_real_time ();
+
+    if (self->keys_changed)
+        refresh_sync_keys (self, now);
+
+    n_remotes = g_list_model_get_n_items (self->remotes);
+    if (n_remotes == 0)
+        return;
+
+    /* The keys that are due, oldest first */
+    due = g_ptr_array_new ();
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        RefreshEntry *entry = value;
+        if (entry->due <= now)
+            g_ptr_array_add (due, key);
+    }
+
+    if (due->len == 0)
+        return;
+
+    g_ptr_array_sort_with_data (due, compare_due, self->entries);
+    if (due->len > REFRESH_BATCH_SIZE)
+        g_ptr_array_set_size (due, REFRESH_BATCH_SIZE);
+
+    closure = g_new0 (BatchClosure, 1);
+    closure->self = self;
+    closure->cancellable = g_object_ref (self->cancellable);
+    closure->fingerprints = g_ptr_array_new_with_free_func (g_free);
+
+    keyids = g_ptr_array_new ();
+    for (unsigned int i = 0; i < due->len; i++) {
+        const char *fingerprint = g_ptr_array_index (due, i);
+        size_t len = strlen (fingerprint);
+
+        /* The long key ID is the end of the (normalized) fingerprint */
+        g_ptr_array_add (closure->fingerprints, g_strdup (fingerprint));
+        g_ptr_array_add (keyids, (char *) fingerprint + (len > 16 ? len - 16 : 0));
+    }
+    g_ptr_array_add (keyids, NULL);
+
+    /* Spread the batches over the servers */
+    remote = g_list_model_get_item (self->remotes, self->next_remote++ % n_remotes);
+
+    g_debug ("Refreshing %u keys", due->len);
+    self->in_flight = TRUE;
+    self->last_batch = g_get_monotonic_time ();
+    seahorse_transfer_keyids_async (remote, self->to,
+                                    (const char **) keyids->pdata,
+                                    self->cancellable,
+                                    on_batch_transfer_ready, closure);
+}
+
+static gboolean
+on_tick_timeout (void *user_data)
+{
+    SeahorseKeyserverRefresh *self = SEAHORSE_KEYSERVER_REFRESH (user_data);
+
+    self->tick_id = 0;
+    refresh_start_batch (self);
+    if (!self->in_flight)
+        refresh_schedule (self);
+    return G_SOURCE_REMOVE;
+}
+
+/* Sets up the timer for the next batch */
+static void
+refresh_schedule (SeahorseKeyserverRefresh *self)
+{
+    int64_t next_due, now, delay;
+
+    g_clear_handle_id (&self->tick_id, g_source_remove);
+
+    if (self->window <= 0 || self->in_flight)
+        return;
+
+    if (self->keys_changed) {
+        self->tick_id = g_timeout_add_seconds (REFRESH_SYNC_DELAY, on_tick_timeout, self);
+        return;
+    }
+
+    next_due = seahorse_keyserver_refresh_get_next_due (self);
+    if (next_due == 0)
+        return;
+
+    now = g_get_real_time ();
+    delay = MAX (next_due - now, 0);
+
+    /* Nowhere to refresh from, check back later */
+    if (g_list_model_get_n_items (self->remotes) == 0)
+        delay = MAX (delay, REFRESH_MAX_GAP);
+
+    /* Keep some distance from the previous batch */
+    if (self->last_batch != 0)
+        delay = MAX (delay, self->last_batch + refresh_batch_gap (self) - g_get_monotonic_time ());
+
+    self->tick_id = g_timeout_add (MIN (delay / 1000, G_MAXUINT), on_tick_timeout, self);
+}
+
+static void
+on_keys_changed (GListModel *keys,
+                 unsigned int position,
+                 unsigned int removed,
+                 unsigned int added,
+                 void        *user_data)
+{
+    SeahorseKeyserverRefresh *self = SEAHORSE_KEYSERVER_REFRESH (user_data);
+
+    if (self->keys_changed)
+        return;
+
+    self->keys_changed = TRUE;
+    refresh_schedule (self);
+}
+
+static void
+seahorse_keyserver_refresh_init (SeahorseKeyserverRefresh *self)
+{
+    self->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    self->cancellable = g_cancellable_new ();
+    self->keys_changed = TRUE;
+}
+
+static void
+seahorse_keyserver_refresh_dispose (GObject *obj)
+{
+    SeahorseKeyserverRefresh *self = SEAHORSE_KEYSERVER_REFRESH (obj);
+
+    g_cancellable_cancel (self->cancellable);
+    g_clear_handle_id (&self->tick_id, g_source_remove);
+    g_clear_signal_handler (&self->keys_changed_sig, self->keys);
+    seahorse_keyserver_refresh_flush (self);
+
+    G_OBJECT_CLASS (seahorse_keyserver_refresh_parent_class)->dispose (obj);
+}
+
+static void
+seahorse_keyserver_refresh_finalize (GObject *obj)
+{
+    SeahorseKeyserverRefresh *self = SEAHORSE_KEYSERVER_REFRESH (obj);
+
+    g_clear_object (&self->keys);
+    g_clear_object (&self->remotes);
+    g_clear_object (&self->to);
+    g_clear_object (&self->cancellable);
+    g_hash_table_unref (self->entries);
+    g_free (self->state_path);
+
+    G_OBJECT_CLASS (seahorse_keyserver_refresh_parent_class)->finalize (obj);
+}
+
+static void
+seahorse_keyserver_refresh_class_init (SeahorseKeyserverRefreshClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->dispose = seahorse_keyserver_refresh_dispose;
+    gobject_class->finalize = seahorse_keyserver_refresh_finalize;
+}
+
+/**
+ * seahorse_keyserver_refresh_new:
+ * @keys: The keys to keep fresh
+ * @remotes: The key servers to refresh them from
+ * @to: Where to import the refreshed keys
+ * @state_path: Where to keep track of what was refreshed when
+ *
+ * Creates a new refresh scheduler. It doesn't do anything until a window
+ * is set with seahorse_keyserver_refresh_set_window().
+ *
+ * Returns: (transfer full): The new scheduler
+ */
+SeahorseKeyserverRefresh *
+seahorse_keyserver_refresh_new (GListModel    *keys,
+                                GListModel    *remotes,
+                                SeahorsePlace *to,
+                                const char    *state_path)
+{
+    SeahorseKeyserverRefresh *self;
+
+    g_return_val_if_fail (G_IS_LIST_MODEL (keys), NULL);
+    g_return_val_if_fail (G_IS_LIST_MODEL (remotes), NULL);
+    g_return_val_if_fail (SEAHORSE_IS_PLACE (to), NULL);
+    g_return_val_if_fail (state_path != NULL, NULL);
+
+    self = g_object_new (SEAHORSE_TYPE_KEYSERVER_REFRESH, NULL);
+    self->keys = g_object_ref (keys);
+    self->remotes = g_object_ref (remotes);
+    self->to = g_object_ref (to);
+    self->state_path = g_strdup (state_path);
+    self->keys_changed_sig = g_signal_connect (keys, "items-changed",
+                                               G_CALLBACK (on_keys_changed), self);
+
+    refresh_load (self);
+    return self;
+}
+
+/**
+ * seahorse_keyserver_refresh_get_window:
+ * @self: The refresh scheduler
+ *
+ * Returns: How often each key is refreshed, or 0 if refreshing is off
+ */
+GTimeSpan
+seahorse_keyserver_refresh_get_window (SeahorseKeyserverRefresh *self)
+{
+    g_return_val_if_fail (SEAHORSE_IS_KEYSERVER_REFRESH (self), 0);
+
+    return self->window;
+}
+
+/**
+ * seahorse_keyserver_refresh_set_window:
+ * @self: The refresh scheduler
+ * @window: How often each key should be refreshed, or 0 to stop
+ *
+ * Sets how often the keys are refreshed. Keys that were already scheduled
+ * further away than the new window are moved into it.
+ */
+void
+seahorse_keyserver_refresh_set_window (SeahorseKeyserverRefresh *self,
+                                       GTimeSpan                 window)
+{
+    GHashTableIter iter;
+    void *value;
+    int64_t now;
+
+    g_return_if_fail (SEAHORSE_IS_KEYSERVER_REFRESH (self));
+    g_return_if_fail (window >= 0);
+
+    if (self->window == window)
+        return;
+
+    self->window = window;
+
+    now = g_get_real_time ();
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        RefreshEntry *entry = value;
+
+        if (entry->due > now + window)
+            entry->due = now + (int64_t) g_random_double_range (0, window);
+    }
+
+    refresh_schedule (self);
+}
+
+/**
+ * seahorse_keyserver_refresh_get_next_due:
+ * @self: The refresh scheduler
+ *
+ * Returns: When the next key is due to be refreshed (wall clock time, in
+ *   microseconds), or 0 if there are no keys
+ */
+int64_t
+seahorse_keyserver_refresh_get_next_due (SeahorseKeyserverRefresh *self)
+{
+    GHashTableIter iter;
+    void *value;
+    int64_t next_due = 0;
+
+    g_return_val_if_fail (SEAHORSE_IS_KEYSERVER_REFRESH (self), 0);
+
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        RefreshEntry *entry = value;
+
+        if (next_due == 0 || entry->due < next_due)
+            next_due = entry->due;
+    }
+
+    return next_due;
+}
+
+/**
+ * seahorse_keyserver_refresh_get_last_refreshed:
+ * @self: The refresh scheduler
+ * @fingerprint: The fingerprint of a key, with or without spaces
+ *
+ * Returns: When the key was last refreshed (wall clock time, in
+ *   microseconds), or 0 if never
+ */
+int64_t
+seahorse_keyserver_refresh_get_last_refreshed (SeahorseKeyserverRefresh *self,
+                                               const char               *fingerprint)
+{
+    g_autofree char *normalized = NULL;
+    RefreshEntry *entry;
+
+    g_return_val_if_fail (SEAHORSE_IS_KEYSERVER_REFRESH (self), 0);
+    g_return_val_if_fail (fingerprint != NULL, 0);
+
+    normalized = refresh_normalize_fingerprint (fingerprint);
+    entry = g_hash_table_lookup (self->entries, normalized);
+    return entry ? entry->refreshed : 0;
+}
+
+/**
+ * seahorse_keyserver_refresh_flush:
+ * @self: The refresh scheduler
+ *
+ * Writes out pending changes to the state right away.
+ */
+void
+seahorse_keyserver_refresh_flush (SeahorseKeyserverRefresh *self)
+{
+    g_return_if_fail (SEAHORSE_IS_KEYSERVER_REFRESH (self));
+
+    if (self->save_id == 0)
+        return;
+
+    g_clear_handle_id (&self->save_id, g_source_remove);
+    refresh_save (self);
+}
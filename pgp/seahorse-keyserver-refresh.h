@@ -0,0 +1,55 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SeahorseKeyserverRefresh: Refreshes keys from the key servers in the
+ * background.
+ *
+ * - Every key is refreshed once per window, at a random moment within it,
+ *   so that the requests are spread out instead of coming in one burst.
+ * - Keys are fetched in small batches, one server per batch, taking turns.
+ * - When each key was refreshed and when it's due again is remembered
+ *   across sessions.
+ */
+
+#pragma once
+
+#include "seahorse-common.h"
+
+#define SEAHORSE_TYPE_KEYSERVER_REFRESH (seahorse_keyserver_refresh_get_type ())
+G_DECLARE_FINAL_TYPE (SeahorseKeyserverRefresh, seahorse_keyserver_refresh,
+                      SEAHORSE, KEYSERVER_REFRESH,
+                      GObject)
+
+SeahorseKeyserverRefresh *  seahorse_keyserver_refresh_new            (GListModel    *keys,
+                                                                       GListModel    *remotes,
+                                                                       SeahorsePlace *to,
+                                                                       const char    *state_path);
+
+GTimeSpan                   seahorse_keyserver_refresh_get_window     (SeahorseKeyserverRefresh *self);
+
+void                        seahorse_keyserver_refresh_set_window     (SeahorseKeyserverRefresh *self,
+                                                                       GTimeSpan                 window);
+
+int64_t                     seahorse_keyserver_refresh_get_next_due   (SeahorseKeyserverRefresh *self);
+
+int64_t                     seahorse_keyserver_refresh_get_last_refreshed (SeahorseKeyserverRefresh *self,
+                                                                           const char               *fingerprint);
+
+void                        seahorse_keyserver_refresh_flush          (SeahorseKeyserverRefresh *self);
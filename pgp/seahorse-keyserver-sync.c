@@ -51,26 +51,6 @@ enum {
 
 G_DEFINE_TYPE (SeahorseKeyserverSync, seahorse_keyserver_sync, ADW_TYPE_DIALOG)
 
-static void
-on_transfer_upload_complete (GObject      *object,
-                             GAsyncResult *result,
-                             gpointer      user_data)
-{
-    SeahorsePgpBackend *backend = SEAHORSE_PGP_BACKEND (object);
-    SeahorseAppSettings *app_settings;
-    GError *error = NULL;
-    g_autofree char *publish_to = NULL;
-
-    if (seahorse_pgp_backend_transfer_finish (backend, result, &error))
-        return;
-
-    app_settings = seahorse_app_settings_instance ();
-    publish_to = seahorse_app_settings_get_server_publish_to (app_settings);
-    seahorse_util_show_error (NULL,
-                              _("Couldn’t publish keys to server"),
-                              error->message);
-}
-
 static void
 on_transfer_download_complete (GObject      *object,
                                GAsyncResult *result,
@@ -159,7 +139,7 @@ do_sync_action (GtkWidget *widget, const char *action_name, GVariant *param)
                                         g_object_ref (source));
     }
 
-    /* Publishing keys online */
+    /* Publishing keys online: queued, so that it survives being offline */
     app_settings = seahorse_app_settings_instance ();
     keyserver = seahorse_app_settings_get_server_publish_to (app_settings);
     if (keyserver && keyserver[0]) {
@@ -167,9 +147,8 @@ do_sync_action (GtkWidget *widget, const char *action_name, GVariant *param)
 
         /* This can happen if the URI scheme is not supported */
         if (source != NULL) {
-            seahorse_pgp_backend_transfer_async (NULL, self->keys, SEAHORSE_PLACE (source),
-                                                 cancellable, on_transfer_upload_complete,
-                                                 g_object_ref (source));
+            seahorse_keyserver_publish_add (seahorse_pgp_backend_get_publish_queue (NULL),
+                                            self->keys, keyserver);
         }
     }
 
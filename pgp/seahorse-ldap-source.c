@@ -23,6 +23,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <glib/gi18n.h>
 
@@ -34,6 +35,7 @@
 
 #include "seahorse-common.h"
 
+#include "libseahorse/seahorse-armor-scanner.h"
 #include "libseahorse/seahorse-util.h"
 
 #include <ldap.h>
@@ -43,8 +45,18 @@
 /* Amount of keys to load in a batch */
 #define DEFAULT_LOAD_BATCH 30
 
+/* How long (in seconds) we keep an unused connection around */
+#define CONNECTION_IDLE_TIMEOUT 60
+
+/* Amount of entries we ask for per page of search results */
+#define SEARCH_PAGE_SIZE 250
+
 struct _SeahorseLDAPSource {
     SeahorseServerSource parent;
+
+    /* A bound connection that isn't used by any operation right now */
+    LDAP *idle_ldap;
+    unsigned int idle_timeout_id;
 };
 
 /* -----------------------------------------------------------------------------
@@ -294,13 +306,43 @@ escape_ldap_value (const char *v)
     return result;
 }
 
+/*
+ * Escapes a value for use in an LDAP search filter, as described in
+ * RFC 4515: the special characters '*', '(', ')', '\' and NUL (and to be
+ * safe, anything that isn't printable ASCII) are written as "\XX".
+ */
+static char*
+escape_ldap_filter_value (const char *v)
+{
+    GString *value;
+
+    g_assert (v);
+    value = g_string_sized_new (strlen (v));
+
+    for ( ; *v; v++) {
+        unsigned char c = *v;
+
+        if (c == '*' || c == '(' || c == ')' || c == '\\' || c < 32 || c > 126)
+            g_string_append_printf (value, "\\%02x", c);
+        else
+            g_string_append_c (value, c);
+    }
+
+    return g_string_free (value, FALSE);
+}
+
 typedef gboolean (*SeahorseLdapCallback)   (LDAPMessage *result,
                                             gpointer user_data);
 
+/* How often we poll when we can't get at the connection's file descriptor */
+#define FALLBACK_POLL_INTERVAL 50
+
 typedef struct {
     GSource source;
     LDAP *ldap;
     int ldap_op;
+    void *fd_tag;
+    gboolean pending;
     GCancellable *cancellable;
     gboolean cancelled;
     int cancelled_sig;
@@ -312,18 +354,26 @@ seahorse_ldap_gsource_prepare (GSource *gsource,
 {
     SeahorseLdapGSource *ldap_gsource = (SeahorseLdapGSource *)gsource;
 
-    if (ldap_gsource->cancelled)
+    /* Cancelled, or libldap might still have results queued up */
+    if (ldap_gsource->cancelled || ldap_gsource->pending)
         return TRUE;
 
-    /* No other way, but to poll */
-    *timeout = 50;
+    /* Wait for data on the connection, or else fall back to polling */
+    *timeout = ldap_gsource->fd_tag ? -1 : FALLBACK_POLL_INTERVAL;
     return FALSE;
 }
 
 static gboolean
 seahorse_ldap_gsource_check (GSource *gsource)
 {
-    return TRUE;
+    SeahorseLdapGSource *ldap_gsource = (SeahorseLdapGSource *)gsource;
+
+    if (ldap_gsource->cancelled || ldap_gsource->pending)
+        return TRUE;
+    if (!ldap_gsource->fd_tag)
+        return TRUE;
+
+    return g_source_query_unix_fd (gsource, ldap_gsource->fd_tag) != 0;
 }
 
 static gboolean
@@ -337,26 +387,34 @@ seahorse_ldap_gsource_dispatch (GSource *gsource,
     gboolean ret;
     int rc, i;
 
+    /* Note that all our callbacks get passed the GTask of the operation */
     if (ldap_gsource->cancelled) {
-        ((SeahorseLdapCallback)callback) (NULL, user_data);
-        return FALSE;
+        g_task_return_error_if_cancelled (G_TASK (user_data));
+        return G_SOURCE_REMOVE;
     }
 
+    ldap_gsource->pending = FALSE;
+
     for (i = 0; i < DEFAULT_LOAD_BATCH; i++) {
 
-        /* This effects a poll */
+        /* This doesn't block: either a message is ready or we wait again */
         timeout.tv_sec = 0;
         timeout.tv_usec = 0;
 
         rc = ldap_result (ldap_gsource->ldap, ldap_gsource->ldap_op,
                           0, &timeout, &result);
         if (rc == -1) {
+            int code = LDAP_OTHER;
+
+            ldap_get_option (ldap_gsource->ldap, LDAP_OPT_RESULT_CODE, &code);
             g_warning ("ldap_result failed with rc = %d, errno = %s",
                        rc, g_strerror (errno));
+            g_task_return_new_error (G_TASK (user_data), LDAP_ERROR_DOMAIN, code,
+                                     "%s", ldap_err2string (code));
             return G_SOURCE_REMOVE;
         }
 
-        /* Timeout */
+        /* Nothing complete yet, wait for more data on the connection */
         if (rc == 0)
             return G_SOURCE_CONTINUE;
 
@@ -367,6 +425,9 @@ seahorse_ldap_gsource_dispatch (GSource *gsource,
             return G_SOURCE_REMOVE;
     }
 
+    /* We stopped to let others run; the rest might already be read into
+     * libldap's buffers, so don't wait for the socket before continuing */
+    ldap_gsource->pending = TRUE;
     return G_SOURCE_CONTINUE;
 }
 
@@ -392,6 +453,9 @@ on_ldap_gsource_cancelled (GCancellable *cancellable,
 {
     SeahorseLdapGSource *ldap_gsource = user_data;
     ldap_gsource->cancelled = TRUE;
+
+    /* We might be blocked waiting on the socket, possibly in another thread */
+    g_main_context_wakeup (g_source_get_context ((GSource *) ldap_gsource));
 }
 
 static GSource *
@@ -401,6 +465,7 @@ seahorse_ldap_gsource_new (LDAP *ldap,
 {
     GSource *gsource;
     SeahorseLdapGSource *ldap_gsource;
+    int fd = -1;
 
     gsource = g_source_new (&seahorse_ldap_gsource_funcs,
                             sizeof (SeahorseLdapGSource));
@@ -409,6 +474,12 @@ seahorse_ldap_gsource_new (LDAP *ldap,
     ldap_gsource->ldap = ldap;
     ldap_gsource->ldap_op = ldap_op;
 
+    /* The connection is set up by now, since an operation was started */
+    if (ldap_get_option (ldap, LDAP_OPT_DESC, &fd) == LDAP_OPT_SUCCESS && fd >= 0)
+        ldap_gsource->fd_tag = g_source_add_unix_fd (gsource, fd, G_IO_IN | G_IO_HUP | G_IO_ERR);
+    else
+        g_debug ("Couldn't get LDAP connection descriptor, falling back to polling");
+
     if (cancellable) {
         ldap_gsource->cancellable = g_object_ref (cancellable);
         ldap_gsource->cancelled_sig = g_cancellable_connect (cancellable,
@@ -494,6 +565,10 @@ on_connect_server_info_completed (LDAPMessage *result,
 
     ldap_memfree (message);
 
+    /* Remember the defaults if the server didn't tell us, so we don't ask
+     * again for every connection */
+    get_ldap_server_info (self, TRUE);
+
     g_task_return_pointer (task, g_steal_pointer (&closure->ldap), destroy_ldap);
     return G_SOURCE_REMOVE;
 }
@@ -618,6 +693,72 @@ on_address_resolved (GObject      *src_object,
     g_source_attach (gsource, g_main_context_default ());
 }
 
+static gboolean
+on_idle_connection_timeout (gpointer user_data)
+{
+    SeahorseLDAPSource *self = SEAHORSE_LDAP_SOURCE (user_data);
+
+    g_debug ("Closing idle LDAP connection");
+    self->idle_timeout_id = 0;
+    g_clear_pointer (&self->idle_ldap, destroy_ldap);
+    return G_SOURCE_REMOVE;
+}
+
+/* Hands a connection back once an operation completed successfully, so that
+ * the next operation doesn't need to resolve, connect and bind again */
+static void
+seahorse_ldap_source_release_connection (SeahorseLDAPSource *self,
+                                         LDAP               *ldap)
+{
+    if (ldap == NULL)
+        return;
+
+    /* We only keep one around */
+    if (self->idle_ldap != NULL) {
+        ldap_unbind_ext (ldap, NULL, NULL);
+        return;
+    }
+
+    self->idle_ldap = ldap;
+    g_clear_handle_id (&self->idle_timeout_id, g_source_remove);
+    self->idle_timeout_id = g_timeout_add_seconds (CONNECTION_IDLE_TIMEOUT,
+                                                   on_idle_connection_timeout,
+                                                   self);
+}
+
+/* An idle connection shouldn't have anything to read. If it has, the server
+ * closed it (or sent a notice of disconnection), so we can't use it anymore */
+static gboolean
+ldap_connection_is_alive (LDAP *ldap)
+{
+    struct pollfd pfd;
+    int fd = -1;
+
+    if (ldap_get_option (ldap, LDAP_OPT_DESC, &fd) != LDAP_OPT_SUCCESS || fd < 0)
+        return FALSE;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll (&pfd, 1, 0) == 0;
+}
+
+static LDAP *
+seahorse_ldap_source_steal_idle_connection (SeahorseLDAPSource *self)
+{
+    LDAP *ldap;
+
+    g_clear_handle_id (&self->idle_timeout_id, g_source_remove);
+    ldap = g_steal_pointer (&self->idle_ldap);
+
+    if (ldap != NULL && !ldap_connection_is_alive (ldap)) {
+        g_debug ("Idle LDAP connection was closed, reconnecting");
+        g_clear_pointer (&ldap, destroy_ldap);
+    }
+
+    return ldap;
+}
+
 static void
 seahorse_ldap_source_connect_async (SeahorseLDAPSource *source,
                                     GCancellable *cancellable,
@@ -637,6 +778,13 @@ seahorse_ldap_source_connect_async (SeahorseLDAPSource *source,
     closure = g_new0 (ConnectClosure, 1);
     g_task_set_task_data (task, closure, connect_closure_free);
 
+    /* Reuse a previous connection (and its server info) if we can */
+    closure->ldap = seahorse_ldap_source_steal_idle_connection (source);
+    if (closure->ldap != NULL) {
+        g_task_return_pointer (task, g_steal_pointer (&closure->ldap), destroy_ldap);
+        return;
+    }
+
     /* Take the URI & turn it into a GNetworkAddress, to do address resolving */
     uri = seahorse_place_get_uri (SEAHORSE_PLACE (source));
     g_return_if_fail (uri && uri[0]);
@@ -675,10 +823,23 @@ seahorse_ldap_source_init (SeahorseLDAPSource *self)
 {
 }
 
+static void
+seahorse_ldap_source_finalize (GObject *obj)
+{
+    SeahorseLDAPSource *self = SEAHORSE_LDAP_SOURCE (obj);
+
+    g_clear_handle_id (&self->idle_timeout_id, g_source_remove);
+    g_clear_pointer (&self->idle_ldap, destroy_ldap);
+
+    G_OBJECT_CLASS (seahorse_ldap_source_parent_class)->finalize (obj);
+}
+
 typedef struct {
     char *filter;
     LDAP *ldap;
     GListStore *results;
+    GPtrArray *keys;            /* Keys of the current page, not yet in results */
+    struct berval cookie;       /* Where the server should continue (RFC 2696) */
 } SearchClosure;
 
 static void
@@ -686,7 +847,10 @@ search_closure_free (gpointer data)
 {
     SearchClosure *closure = data;
     g_clear_object (&closure->results);
+    g_clear_pointer (&closure->keys, g_ptr_array_unref);
     g_free (closure->filter);
+    if (closure->cookie.bv_val)
+        ber_memfree (closure->cookie.bv_val);
     if (closure->ldap)
         ldap_unbind_ext (closure->ldap, NULL, NULL);
     g_free (closure);
@@ -707,7 +871,7 @@ static const char *PGP_ATTRIBUTES[] = {
 /* Add a key to the key source from an LDAP entry */
 static void
 search_parse_key_from_ldap_entry (SeahorseLDAPSource *self,
-                                  GListStore         *results,
+                                  GPtrArray          *keys,
                                   LDAP               *ldap,
                                   LDAPMessage        *res)
 {
@@ -776,10 +940,57 @@ search_parse_key_from_ldap_entry (SeahorseLDAPSource *self,
         seahorse_item_set_place (SEAHORSE_ITEM (key), SEAHORSE_PLACE (self));
         seahorse_pgp_key_set_item_flags (key, flags);
 
-        g_list_store_append (results, key);
+        g_ptr_array_add (keys, g_steal_pointer (&key));
     }
 }
 
+/* Adds the keys we have so far to the results in one go */
+static void
+search_flush_keys (SearchClosure *closure)
+{
+    if (closure->keys->len == 0)
+        return;
+
+    g_list_store_splice (closure->results,
+                         g_list_model_get_n_items (G_LIST_MODEL (closure->results)),
+                         0, closure->keys->pdata, closure->keys->len);
+    g_ptr_array_set_size (closure->keys, 0);
+}
+
+/* Returns whether the server has more results for us, updating the cookie */
+static gboolean
+search_parse_page_control (SearchClosure *closure,
+                           LDAPControl  **ctrls)
+{
+    LDAPControl *ctrl;
+    ber_int_t count;
+    struct berval cookie = { 0, NULL };
+
+    if (closure->cookie.bv_val)
+        ber_memfree (closure->cookie.bv_val);
+    closure->cookie.bv_val = NULL;
+    closure->cookie.bv_len = 0;
+
+    /* Servers that don't support paging just send everything at once */
+    ctrl = ldap_control_find (LDAP_CONTROL_PAGEDRESULTS, ctrls, NULL);
+    if (ctrl == NULL)
+        return FALSE;
+
+    if (ldap_parse_pageresponse_control (closure->ldap, ctrl, &count, &cookie) != LDAP_SUCCESS)
+        return FALSE;
+
+    /* An empty cookie means this was the last page */
+    if (cookie.bv_len == 0) {
+        ber_memfree (cookie.bv_val);
+        return FALSE;
+    }
+
+    closure->cookie = cookie;
+    return TRUE;
+}
+
+static void search_request_page (SeahorseLDAPSource *self, GTask *task);
+
 static gboolean
 on_search_search_completed (LDAPMessage *result,
                             gpointer user_data)
@@ -787,8 +998,9 @@ on_search_search_completed (LDAPMessage *result,
     GTask *task = G_TASK (user_data);
     SeahorseLDAPSource *self = SEAHORSE_LDAP_SOURCE (g_task_get_source_object (task));
     SearchClosure *closure = g_task_get_task_data (task);
-    GCancellable *cancellable = g_task_get_cancellable (task);
     g_autoptr(GError) error = NULL;
+    LDAPControl **ctrls = NULL;
+    gboolean more;
     int type;
     int rc;
     int code;
@@ -804,64 +1016,82 @@ on_search_search_completed (LDAPMessage *result,
         dump_ldap_entry (closure->ldap, result);
 #endif
 
-        search_parse_key_from_ldap_entry (self, closure->results,
+        search_parse_key_from_ldap_entry (self, closure->keys,
                                           closure->ldap, result);
+
+        /* Don't hold back too much if the server doesn't do paging */
+        if (closure->keys->len >= SEARCH_PAGE_SIZE)
+            search_flush_keys (closure);
+
         return G_SOURCE_CONTINUE;
     }
 
-    /* All entries done */
+    /* The page is done, show what we have */
+    search_flush_keys (closure);
+
     rc = ldap_parse_result (closure->ldap, result, &code, NULL,
-                            &message, NULL, NULL, 0);
+                            &message, NULL, &ctrls, 0);
     g_return_val_if_fail (rc == LDAP_SUCCESS, FALSE);
 
+    more = search_parse_page_control (closure, ctrls);
+    ldap_controls_free (ctrls);
+
     /* Error codes that we ignore */
     switch (code) {
     case LDAP_SIZELIMIT_EXCEEDED:
         code = LDAP_SUCCESS;
+        more = FALSE;
         break;
     };
 
-    if (code != LDAP_SUCCESS)
+    if (code != LDAP_SUCCESS) {
         g_task_return_new_error (task, LDAP_ERROR_DOMAIN, code, "%s", message);
-    else if (seahorse_ldap_source_propagate_error (self, code, &error))
+    } else if (seahorse_ldap_source_propagate_error (self, code, &error)) {
         g_task_return_error (task, g_steal_pointer (&error));
-    else
+    } else if (more) {
+        /* Only ask for the next page if we're still wanted */
+        if (!g_task_return_error_if_cancelled (task))
+            search_request_page (self, task);
+    } else {
+        seahorse_ldap_source_release_connection (self, g_steal_pointer (&closure->ldap));
         g_task_return_boolean (task, TRUE);
+    }
 
     ldap_memfree (message);
 
     return G_SOURCE_REMOVE;
 }
 
+/* Asks the server for the next page of results (or the first one) */
 static void
-on_search_connect_completed (GObject *source,
-                             GAsyncResult *result,
-                             gpointer user_data)
+search_request_page (SeahorseLDAPSource *self,
+                     GTask              *task)
 {
-    SeahorseLDAPSource *self = SEAHORSE_LDAP_SOURCE (source);
-    g_autoptr(GTask) task = G_TASK (user_data);
     SearchClosure *closure = g_task_get_task_data (task);
     GCancellable *cancellable = g_task_get_cancellable (task);
     g_autoptr(GError) error = NULL;
     LDAPServerInfo *sinfo;
+    LDAPControl *ctrls[2] = { NULL, NULL };
     int ldap_op;
     int rc;
     g_autoptr(GSource) gsource = NULL;
 
-    closure->ldap = seahorse_ldap_source_connect_finish (self, result, &error);
-    if (error != NULL) {
-        g_task_return_error (task, g_steal_pointer (&error));
-        return;
-    }
-
     sinfo = get_ldap_server_info (self, TRUE);
 
     g_debug ("Searching Server ... base: %s, filter: %s",
              sinfo->base_dn, closure->filter);
 
+    /* Not critical: servers without paging support send all results */
+    rc = ldap_create_page_control (closure->ldap, SEARCH_PAGE_SIZE,
+                                   &closure->cookie, 0, &ctrls[0]);
+    if (rc != LDAP_SUCCESS)
+        g_debug ("Couldn't create paged results control: %s", ldap_err2string (rc));
+
     rc = ldap_search_ext (closure->ldap, sinfo->base_dn, LDAP_SCOPE_SUBTREE,
                           closure->filter, (char **)PGP_ATTRIBUTES, 0,
-                          NULL, NULL, NULL, 0, &ldap_op);
+                          ctrls[0] ? ctrls : NULL, NULL, NULL, 0, &ldap_op);
+    if (ctrls[0])
+        ldap_control_free (ctrls[0]);
 
     if (seahorse_ldap_source_propagate_error (self, rc, &error)) {
         g_task_return_error (task, g_steal_pointer (&error));
@@ -870,10 +1100,28 @@ on_search_connect_completed (GObject *source,
 
     gsource = seahorse_ldap_gsource_new (closure->ldap, ldap_op, cancellable);
     g_source_set_callback (gsource, G_SOURCE_FUNC (on_search_search_completed),
-                           g_steal_pointer (&task), g_object_unref);
+                           g_object_ref (task), g_object_unref);
     g_source_attach (gsource, g_main_context_default ());
 }
 
+static void
+on_search_connect_completed (GObject *source,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+    SeahorseLDAPSource *self = SEAHORSE_LDAP_SOURCE (source);
+    g_autoptr(GTask) task = G_TASK (user_data);
+    SearchClosure *closure = g_task_get_task_data (task);
+    g_autoptr(GError) error = NULL;
+
+    closure->ldap = seahorse_ldap_source_connect_finish (self, result, &error);
+    if (error != NULL) {
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    search_request_page (self, task);
+}
 
 static void
 seahorse_ldap_source_search_async (SeahorseServerSource *source,
@@ -892,6 +1140,7 @@ seahorse_ldap_source_search_async (SeahorseServerSource *source,
     g_task_set_source_tag (task, seahorse_ldap_source_search_async);
     closure = g_new0 (SearchClosure, 1);
     closure->results = g_object_ref (results);
+    closure->keys = g_ptr_array_new_with_free_func (g_object_unref);
     text = escape_ldap_value (match);
     closure->filter = g_strdup_printf ("(pgpuserid=*%s*)", text);
     g_task_set_task_data (task, closure, search_closure_free);
@@ -913,8 +1162,7 @@ seahorse_ldap_source_search_finish (SeahorseServerSource *source,
 }
 
 typedef struct {
-    GPtrArray *keydatas;
-    int current_index;
+    SeahorseArmorScanner *scanner;
     LDAP *ldap;
 } ImportClosure;
 
@@ -922,13 +1170,13 @@ static void
 import_closure_free (gpointer data)
 {
     ImportClosure *closure = data;
-    g_ptr_array_free (closure->keydatas, TRUE);
+    g_clear_object (&closure->scanner);
     if (closure->ldap)
         ldap_unbind_ext (closure->ldap, NULL, NULL);
     g_free (closure);
 }
 
-static void import_send_key (SeahorseLDAPSource *self, GTask *task);
+static void import_read_key (SeahorseLDAPSource *self, GTask *task);
 
 /* Called when results come in for a key send */
 static gboolean
@@ -960,39 +1208,29 @@ on_import_add_completed (LDAPMessage *result,
         return G_SOURCE_REMOVE;
     }
 
-    import_send_key (self, task);
+    import_read_key (self, task);
     return G_SOURCE_REMOVE;
 }
 
 static void
-import_send_key (SeahorseLDAPSource *self, GTask *task)
+import_send_key (SeahorseLDAPSource *self,
+                 GTask              *task,
+                 GBytes             *block)
 {
     ImportClosure *closure = g_task_get_task_data (task);
     GCancellable *cancellable = g_task_get_cancellable (task);
     LDAPServerInfo *sinfo;
     g_autofree char *base = NULL;
+    g_autofree char *keydata = NULL;
     LDAPMod mod;
     LDAPMod *attrs[2];
     char *values[2];
     g_autoptr(GSource) gsource = NULL;
     GError *error = NULL;
-    char *keydata;
     int ldap_op;
     int rc;
 
-    if (closure->current_index >= 0) {
-        keydata = g_ptr_array_index (closure->keydatas, closure->current_index);
-    }
-
-    closure->current_index++;
-
-    /* All done, complete operation */
-    if (closure->current_index == (int) closure->keydatas->len) {
-        g_task_return_boolean (task, TRUE);
-        return;
-    }
-
-    keydata = g_ptr_array_index (closure->keydatas, closure->current_index);
+    keydata = g_strndup (g_bytes_get_data (block, NULL), g_bytes_get_size (block));
     values[0] = keydata;
     values[1] = NULL;
 
@@ -1019,6 +1257,48 @@ import_send_key (SeahorseLDAPSource *self, GTask *task)
     g_source_attach (gsource, g_main_context_default ());
 }
 
+static void
+on_import_key_read (GObject      *object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+    g_autoptr(GTask) task = G_TASK (user_data);
+    SeahorseLDAPSource *self = SEAHORSE_LDAP_SOURCE (g_task_get_source_object (task));
+    g_autoptr(GBytes) block = NULL;
+    g_autoptr(GError) error = NULL;
+
+    block = seahorse_armor_scanner_next_finish (SEAHORSE_ARMOR_SCANNER (object),
+                                                result, &error);
+    if (error != NULL) {
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    /* All done, complete operation */
+    if (block == NULL) {
+        ImportClosure *closure = g_task_get_task_data (task);
+
+        seahorse_ldap_source_release_connection (self, g_steal_pointer (&closure->ldap));
+        g_task_return_boolean (task, TRUE);
+        return;
+    }
+
+    import_send_key (self, task, block);
+}
+
+/* Streams the next key from the input, and sends it off when read */
+static void
+import_read_key (SeahorseLDAPSource *self,
+                 GTask              *task)
+{
+    ImportClosure *closure = g_task_get_task_data (task);
+
+    seahorse_armor_scanner_next_async (closure->scanner,
+                                       g_task_get_cancellable (task),
+                                       on_import_key_read,
+                                       g_object_ref (task));
+}
+
 static void
 on_import_connect_completed (GObject *source,
                              GAsyncResult *result,
@@ -1035,7 +1315,7 @@ on_import_connect_completed (GObject *source,
         return;
     }
 
-    import_send_key (self, task);
+    import_read_key (self, task);
 }
 
 static void
@@ -1053,24 +1333,11 @@ seahorse_ldap_source_import_async (SeahorseServerSource *source,
     g_task_set_source_tag (task, seahorse_ldap_source_import_async);
 
     closure = g_new0 (ImportClosure, 1);
-    closure->current_index = -1;
+    closure->scanner = seahorse_armor_scanner_new (input,
+                                                   SEAHORSE_ARMOR_PGP_PUBLIC_KEY_BEGIN,
+                                                   SEAHORSE_ARMOR_PGP_PUBLIC_KEY_END);
     g_task_set_task_data (task, closure, import_closure_free);
 
-    closure->keydatas = g_ptr_array_new_with_free_func (g_free);
-    for (;;) {
-        g_autoptr(GString) buf = g_string_sized_new (2048);
-        guint len;
-        g_autofree char *keydata = NULL;
-
-        len = seahorse_util_read_data_block (buf, input, "-----BEGIN PGP PUBLIC KEY BLOCK-----",
-                                             "-----END PGP PUBLIC KEY BLOCK-----");
-        if (len <= 0)
-            break;
-
-        keydata = g_string_free (g_steal_pointer (&buf), FALSE);
-        g_ptr_array_add (closure->keydatas, g_steal_pointer (&keydata));
-    }
-
     seahorse_ldap_source_connect_async (self, cancellable,
                                         on_import_connect_completed,
                                         g_steal_pointer (&task));
@@ -1092,9 +1359,13 @@ seahorse_ldap_source_import_finish (SeahorseServerSource *source,
     return NULL;
 }
 
+/* Amount of keys we ask for in one search when exporting. Keeps the filter
+ * at a size that servers are happy with. */
+#define EXPORT_BATCH_SIZE 100
+
 typedef struct {
-    GPtrArray *fingerprints;
-    int current_index;
+    GPtrArray *keyids;
+    unsigned int next_index;
     GString *data;
     LDAP *ldap;
 } ExportClosure;
@@ -1103,7 +1374,7 @@ static void
 export_closure_free (gpointer data)
 {
     ExportClosure *closure = data;
-    g_ptr_array_free (closure->fingerprints, TRUE);
+    g_ptr_array_free (closure->keyids, TRUE);
     if (closure->data)
         g_string_free (closure->data, TRUE);
     if (closure->ldap)
@@ -1111,7 +1382,7 @@ export_closure_free (gpointer data)
     g_free (closure);
 }
 
-static void     export_retrieve_key     (SeahorseLDAPSource *self,
+static void     export_retrieve_keys    (SeahorseLDAPSource *self,
                                          GTask *task);
 
 static gboolean
@@ -1134,23 +1405,26 @@ on_export_search_completed (LDAPMessage *result,
 
     /* An LDAP Entry */
     if (type == LDAP_RES_SEARCH_ENTRY) {
-        g_autofree char *key = NULL;
+        struct berval **values;
 
-        g_debug ("Server Info Result");
+        g_debug ("Key Data Result");
 #ifdef WITH_DEBUG
         dump_ldap_entry (closure->ldap, result);
 #endif
 
-        key = get_string_attribute (closure->ldap, result, sinfo->key_attr);
-        if (key == NULL) {
+        /* Append the key data straight from the message */
+        values = ldap_get_values_len (closure->ldap, result, sinfo->key_attr);
+        if (values == NULL || values[0] == NULL) {
             g_warning ("key server missing pgp key data");
+            ldap_value_free_len (values);
             seahorse_ldap_source_propagate_error (self, LDAP_NO_SUCH_OBJECT, &error);
             g_task_return_error (task, g_steal_pointer (&error));
             return G_SOURCE_REMOVE;
         }
 
-        g_string_append (closure->data, key);
+        g_string_append_len (closure->data, values[0]->bv_val, values[0]->bv_len);
         g_string_append_c (closure->data, '\n');
+        ldap_value_free_len (values);
 
         return G_SOURCE_CONTINUE;
     }
@@ -1159,61 +1433,62 @@ on_export_search_completed (LDAPMessage *result,
     rc = ldap_parse_result (closure->ldap, result, &code, NULL,
                             &message, NULL, NULL, 0);
     g_return_val_if_fail (rc == LDAP_SUCCESS, FALSE);
+    ldap_memfree (message);
 
     if (seahorse_ldap_source_propagate_error (self, code, &error)) {
         g_task_return_error (task, g_steal_pointer (&error));
         return G_SOURCE_REMOVE;
     }
 
-    ldap_memfree (message);
-
     /* Process more keys if possible */
-    export_retrieve_key (self, task);
+    export_retrieve_keys (self, task);
     return G_SOURCE_REMOVE;
 }
 
+/* Retrieves the next batch of keys with a single search */
 static void
-export_retrieve_key (SeahorseLDAPSource *self,
-                     GTask *task)
+export_retrieve_keys (SeahorseLDAPSource *self,
+                      GTask *task)
 {
     ExportClosure *closure = g_task_get_task_data (task);
     GCancellable *cancellable = g_task_get_cancellable (task);
     LDAPServerInfo *sinfo;
-    g_autofree char *filter = NULL;
+    g_autoptr(GString) filter = NULL;
     char *attrs[2];
     g_autoptr(GSource) gsource = NULL;
-    const char *fingerprint;
     g_autoptr(GError) error = NULL;
-    int length, rc;
+    unsigned int n_keyids;
+    int rc;
     int ldap_op;
 
-    if (closure->current_index > 0) {
-        fingerprint = g_ptr_array_index (closure->fingerprints,
-                                         closure->current_index);
-    }
-
-    closure->current_index++;
-
     /* All done, complete operation */
-    if (closure->current_index == (int) closure->fingerprints->len) {
+    if (closure->next_index >= closure->keyids->len) {
+        seahorse_ldap_source_release_connection (self, g_steal_pointer (&closure->ldap));
         g_task_return_boolean (task, TRUE);
         return;
     }
 
-    fingerprint = g_ptr_array_index (closure->fingerprints,
-                                     closure->current_index);
-    length = strlen (fingerprint);
-    if (length > 16)
-        fingerprint += (length - 16);
+    n_keyids = MIN (EXPORT_BATCH_SIZE, closure->keyids->len - closure->next_index);
+
+    filter = g_string_new (NULL);
+    if (n_keyids > 1)
+        g_string_append (filter, "(|");
+    for (unsigned int i = 0; i < n_keyids; i++) {
+        const char *keyid = g_ptr_array_index (closure->keyids, closure->next_index + i);
+        g_string_append_printf (filter, "(pgpcertid=%s)", keyid);
+    }
+    if (n_keyids > 1)
+        g_string_append_c (filter, ')');
+
+    closure->next_index += n_keyids;
 
-    filter = g_strdup_printf ("(pgpcertid=%.16s)", fingerprint);
     sinfo = get_ldap_server_info (self, TRUE);
 
     attrs[0] = sinfo->key_attr;
     attrs[1] = NULL;
 
     rc = ldap_search_ext (closure->ldap, sinfo->base_dn, LDAP_SCOPE_SUBTREE,
-                          filter, attrs, 0,
+                          filter->str, attrs, 0,
                           NULL, NULL, NULL, 0, &ldap_op);
 
     if (seahorse_ldap_source_propagate_error (self, rc, &error)) {
@@ -1243,7 +1518,7 @@ on_export_connect_completed (GObject *source,
         return;
     }
 
-    export_retrieve_key (self, task);
+    export_retrieve_keys (self, task);
 }
 
 static void
@@ -1262,13 +1537,17 @@ seahorse_ldap_source_export_async (SeahorseServerSource  *source,
 
     closure = g_new0 (ExportClosure, 1);
     closure->data = g_string_sized_new (1024);
-    closure->fingerprints = g_ptr_array_new_with_free_func (g_free);
+    closure->keyids = g_ptr_array_new_with_free_func (g_free);
     for (int i = 0; keyids[i] != NULL; i++) {
-        char *fingerprint = g_strdup (keyids[i]);
+        const char *keyid = keyids[i];
+        size_t length = strlen (keyid);
 
-        g_ptr_array_add (closure->fingerprints, fingerprint);
+        /* The server knows keys by their 64-bit key ID */
+        if (length > 16)
+            keyid += (length - 16);
+
+        g_ptr_array_add (closure->keyids, escape_ldap_filter_value (keyid));
     }
-    closure->current_index = -1;
     g_task_set_task_data (task, closure, export_closure_free);
 
     seahorse_ldap_source_connect_async (self, cancellable,
@@ -1296,8 +1575,11 @@ seahorse_ldap_source_export_finish (SeahorseServerSource *source,
 static void
 seahorse_ldap_source_class_init (SeahorseLDAPSourceClass *klass)
 {
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
     SeahorseServerSourceClass *server_class = SEAHORSE_SERVER_SOURCE_CLASS (klass);
 
+    gobject_class->finalize = seahorse_ldap_source_finalize;
+
     server_class->search_async = seahorse_ldap_source_search_async;
     server_class->search_finish = seahorse_ldap_source_search_finish;
     server_class->export_async = seahorse_ldap_source_export_async;
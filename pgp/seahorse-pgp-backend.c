@@ -21,6 +21,8 @@
 #include "config.h"
 
 #include "seahorse-gpgme-dialogs.h"
+#include "seahorse-keyserver-publish.h"
+#include "seahorse-keyserver-refresh.h"
 #include "seahorse-pgp-actions.h"
 #include "seahorse-pgp-backend.h"
 #include "seahorse-server-source.h"
@@ -29,11 +31,11 @@
 
 #include "seahorse-common.h"
 
+#include "libseahorse/seahorse-armor-scanner.h"
 #include "libseahorse/seahorse-progress.h"
 #include "libseahorse/seahorse-util.h"
 
 #include <glib/gi18n.h>
-#include <locale.h>
 
 #include <string.h>
 
@@ -49,6 +51,8 @@ struct _SeahorsePgpBackend {
     SeahorseDiscovery *discovery;
     SeahorseUnknownSource *unknown;
     GListModel *remotes;
+    SeahorseKeyserverRefresh *refresh;
+    SeahorseKeyserverPublish *publish;
     SeahorseActionGroup *actions;
     gboolean loaded;
 };
@@ -132,6 +136,39 @@ on_settings_keyservers_changed (GSettings  *settings,
         const char *uri = g_ptr_array_index (check, i);
         seahorse_pgp_backend_remove_remote (self, uri);
     }
+
+    /* Keys missing on the old servers might be on the new ones */
+    seahorse_unknown_source_set_servers (self->unknown, (const char * const *) keyservers);
+}
+
+static void
+on_app_settings_refresh_days_changed (GSettings  *settings,
+                                      const char *key,
+                                      void       *user_data)
+{
+    SeahorsePgpBackend *self = SEAHORSE_PGP_BACKEND (user_data);
+    unsigned int days;
+
+    days = seahorse_app_settings_get_server_refresh_days (SEAHORSE_APP_SETTINGS (settings));
+    seahorse_keyserver_refresh_set_window (self->refresh, days * G_TIME_SPAN_DAY);
+}
+
+static void
+on_publish_failed (SeahorseKeyserverPublish *publish,
+                   const char               *uri,
+                   unsigned int              n_keys,
+                   GError                   *error,
+                   void                     *user_data)
+{
+    g_autofree char *heading = NULL;
+    g_autofree char *message = NULL;
+
+    heading = g_strdup_printf (ngettext ("Couldn’t publish %u key to %s",
+                                         "Couldn’t publish %u keys to %s",
+                                         n_keys),
+                               n_keys, uri);
+    message = g_strdup_printf (_("%s\n\nSeahorse will try again later."), error->message);
+    seahorse_util_show_error (NULL, heading, message);
 }
 
 #endif /* WITH_KEYSERVER */
@@ -163,6 +200,10 @@ static void
 seahorse_pgp_backend_constructed (GObject *obj)
 {
     SeahorsePgpBackend *self = SEAHORSE_PGP_BACKEND (obj);
+#ifdef WITH_KEYSERVER
+    g_autofree char *refresh_state = NULL;
+    g_autofree char *publish_state = NULL;
+#endif
 
     G_OBJECT_CLASS (seahorse_pgp_backend_parent_class)->constructed (obj);
 
@@ -184,6 +225,31 @@ seahorse_pgp_backend_constructed (GObject *obj)
     on_settings_keyservers_changed (G_SETTINGS (self->pgp_settings),
                                     "keyservers",
                                     self);
+
+    /* Keep the keys up to date in the background, if wanted */
+    refresh_state = g_build_filename (g_get_user_data_dir (), "seahorse",
+                                      "keyserver-refresh", NULL);
+    self->refresh = seahorse_keyserver_refresh_new (G_LIST_MODEL (self->keyring),
+                                                    self->remotes,
+                                                    SEAHORSE_PLACE (self->keyring),
+                                                    refresh_state);
+    g_signal_connect_object (seahorse_app_settings_instance (),
+                             "changed::server-refresh-days",
+                             G_CALLBACK (on_app_settings_refresh_days_changed),
+                             self, 0);
+    on_app_settings_refresh_days_changed (G_SETTINGS (seahorse_app_settings_instance ()),
+                                          "server-refresh-days",
+                                          self);
+
+    /* Keys to publish wait here until a server accepted them */
+    publish_state = g_build_filename (g_get_user_data_dir (), "seahorse",
+                                      "publish-queue", NULL);
+    self->publish = seahorse_keyserver_publish_new (SEAHORSE_PLACE (self->keyring),
+                                                    G_LIST_MODEL (self->keyring),
+                                                    self->remotes,
+                                                    publish_state);
+    g_signal_connect (self->publish, "failed",
+                      G_CALLBACK (on_publish_failed), self);
 #endif
 }
 
@@ -289,6 +355,8 @@ seahorse_pgp_backend_finalize (GObject *obj)
 #ifdef WITH_KEYSERVER
     g_signal_handlers_disconnect_by_func (self->pgp_settings,
                                           on_settings_keyservers_changed, self);
+    g_clear_object (&self->refresh);
+    g_clear_object (&self->publish);
 #endif
 
     g_clear_pointer (&self->gpg_homedir, g_free);
@@ -468,6 +536,23 @@ seahorse_pgp_backend_get_remotes (SeahorsePgpBackend *self)
     return self->remotes;
 }
 
+/**
+ * seahorse_pgp_backend_get_publish_queue:
+ * @self: A #SeahorsePgpBackend
+ *
+ * Returns the queue of keys waiting to be published to a key server
+ *
+ * Returns: (transfer none):
+ */
+SeahorseKeyserverPublish *
+seahorse_pgp_backend_get_publish_queue (SeahorsePgpBackend *self)
+{
+    self = self ? self : seahorse_pgp_backend_get ();
+    g_return_val_if_fail (SEAHORSE_PGP_IS_BACKEND (self), NULL);
+
+    return self->publish;
+}
+
 SeahorseServerSource *
 seahorse_pgp_backend_lookup_remote (SeahorsePgpBackend *self,
                                     const char         *uri)
@@ -536,17 +621,197 @@ seahorse_pgp_backend_remove_remote (SeahorsePgpBackend *self,
     seahorse_pgp_settings_remove_keyserver (self->pgp_settings, uri);
 }
 
+/* How long we wait for a single key server before giving up on it. We keep
+ * whatever it found until then. */
+#define SEARCH_SERVER_DEADLINE_SECONDS 20
+
+typedef struct _search_remote_closure search_remote_closure;
+
+/* The search on a single key server */
 typedef struct {
+    search_remote_closure *closure;
+    SeahorseServerSource *source;
+    GListStore *results;            /* What this server found */
+    GCancellable *cancellable;
+    gulong changed_sig;
+    unsigned int deadline_id;
+    int64_t started;
+    int64_t first_result;
+    gboolean timed_out;
+} server_search;
+
+/* A key in the results, and where it is, so it can be replaced quickly */
+typedef struct {
+    SeahorsePgpKey *key;
+    unsigned int position;
+} merged_key;
+
+struct _search_remote_closure {
+    GListStore *results;
+    SeahorseUnknownSource *unknown;
+    GHashTable *by_fingerprint;     /* Fingerprint -> merged_key */
+    GPtrArray *servers;
+    GCancellable *cancellable;
+    gulong cancelled_sig;
     int num_searches;
-} search_remote_closure;
+    int num_succeeded;
+    GError *error;                  /* The first failure */
+};
+
+static void
+server_search_stop (server_search *search)
+{
+    g_clear_handle_id (&search->deadline_id, g_source_remove);
+    g_clear_signal_handler (&search->changed_sig, search->results);
+}
+
+static void
+server_search_free (void *user_data)
+{
+    server_search *search = user_data;
+
+    server_search_stop (search);
+    g_clear_object (&search->results);
+    g_clear_object (&search->cancellable);
+    g_clear_object (&search->source);
+    g_free (search);
+}
+
+static void
+merged_key_free (void *user_data)
+{
+    merged_key *merged = user_data;
+
+    g_clear_object (&merged->key);
+    g_free (merged);
+}
 
 static void
 search_remote_closure_free (void *user_data)
 {
     search_remote_closure *closure = user_data;
+
+    if (closure->cancelled_sig)
+        g_cancellable_disconnect (closure->cancellable, closure->cancelled_sig);
+    g_clear_object (&closure->cancellable);
+    g_ptr_array_unref (closure->servers);
+    g_hash_table_unref (closure->by_fingerprint);
+    g_clear_object (&closure->results);
+    g_clear_object (&closure->unknown);
+    g_clear_error (&closure->error);
     g_free (closure);
 }
 
+/* Servers format fingerprints differently, so compare them without spaces */
+static char *
+normalize_fingerprint (const char *fingerprint)
+{
+    GString *result;
+
+    result = g_string_sized_new (40);
+    for (const char *p = fingerprint; *p; p++) {
+        if (!g_ascii_isspace (*p))
+            g_string_append_c (result, g_ascii_toupper (*p));
+    }
+
+    return g_string_free (result, FALSE);
+}
+
+/* A rough measure of how much a server told us about a key */
+static unsigned int
+key_richness (SeahorsePgpKey *key)
+{
+    return g_list_model_get_n_items (seahorse_pgp_key_get_uids (key)) +
+           g_list_model_get_n_items (seahorse_pgp_key_get_subkeys (key));
+}
+
+/* Adds a key to the shared results, unless another server already returned
+ * the same key with at least as much information */
+static void
+search_remote_merge_key (search_remote_closure *closure,
+                         SeahorsePgpKey        *key)
+{
+    const char *fingerprint;
+    g_autofree char *normalized = NULL;
+    merged_key *existing;
+    g_autoptr(SeahorsePgpKey) at_position = NULL;
+
+    fingerprint = seahorse_pgp_key_get_fingerprint (key);
+    if (fingerprint == NULL || fingerprint[0] == '\0') {
+        g_list_store_append (closure->results, key);
+        return;
+    }
+
+    normalized = normalize_fingerprint (fingerprint);
+    existing = g_hash_table_lookup (closure->by_fingerprint, normalized);
+    if (existing == NULL) {
+        /* A server has it after all */
+        seahorse_unknown_source_forget_absent (closure->unknown, normalized);
+
+        existing = g_new0 (merged_key, 1);
+        existing->key = g_object_ref (key);
+        existing->position = g_list_model_get_n_items (G_LIST_MODEL (closure->results));
+        g_list_store_append (closure->results, key);
+        g_hash_table_insert (closure->by_fingerprint,
+                             g_steal_pointer (&normalized), existing);
+        return;
+    }
+
+    if (key_richness (key) <= key_richness (existing->key))
+        return;
+
+    /* Only look for it if somebody else changed the results meanwhile */
+    at_position = g_list_model_get_item (G_LIST_MODEL (closure->results),
+                                         existing->position);
+    if (at_position != existing->key &&
+        !g_list_store_find (closure->results, existing->key, &existing->position))
+        return;
+
+    g_list_store_splice (closure->results, existing->position, 1, (void **) &key, 1);
+    g_set_object (&existing->key, key);
+}
+
+static void
+on_server_results_changed (GListModel   *model,
+                           unsigned int  position,
+                           unsigned int  removed,
+                           unsigned int  added,
+                           void         *user_data)
+{
+    server_search *search = user_data;
+
+    if (added > 0 && search->first_result == 0)
+        search->first_result = g_get_monotonic_time ();
+
+    for (unsigned int i = position; i < position + added; i++) {
+        g_autoptr(SeahorsePgpKey) key = g_list_model_get_item (model, i);
+        search_remote_merge_key (search->closure, key);
+    }
+}
+
+static gboolean
+on_server_search_deadline (void *user_data)
+{
+    server_search *search = user_data;
+
+    search->deadline_id = 0;
+    search->timed_out = TRUE;
+    g_cancellable_cancel (search->cancellable);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+on_search_remote_cancelled (GCancellable *cancellable,
+                            void         *user_data)
+{
+    search_remote_closure *closure = user_data;
+
+    for (unsigned int i = 0; i < closure->servers->len; i++) {
+        server_search *search = g_ptr_array_index (closure->servers, i);
+        g_cancellable_cancel (search->cancellable);
+    }
+}
+
 static void
 on_source_search_ready (GObject *source,
                         GAsyncResult *result,
@@ -554,24 +819,75 @@ on_source_search_ready (GObject *source,
 {
     g_autoptr(GTask) task = G_TASK (user_data);
     search_remote_closure *closure = g_task_get_task_data (task);
+    server_search *search = NULL;
+    g_autofree char *uri = NULL;
     g_autoptr(GError) error = NULL;
+    int64_t elapsed;
 
     g_return_if_fail (closure->num_searches > 0);
 
-    if (!seahorse_server_source_search_finish (SEAHORSE_SERVER_SOURCE (source),
-                                               result, &error)) {
-        g_task_return_error (task, g_steal_pointer (&error));
-        return;
+    for (unsigned int i = 0; i < closure->servers->len; i++) {
+        server_search *s = g_ptr_array_index (closure->servers, i);
+        if (s->source == SEAHORSE_SERVER_SOURCE (source))
+            search = s;
+    }
+    g_return_if_fail (search != NULL);
+
+    server_search_stop (search);
+    elapsed = g_get_monotonic_time () - search->started;
+    uri = seahorse_place_get_uri (SEAHORSE_PLACE (source));
+
+    if (seahorse_server_source_search_finish (SEAHORSE_SERVER_SOURCE (source),
+                                              result, &error)) {
+        seahorse_server_source_record_latency (search->source, elapsed);
+        closure->num_succeeded++;
+        g_debug ("Search on %s: %u results after %" G_GINT64_FORMAT " ms (first after %" G_GINT64_FORMAT " ms)",
+                 uri, g_list_model_get_n_items (G_LIST_MODEL (search->results)),
+                 elapsed / 1000,
+                 search->first_result ? (search->first_result - search->started) / 1000 : -1);
+    } else if (search->timed_out) {
+        /* Too slow, but what it found until now is still good */
+        seahorse_server_source_record_latency (search->source, elapsed);
+        closure->num_succeeded++;
+        g_message ("Key server %s didn't finish searching in time, using %u partial results",
+                   uri, g_list_model_get_n_items (G_LIST_MODEL (search->results)));
+    } else {
+        g_debug ("Search on %s failed: %s", uri, error->message);
+        if (closure->error == NULL)
+            closure->error = g_steal_pointer (&error);
     }
 
     closure->num_searches--;
-    seahorse_progress_end (g_task_get_cancellable (task),
-                           GINT_TO_POINTER (closure->num_searches));
+    seahorse_progress_end (g_task_get_cancellable (task), search);
 
-    if (closure->num_searches == 0)
+    if (closure->num_searches > 0)
+        return;
+
+    /* Only fail if no server could give us anything */
+    if (g_task_return_error_if_cancelled (task))
+        return;
+    if (closure->num_succeeded == 0 && closure->error != NULL)
+        g_task_return_error (task, g_steal_pointer (&closure->error));
+    else
         g_task_return_boolean (task, TRUE);
 }
 
+/**
+ * seahorse_pgp_backend_search_remote_async:
+ * @self: The PGP backend
+ * @search: The text to search for
+ * @results: The store to add the found keys to
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: Called when all servers are done
+ * @user_data: Data for @callback
+ *
+ * Searches all selected key servers at the same time. Keys are added to
+ * @results as soon as any server returns them; when several servers return
+ * the same key, it's only shown once (the most complete version of it).
+ *
+ * A server that doesn't answer in time is given up on, keeping what it
+ * found so far. The search only fails if none of the servers succeeded.
+ */
 void
 seahorse_pgp_backend_search_remote_async (SeahorsePgpBackend *self,
                                           const char *search,
@@ -599,10 +915,16 @@ seahorse_pgp_backend_search_remote_async (SeahorsePgpBackend *self,
 
     task = g_task_new (self, cancellable, callback, user_data);
     closure = g_new0 (search_remote_closure, 1);
+    closure->results = g_object_ref (results);
+    closure->unknown = g_object_ref (self->unknown);
+    closure->by_fingerprint = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     g_free, merged_key_free);
+    closure->servers = g_ptr_array_new_with_free_func (server_search_free);
     g_task_set_task_data (task, closure, search_remote_closure_free);
 
     for (guint i = 0; i < g_list_model_get_n_items (self->remotes); i++) {
         g_autoptr(SeahorseServerSource) ssrc = NULL;
+        server_search *server;
 
         ssrc = g_list_model_get_item (self->remotes, i);
         if (servers) {
@@ -612,14 +934,44 @@ seahorse_pgp_backend_search_remote_async (SeahorsePgpBackend *self,
                 continue;
         }
 
-        seahorse_progress_prep_and_begin (cancellable, GINT_TO_POINTER (closure->num_searches), NULL);
-        seahorse_server_source_search_async (ssrc, search, results, cancellable,
-                                             on_source_search_ready, g_object_ref (task));
-        closure->num_searches++;
+        /* Each server gets its own results (which we merge) and its own
+         * cancellable (so we can give up on it alone) */
+        server = g_new0 (server_search, 1);
+        server->closure = closure;
+        server->source = g_steal_pointer (&ssrc);
+        server->results = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+        server->cancellable = g_cancellable_new ();
+        server->changed_sig = g_signal_connect (server->results, "items-changed",
+                                                G_CALLBACK (on_server_results_changed),
+                                                server);
+        g_ptr_array_add (closure->servers, server);
     }
 
-    if (closure->num_searches == 0)
+    if (closure->servers->len == 0) {
         g_task_return_boolean (task, FALSE);
+        return;
+    }
+
+    if (cancellable) {
+        closure->cancellable = g_object_ref (cancellable);
+        closure->cancelled_sig = g_cancellable_connect (cancellable,
+                                                        G_CALLBACK (on_search_remote_cancelled),
+                                                        closure, NULL);
+    }
+
+    for (guint i = 0; i < closure->servers->len; i++) {
+        server_search *server = g_ptr_array_index (closure->servers, i);
+
+        seahorse_progress_prep_and_begin (cancellable, server, NULL);
+        server->started = g_get_monotonic_time ();
+        server->deadline_id = g_timeout_add_seconds (SEARCH_SERVER_DEADLINE_SECONDS,
+                                                     on_server_search_deadline,
+                                                     server);
+        seahorse_server_source_search_async (server->source, search, server->results,
+                                             server->cancellable,
+                                             on_source_search_ready, g_object_ref (task));
+        closure->num_searches++;
+    }
 }
 
 gboolean
@@ -635,12 +987,14 @@ seahorse_pgp_backend_search_remote_finish (SeahorsePgpBackend *self,
 
 typedef struct {
     int num_transfers;
+    GError *error;                  /* The first transfer that failed */
 } transfer_closure;
 
 static void
 transfer_closure_free (void *user_data)
 {
     transfer_closure *closure = user_data;
+    g_clear_error (&closure->error);
     g_free (closure);
 }
 
@@ -655,17 +1009,17 @@ on_source_transfer_ready (GObject *source,
 
     g_return_if_fail (closure->num_transfers > 0);
 
-    seahorse_transfer_finish (result, &error);
-    if (error != NULL) {
-        g_task_return_error (task, g_steal_pointer (&error));
-        return;
-    }
+    /* Let the other transfers finish, but remember what went wrong */
+    if (!seahorse_transfer_finish (result, &error) && closure->error == NULL)
+        closure->error = g_steal_pointer (&error);
 
     closure->num_transfers--;
-    seahorse_progress_end (g_task_get_cancellable (task),
-                           GINT_TO_POINTER (closure->num_transfers));
+    if (closure->num_transfers > 0)
+        return;
 
-    if (closure->num_transfers == 0)
+    if (closure->error != NULL)
+        g_task_return_error (task, g_steal_pointer (&closure->error));
+    else
         g_task_return_boolean (task, TRUE);
 }
 
@@ -701,7 +1055,7 @@ seahorse_pgp_backend_transfer_async (SeahorsePgpBackend *self,
     current_pos = 0;
     while (current_pos < g_list_model_get_n_items (keys)) {
         g_autoptr(SeahorsePgpKey) first = NULL;
-        SeahorsePlace *from;
+        g_autoptr(SeahorsePlace) from = NULL;
         g_autolist(SeahorsePgpKey) to_transfer = NULL;
         unsigned int section_start, section_end;
 
@@ -715,7 +1069,7 @@ seahorse_pgp_backend_transfer_async (SeahorsePgpBackend *self,
             g_autoptr(SeahorsePgpKey) key = NULL;
 
             key = g_list_model_get_item (G_LIST_MODEL (sorted_keys), i);
-            to_transfer = g_list_prepend (to_transfer, key);
+            to_transfer = g_list_prepend (to_transfer, g_steal_pointer (&key));
         }
 
         /* Get the place were transferring frmo */
@@ -724,8 +1078,8 @@ seahorse_pgp_backend_transfer_async (SeahorsePgpBackend *self,
         g_return_if_fail (SEAHORSE_IS_PLACE (from));
 
         if (from != to) {
-            /* Start a new transfer operation between the two places */
-            seahorse_progress_prep_and_begin (cancellable, GINT_TO_POINTER (closure->num_transfers), NULL);
+            /* Start a new transfer operation between the two places. These
+             * run at the same time, and report their own progress. */
             seahorse_transfer_keys_async (from, to,
                                           to_transfer,
                                           cancellable,
@@ -752,6 +1106,603 @@ seahorse_pgp_backend_transfer_finish (SeahorsePgpBackend *self,
     return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/* When we start asking the next server for a batch of keys, if the previous
+ * one didn't answer yet. Based on how fast the server usually is, within
+ * these bounds (in milliseconds). */
+#define RETRIEVE_HEDGE_MIN_DELAY 250
+#define RETRIEVE_HEDGE_MAX_DELAY 2000
+#define RETRIEVE_HEDGE_DEFAULT_DELAY 1000
+
+/* Amount of keys we ask a server for in one request */
+#define RETRIEVE_BATCH_SIZE 100
+
+/* Amount of requests we have running at the same time, on all servers */
+#define RETRIEVE_MAX_IN_FLIGHT 4
+
+typedef struct _retrieve_closure retrieve_closure;
+
+typedef struct {
+    char *keyid;                    /* Upper case, without 0x */
+    gboolean found;
+    gboolean failed;                /* A server couldn't tell us */
+} retrieve_key;
+
+/* A request for a batch of keys to a single server */
+typedef struct {
+    retrieve_closure *closure;
+    unsigned int server;
+    GPtrArray *keys;                /* retrieve_key, not owned */
+    GCancellable *cancellable;
+    unsigned int hedge_id;
+    int64_t started;
+    gboolean hedged;                /* The next server was asked too */
+    gboolean done;
+} retrieve_batch;
+
+struct _retrieve_closure {
+    GTask *task;                    /* Not owned */
+    SeahorsePlace *to;
+    GPtrArray *servers;             /* Fastest first */
+    GPtrArray *keys;
+    GPtrArray *batches;
+    GQueue queued;                  /* Batches waiting for a free slot */
+    unsigned int num_in_flight;
+    unsigned int num_missing;
+    gboolean answered;              /* At least one server did */
+    GError *error;                  /* The last error of a server */
+    GCancellable *cancellable;
+    gulong cancelled_sig;
+    GByteArray *data;               /* The keys we found */
+};
+
+static void
+retrieve_key_free (void *user_data)
+{
+    retrieve_key *key = user_data;
+
+    g_free (key->keyid);
+    g_free (key);
+}
+
+static void
+retrieve_batch_free (void *user_data)
+{
+    retrieve_batch *batch = user_data;
+
+    g_clear_handle_id (&batch->hedge_id, g_source_remove);
+    g_clear_object (&batch->cancellable);
+    g_ptr_array_unref (batch->keys);
+    g_free (batch);
+}
+
+static void
+retrieve_closure_free (void *user_data)
+{
+    retrieve_closure *closure = user_data;
+
+    if (closure->cancelled_sig)
+        g_cancellable_disconnect (closure->cancellable, closure->cancelled_sig);
+    g_clear_object (&closure->cancellable);
+    g_queue_clear (&closure->queued);
+    g_ptr_array_unref (closure->batches);
+    g_ptr_array_unref (closure->keys);
+    g_ptr_array_unref (closure->servers);
+    g_clear_object (&closure->to);
+    g_clear_error (&closure->error);
+    g_clear_pointer (&closure->data, g_byte_array_unref);
+    g_free (closure);
+}
+
+static int
+compare_server_latency (const void *a,
+                        const void *b)
+{
+    GTimeSpan la = seahorse_server_source_get_latency (*(SeahorseServerSource **) a);
+    GTimeSpan lb = seahorse_server_source_get_latency (*(SeahorseServerSource **) b);
+
+    /* Servers we don't know anything about yet go last */
+    if (la == 0 || lb == 0)
+        return (la == 0) - (lb == 0);
+    return (la > lb) - (la < lb);
+}
+
+/* Strips the armor off a key block. Returns NULL if it doesn't look right */
+static GBytes *
+dearmor_key_block (GBytes *block)
+{
+    g_autoptr(GString) encoded = NULL;
+    const char *text, *end, *line;
+    gboolean in_body = FALSE;
+    guint8 *decoded;
+    size_t len;
+
+    text = g_bytes_get_data (block, &len);
+    end = text + len;
+    encoded = g_string_sized_new (len);
+
+    /* Skip the begin marker */
+    line = memchr (text, '\n', len);
+    while (line != NULL && ++line < end) {
+        const char *eol = memchr (line, '\n', end - line);
+        size_t line_len = (eol ? eol : end) - line;
+
+        if (line_len > 0 && line[line_len - 1] == '\r')
+            line_len--;
+
+        /* The headers end at the first empty line */
+        if (!in_body) {
+            in_body = (line_len == 0);
+        } else if (line_len == 0 || line[0] == '=' || line[0] == '-') {
+            break;
+        } else {
+            g_string_append_len (encoded, line, line_len);
+        }
+
+        line = eol;
+    }
+
+    if (encoded->len == 0)
+        return NULL;
+
+    decoded = g_base64_decode (encoded->str, &len);
+    return g_bytes_new_take (decoded, len);
+}
+
+/* Adds the fingerprints of all the V4 (sub)keys in an armored key block */
+static void
+collect_key_fingerprints (GBytes    *block,
+                          GPtrArray *fingerprints)
+{
+    g_autoptr(GBytes) packets = NULL;
+    const guint8 *data;
+    size_t len, pos = 0;
+
+    packets = dearmor_key_block (block);
+    if (packets == NULL)
+        return;
+
+    data = g_bytes_get_data (packets, &len);
+    while (pos < len) {
+        guint8 ctb = data[pos++];
+        unsigned int tag;
+        size_t body_len;
+
+        if (!(ctb & 0x80))
+            return;
+
+        if (ctb & 0x40) {
+            /* New format packet */
+            tag = ctb & 0x3f;
+            if (pos >= len)
+                return;
+            if (data[pos] < 192) {
+                body_len = data[pos++];
+            } else if (data[pos] < 224) {
+                if (pos + 2 > len)
+                    return;
+                body_len = ((data[pos] - 192) << 8) + data[pos + 1] + 192;
+                pos += 2;
+            } else if (data[pos] == 255) {
+                if (pos + 5 > len)
+                    return;
+                body_len = ((size_t) data[pos + 1] << 24) | (data[pos + 2] << 16) |
+                           (data[pos + 3] << 8) | data[pos + 4];
+                pos += 5;
+            } else {
+                /* Partial lengths don't happen in keys */
+                return;
+            }
+        } else {
+            /* Old format packet */
+            unsigned int n_octets;
+
+            tag = (ctb >> 2) & 0x0f;
+            switch (ctb & 0x03) {
+            case 0: n_octets = 1; break;
+            case 1: n_octets = 2; break;
+            case 2: n_octets = 4; break;
+            default: n_octets = 0; break;
+            }
+
+            if (pos + n_octets > len)
+                return;
+            body_len = (n_octets == 0) ? len - pos : 0;
+            for (; n_octets > 0; n_octets--)
+                body_len = (body_len << 8) | data[pos++];
+        }
+
+        if (body_len > len - pos)
+            return;
+
+        /* Public key or public subkey, version 4 */
+        if ((tag == 6 || tag == 14) && body_len > 0 && body_len <= G_MAXUINT16 &&
+            data[pos] == 4) {
+            g_autoptr(GChecksum) checksum = NULL;
+            guint8 header[3] = { 0x99, body_len >> 8, body_len & 0xff };
+
+            checksum = g_checksum_new (G_CHECKSUM_SHA1);
+            g_checksum_update (checksum, header, sizeof (header));
+            g_checksum_update (checksum, data + pos, body_len);
+            g_ptr_array_add (fingerprints,
+                             g_ascii_strup (g_checksum_get_string (checksum), -1));
+        }
+
+        pos += body_len;
+    }
+}
+
+static gboolean
+fingerprint_matches (const char *fingerprint,
+                     const char *keyid)
+{
+    size_t fpr_len = strlen (fingerprint);
+    size_t len = strlen (keyid);
+
+    return len <= fpr_len && strcmp (fingerprint + fpr_len - len, keyid) == 0;
+}
+
+/* Keeps the key blocks with keys we're still missing, and marks those as
+ * found. Returns whether it kept any. Sets @unidentified if there were
+ * blocks we couldn't find the keys in. */
+static gboolean
+retrieve_take_found_keys (retrieve_closure *closure,
+                          GBytes           *bytes,
+                          gboolean         *unidentified)
+{
+    g_autoptr(GInputStream) input = NULL;
+    g_autoptr(SeahorseArmorScanner) scanner = NULL;
+    gboolean any = FALSE;
+
+    input = g_memory_input_stream_new_from_bytes (bytes);
+    scanner = seahorse_armor_scanner_new (input,
+                                          SEAHORSE_ARMOR_PGP_PUBLIC_KEY_BEGIN,
+                                          SEAHORSE_ARMOR_PGP_PUBLIC_KEY_END);
+
+    for (;;) {
+        g_autoptr(GBytes) block = NULL;
+        g_autoptr(GPtrArray) fingerprints = NULL;
+        gboolean wanted = FALSE;
+
+        block = seahorse_armor_scanner_next (scanner, NULL, NULL);
+        if (block == NULL)
+            break;
+
+        fingerprints = g_ptr_array_new_with_free_func (g_free);
+        collect_key_fingerprints (block, fingerprints);
+
+        for (unsigned int i = 0; i < closure->keys->len; i++) {
+            retrieve_key *key = g_ptr_array_index (closure->keys, i);
+
+            if (key->found)
+                continue;
+
+            for (unsigned int j = 0; j < fingerprints->len; j++) {
+                if (fingerprint_matches (g_ptr_array_index (fingerprints, j), key->keyid)) {
+                    key->found = TRUE;
+                    closure->num_missing--;
+                    wanted = TRUE;
+                    break;
+                }
+            }
+        }
+
+        /* If we can't tell which keys are in there, we keep it anyway */
+        if (fingerprints->len == 0)
+            *unidentified = TRUE;
+        if (wanted || fingerprints->len == 0) {
+            g_byte_array_append (closure->data,
+                                 g_bytes_get_data (block, NULL), g_bytes_get_size (block));
+            g_byte_array_append (closure->data, (const guint8 *) "\n", 1);
+            any = TRUE;
+        }
+    }
+
+    return any;
+}
+
+static void
+on_retrieve_import_ready (GObject      *source,
+                          GAsyncResult *result,
+                          void         *user_data)
+{
+    g_autoptr(GTask) task = G_TASK (user_data);
+    g_autoptr(GError) error = NULL;
+    GList *imported;
+
+    if (SEAHORSE_IS_GPGME_KEYRING (source))
+        imported = seahorse_gpgme_keyring_import_finish (SEAHORSE_GPGME_KEYRING (source),
+                                                         result, &error);
+    else
+        imported = seahorse_server_source_import_finish (SEAHORSE_SERVER_SOURCE (source),
+                                                         result, &error);
+    g_list_free (imported);
+
+    seahorse_progress_end (g_task_get_cancellable (task), g_task_get_task_data (task));
+
+    if (error != NULL)
+        g_task_return_error (task, g_steal_pointer (&error));
+    else
+        g_task_return_boolean (task, TRUE);
+}
+
+/* Called when no more requests are running or waiting */
+static void
+retrieve_finish (GTask *task)
+{
+    SeahorsePgpBackend *self = g_task_get_source_object (task);
+    retrieve_closure *closure = g_task_get_task_data (task);
+    g_autoptr(GInputStream) input = NULL;
+    GBytes *data;
+
+    if (g_task_return_error_if_cancelled (task)) {
+        seahorse_progress_end (g_task_get_cancellable (task), closure);
+        return;
+    }
+
+    /* Don't ask again if every server said it doesn't have the key */
+    for (unsigned int i = 0; i < closure->keys->len; i++) {
+        retrieve_key *key = g_ptr_array_index (closure->keys, i);
+
+        if (key->found)
+            seahorse_unknown_source_forget_absent (self->unknown, key->keyid);
+        else if (!key->failed)
+            seahorse_unknown_source_mark_absent (self->unknown, key->keyid);
+    }
+
+    if (closure->data->len == 0) {
+        seahorse_progress_end (g_task_get_cancellable (task), closure);
+        if (!closure->answered && closure->error != NULL)
+            g_task_return_error (task, g_steal_pointer (&closure->error));
+        else
+            g_task_return_boolean (task, TRUE);
+        return;
+    }
+
+    /* Import everything we found in one go */
+    data = g_byte_array_free_to_bytes (g_steal_pointer (&closure->data));
+    input = g_memory_input_stream_new_from_bytes (data);
+    g_bytes_unref (data);
+
+    if (SEAHORSE_IS_GPGME_KEYRING (closure->to))
+        seahorse_gpgme_keyring_import_async (SEAHORSE_GPGME_KEYRING (closure->to),
+                                             input, g_task_get_cancellable (task),
+                                             on_retrieve_import_ready,
+                                             g_object_ref (task));
+    else
+        seahorse_server_source_import_async (SEAHORSE_SERVER_SOURCE (closure->to),
+                                             input, g_task_get_cancellable (task),
+                                             on_retrieve_import_ready,
+                                             g_object_ref (task));
+}
+
+/* Queues a request to the given server, for the keys we're still missing out
+ * of @keys. Returns FALSE if there's no such server, or nothing to ask. */
+static gboolean
+retrieve_queue_batch (retrieve_closure *closure,
+                      unsigned int      server,
+                      GPtrArray        *keys)
+{
+    retrieve_batch *batch = NULL;
+
+    if (server >= closure->servers->len)
+        return FALSE;
+
+    for (unsigned int i = 0; i < keys->len; i++) {
+        retrieve_key *key = g_ptr_array_index (keys, i);
+
+        if (key->found)
+            continue;
+
+        if (batch == NULL || batch->keys->len >= RETRIEVE_BATCH_SIZE) {
+            batch = g_new0 (retrieve_batch, 1);
+            batch->closure = closure;
+            batch->server = server;
+            batch->keys = g_ptr_array_new ();
+            g_ptr_array_add (closure->batches, batch);
+            g_queue_push_tail (&closure->queued, batch);
+        }
+
+        g_ptr_array_add (batch->keys, key);
+    }
+
+    return batch != NULL;
+}
+
+static void         retrieve_send_queued        (retrieve_closure *closure);
+
+/* Asks the next server for the keys of @batch that we didn't find yet */
+static void
+retrieve_batch_hedge (retrieve_batch *batch)
+{
+    if (batch->hedged)
+        return;
+
+    batch->hedged = TRUE;
+    retrieve_queue_batch (batch->closure, batch->server + 1, batch->keys);
+}
+
+static gboolean
+on_retrieve_hedge_timeout (void *user_data)
+{
+    retrieve_batch *batch = user_data;
+
+    batch->hedge_id = 0;
+    retrieve_batch_hedge (batch);
+    retrieve_send_queued (batch->closure);
+    return G_SOURCE_REMOVE;
+}
+
+/* Cancels the requests that can't give us anything new anymore */
+static void
+retrieve_cancel_useless (retrieve_closure *closure)
+{
+    for (unsigned int i = 0; i < closure->batches->len; i++) {
+        retrieve_batch *batch = g_ptr_array_index (closure->batches, i);
+        gboolean useful = FALSE;
+
+        if (batch->done || batch->cancellable == NULL)
+            continue;
+
+        for (unsigned int j = 0; j < batch->keys->len && !useful; j++) {
+            retrieve_key *key = g_ptr_array_index (batch->keys, j);
+            useful = !key->found;
+        }
+
+        if (!useful)
+            g_cancellable_cancel (batch->cancellable);
+    }
+}
+
+static void
+retrieve_batch_set_failed (retrieve_batch *batch)
+{
+    for (unsigned int i = 0; i < batch->keys->len; i++) {
+        retrieve_key *key = g_ptr_array_index (batch->keys, i);
+        key->failed = TRUE;
+    }
+}
+
+static void
+on_retrieve_export_ready (GObject      *source,
+                          GAsyncResult *result,
+                          void         *user_data)
+{
+    retrieve_batch *batch = user_data;
+    retrieve_closure *closure = batch->closure;
+    g_autoptr(GTask) task = closure->task;
+    g_autoptr(GBytes) bytes = NULL;
+    g_autoptr(GError) error = NULL;
+    int64_t elapsed;
+
+    elapsed = g_get_monotonic_time () - batch->started;
+    g_clear_handle_id (&batch->hedge_id, g_source_remove);
+    batch->done = TRUE;
+    closure->num_in_flight--;
+
+    bytes = seahorse_server_source_export_finish (SEAHORSE_SERVER_SOURCE (source),
+                                                  result, &error);
+
+    if (error == NULL) {
+        gboolean unidentified = FALSE;
+
+        closure->answered = TRUE;
+        seahorse_server_source_record_latency (SEAHORSE_SERVER_SOURCE (source), elapsed);
+
+        /* First hit wins, stop asking the others */
+        if (bytes != NULL && retrieve_take_found_keys (closure, bytes, &unidentified)) {
+            g_autofree char *uri = seahorse_place_get_uri (SEAHORSE_PLACE (source));
+
+            g_debug ("Retrieved keys from %s after %" G_GINT64_FORMAT " ms",
+                     uri, elapsed / 1000);
+            retrieve_cancel_useless (closure);
+        }
+
+        /* Maybe the server did have them, so don't remember them as absent */
+        if (unidentified)
+            retrieve_batch_set_failed (batch);
+
+    } else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_debug ("Couldn't retrieve keys: %s", error->message);
+        retrieve_batch_set_failed (batch);
+        g_clear_error (&closure->error);
+        closure->error = g_steal_pointer (&error);
+    }
+
+    /* Don't wait for the hedge timer for what this server didn't have */
+    if (!g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+        retrieve_batch_hedge (batch);
+
+    retrieve_send_queued (closure);
+}
+
+/* Sends the queued requests, as long as there's room for them */
+static void
+retrieve_send_queued (retrieve_closure *closure)
+{
+    GCancellable *cancellable = g_task_get_cancellable (closure->task);
+
+    if (closure->num_missing == 0 || g_cancellable_is_cancelled (cancellable))
+        g_queue_clear (&closure->queued);
+
+    while (closure->num_in_flight < RETRIEVE_MAX_IN_FLIGHT &&
+           !g_queue_is_empty (&closure->queued)) {
+        retrieve_batch *batch = g_queue_pop_head (&closure->queued);
+        SeahorseServerSource *source;
+        g_autoptr(GPtrArray) keyids = NULL;
+        GTimeSpan latency;
+        unsigned int delay;
+
+        keyids = g_ptr_array_new ();
+        for (unsigned int i = 0; i < batch->keys->len; i++) {
+            retrieve_key *key = g_ptr_array_index (batch->keys, i);
+            if (!key->found)
+                g_ptr_array_add (keyids, key->keyid);
+        }
+
+        /* Someone else was faster while this was waiting */
+        if (keyids->len == 0) {
+            batch->done = TRUE;
+            continue;
+        }
+        g_ptr_array_add (keyids, NULL);
+
+        source = g_ptr_array_index (closure->servers, batch->server);
+        batch->cancellable = g_cancellable_new ();
+        batch->started = g_get_monotonic_time ();
+        closure->num_in_flight++;
+
+        /* Each request keeps the task alive */
+        g_object_ref (closure->task);
+        seahorse_server_source_export_async (source, (const char **) keyids->pdata,
+                                             batch->cancellable,
+                                             on_retrieve_export_ready, batch);
+
+        if (batch->server + 1 >= closure->servers->len)
+            continue;
+
+        latency = seahorse_server_source_get_latency (source);
+        if (latency == 0)
+            delay = RETRIEVE_HEDGE_DEFAULT_DELAY;
+        else
+            delay = CLAMP (2 * latency / 1000, RETRIEVE_HEDGE_MIN_DELAY, RETRIEVE_HEDGE_MAX_DELAY);
+
+        batch->hedge_id = g_timeout_add (delay, on_retrieve_hedge_timeout, batch);
+    }
+
+    if (closure->num_in_flight == 0 && g_queue_is_empty (&closure->queued))
+        retrieve_finish (closure->task);
+}
+
+static void
+on_retrieve_cancelled (GCancellable *cancellable,
+                       void         *user_data)
+{
+    retrieve_closure *closure = user_data;
+
+    for (unsigned int i = 0; i < closure->batches->len; i++) {
+        retrieve_batch *batch = g_ptr_array_index (closure->batches, i);
+        if (batch->cancellable)
+            g_cancellable_cancel (batch->cancellable);
+    }
+}
+
+/**
+ * seahorse_pgp_backend_retrieve_async:
+ * @self: The PGP backend
+ * @keyids: The IDs of the keys to retrieve
+ * @to: Where to import the keys
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: Called when done
+ * @user_data: Data for @callback
+ *
+ * Retrieves keys from the key servers. The fastest server is asked for all
+ * keys first, in batches; if it takes longer than usual, or doesn't have some
+ * of the keys, the next one is asked for the keys that are still missing. The
+ * first server that has a key wins, and requests that can't bring anything
+ * new anymore are cancelled. Only a few requests run at the same time.
+ *
+ * Fails with the last error of a server if none of them answered.
+ */
 void
 seahorse_pgp_backend_retrieve_async (SeahorsePgpBackend *self,
                                      const char **keyids,
@@ -760,31 +1711,55 @@ seahorse_pgp_backend_retrieve_async (SeahorsePgpBackend *self,
                                      GAsyncReadyCallback callback,
                                      void *user_data)
 {
-    transfer_closure *closure;
+    retrieve_closure *closure;
     g_autoptr(GTask) task = NULL;
 
     g_return_if_fail (SEAHORSE_PGP_IS_BACKEND (self));
     g_return_if_fail (SEAHORSE_IS_PLACE (to));
 
     task = g_task_new (self, cancellable, callback, user_data);
-    closure = g_new0 (transfer_closure, 1);
-    g_task_set_task_data (task, closure, transfer_closure_free);
+    g_task_set_source_tag (task, seahorse_pgp_backend_retrieve_async);
+    closure = g_new0 (retrieve_closure, 1);
+    closure->task = task;
+    closure->to = g_object_ref (to);
+    closure->data = g_byte_array_new ();
+    closure->keys = g_ptr_array_new_with_free_func (retrieve_key_free);
+    closure->batches = g_ptr_array_new_with_free_func (retrieve_batch_free);
+    closure->servers = g_ptr_array_new_with_free_func (g_object_unref);
+    g_queue_init (&closure->queued);
+    g_task_set_task_data (task, closure, retrieve_closure_free);
+
+    for (guint i = 0; i < g_list_model_get_n_items (self->remotes); i++)
+        g_ptr_array_add (closure->servers, g_list_model_get_item (self->remotes, i));
+    g_ptr_array_sort (closure->servers, compare_server_latency);
+
+    if (closure->servers->len == 0 || keyids == NULL || keyids[0] == NULL) {
+        g_task_return_boolean (task, TRUE);
+        return;
+    }
 
-    for (guint i = 0; i < g_list_model_get_n_items (self->remotes); i++) {
-        g_autoptr(SeahorseServerSource) ssrc = NULL;
+    for (guint i = 0; keyids[i] != NULL; i++) {
+        retrieve_key *key = g_new0 (retrieve_key, 1);
+        const char *keyid = keyids[i];
 
-        ssrc = g_list_model_get_item (self->remotes, i);
+        if (g_ascii_strncasecmp (keyid, "0x", 2) == 0)
+            keyid += 2;
+        key->keyid = g_ascii_strup (keyid, -1);
+        g_ptr_array_add (closure->keys, key);
+    }
+    closure->num_missing = closure->keys->len;
 
-        /* Start a new transfer operation between the two places */
-        seahorse_progress_prep_and_begin (cancellable,
-                                          GINT_TO_POINTER (closure->num_transfers), NULL);
-        seahorse_transfer_keyids_async (ssrc, to, keyids, cancellable,
-                                        on_source_transfer_ready, g_object_ref (task));
-        closure->num_transfers++;
+    if (cancellable) {
+        closure->cancellable = g_object_ref (cancellable);
+        closure->cancelled_sig = g_cancellable_connect (cancellable,
+                                                        G_CALLBACK (on_retrieve_cancelled),
+                                                        closure, NULL);
     }
 
-    if (closure->num_transfers == 0)
-        g_task_return_boolean (task, TRUE);
+    seahorse_progress_prep_and_begin (cancellable, closure, NULL);
+
+    retrieve_queue_batch (closure, 0, closure->keys);
+    retrieve_send_queued (closure);
 }
 
 gboolean
@@ -837,10 +1812,24 @@ seahorse_pgp_backend_discover_keys (SeahorsePgpBackend *self,
         keyids = (const char **) todiscover->pdata;
 
 #ifdef WITH_KEYSERVER
-        /* Start a discover process on all todiscover */
-        if (seahorse_app_settings_get_server_auto_retrieve (seahorse_app_settings_instance ()))
-            seahorse_pgp_backend_retrieve_async (self, keyids, SEAHORSE_PLACE (self->keyring),
-                                                 cancellable, NULL, NULL);
+        /* Start a discover process on all todiscover, except for the ones
+         * we already know the servers don't have */
+        if (seahorse_app_settings_get_server_auto_retrieve (seahorse_app_settings_instance ())) {
+            g_autoptr(GPtrArray) toretrieve = g_ptr_array_new ();
+
+            for (i = 0; keyids[i] != NULL; i++) {
+                if (!seahorse_unknown_source_is_absent (self->unknown, keyids[i]))
+                    g_ptr_array_add (toretrieve, (char *) keyids[i]);
+            }
+
+            if (toretrieve->len > 0) {
+                g_ptr_array_add (toretrieve, NULL);
+                seahorse_pgp_backend_retrieve_async (self,
+                                                     (const char **) toretrieve->pdata,
+                                                     SEAHORSE_PLACE (self->keyring),
+                                                     cancellable, NULL, NULL);
+            }
+        }
 #endif
 
         /* Add unknown objects for all these */
@@ -855,71 +1844,230 @@ seahorse_pgp_backend_discover_keys (SeahorsePgpBackend *self,
     return robjects;
 }
 
-SeahorsePgpKey *
-seahorse_pgp_backend_create_key_for_parsed (SeahorsePgpBackend *self,
-                                            GcrParsed *parsed)
+/* How many keys a preview hands over at once */
+#define PREVIEW_BATCH 64
+
+/* Starts listing all the keys in @bytes, which must stay around until the
+ * listing is done */
+static gpgme_ctx_t
+preview_context_new (GBytes        *bytes,
+                     gpgme_data_t  *data,
+                     GError       **error)
 {
-    g_autoptr(GInputStream) stream = NULL;
-    const void *data;
-    size_t data_len;
     gpgme_ctx_t gctx;
-    gpgme_error_t gerr;
-    gpgme_key_t gkey;
-    gpgme_key_t end;
-    gpgme_data_t gpgme_data = NULL;
-    g_autoptr(SeahorsePgpKey) key = NULL;
+    gpgme_error_t gerr = 0;
+    const void *mem;
+    size_t len;
 
-    g_return_val_if_fail (gcr_parsed_get_format (parsed) == GCR_FORMAT_OPENPGP_PACKET, NULL);
+    gctx = seahorse_gpgme_keyring_new_context (&gerr);
+    if (gctx == NULL) {
+        seahorse_gpgme_propagate_error (gerr, error);
+        return NULL;
+    }
 
-    data = gcr_parsed_get_data (parsed, &data_len);
-    g_return_val_if_fail (data != NULL, NULL);
+    gpgme_set_armor (gctx, 0);
+    gpgme_set_textmode (gctx, 0);
+    gpgme_set_offline (gctx, 1);
 
-    /* Create a temporary context */
-    setlocale (LC_ALL, "");
-    gpgme_check_version (NULL);
-    gpgme_set_locale (NULL, LC_CTYPE, setlocale (LC_CTYPE, NULL));
+    mem = g_bytes_get_data (bytes, &len);
+    gerr = gpgme_data_new_from_mem (data, mem, len, 0);
+    if (GPG_IS_OK (gerr))
+        gerr = gpgme_op_keylist_from_data_start (gctx, *data, 0);
 
-    gerr = gpgme_new (&gctx);
-    g_return_val_if_fail (GPG_IS_OK (gerr), NULL);
+    if (!GPG_IS_OK (gerr)) {
+        g_clear_pointer (data, gpgme_data_release);
+        gpgme_release (gctx);
+        seahorse_gpgme_propagate_error (gerr, error);
+        return NULL;
+    }
 
-    gerr = gpgme_set_protocol (gctx, GPGME_PROTOCOL_OPENPGP);
-    g_return_val_if_fail (GPG_IS_OK (gerr), NULL);
+    return gctx;
+}
 
-    gpgme_set_armor (gctx, 0);
-    gpgme_set_textmode (gctx, 0);
-    gpgme_set_offline (gctx, 1);
-    gpgme_set_keylist_mode (gctx, GPGME_KEYLIST_MODE_LOCAL);
+static SeahorsePgpKey *
+preview_key_new (gpgme_key_t gkey)
+{
+    if (gkey->secret)
+        return SEAHORSE_PGP_KEY (seahorse_gpgme_key_new (NULL, NULL, gkey));
+    return SEAHORSE_PGP_KEY (seahorse_gpgme_key_new (NULL, gkey, NULL));
+}
+
+typedef struct {
+    GBytes *bytes;
+    gpgme_data_t data;
+    gpgme_ctx_t gctx;
+    GListStore *results;
+    unsigned int loaded;
+} preview_closure;
+
+static void
+preview_free (void *data)
+{
+    preview_closure *closure = data;
+
+    if (closure->gctx) {
+        gpgme_op_keylist_end (closure->gctx);
+        gpgme_release (closure->gctx);
+    }
+    g_clear_pointer (&closure->data, gpgme_data_release);
+    g_clear_pointer (&closure->bytes, g_bytes_unref);
+    g_clear_object (&closure->results);
+    g_free (closure);
+}
+
+/* Hands over one batch of previewed keys */
+static gboolean
+on_idle_preview_batch_of_keys (void *user_data)
+{
+    GTask *task = G_TASK (user_data);
+    preview_closure *closure = g_task_get_task_data (task);
+    GCancellable *cancellable = g_task_get_cancellable (task);
+    g_autoptr(GPtrArray) keys = NULL;
+    gpgme_error_t gerr = 0;
+    gboolean done = FALSE;
+
+    if (g_task_return_error_if_cancelled (task)) {
+        seahorse_progress_end (cancellable, task);
+        return G_SOURCE_REMOVE;
+    }
+
+    keys = g_ptr_array_new_with_free_func (g_object_unref);
+    while (keys->len < PREVIEW_BATCH) {
+        gpgme_key_t gkey;
+
+        gerr = gpgme_op_keylist_next (closure->gctx, &gkey);
+        if (!GPG_IS_OK (gerr)) {
+            done = TRUE;
+            break;
+        }
+
+        g_ptr_array_add (keys, preview_key_new (gkey));
+        gpgme_key_unref (gkey);
+    }
+
+    /* A single change for the whole batch */
+    g_list_store_splice (closure->results,
+                         g_list_model_get_n_items (G_LIST_MODEL (closure->results)),
+                         0, keys->pdata, keys->len);
+    closure->loaded += keys->len;
+
+    if (!done) {
+        g_autofree char *detail = NULL;
+
+        detail = g_strdup_printf (ngettext ("Loaded %d key", "Loaded %d keys", closure->loaded),
+                                  closure->loaded);
+        seahorse_progress_update (cancellable, task, detail);
+        return G_SOURCE_CONTINUE;
+    }
 
-    /* Put it in a gpgme data struct which we can put in the special gpgme_op_keylist_from_data_start() */
-    gerr = gpgme_data_new (&gpgme_data);
-    g_return_val_if_fail (GPG_IS_OK (gerr), NULL);
+    seahorse_progress_end (cancellable, task);
 
-    gerr = gpgme_data_new_from_mem(&gpgme_data, data, data_len, 0);
-    g_return_val_if_fail (GPG_IS_OK (gerr), NULL);
+    if (gpgme_err_code (gerr) != GPG_ERR_EOF) {
+        GError *error = NULL;
 
-    gerr = gpgme_op_keylist_from_data_start(gctx, gpgme_data, 0);
-    g_return_val_if_fail (GPG_IS_OK (gerr), NULL);
+        seahorse_gpgme_propagate_error (gerr, &error);
+        g_task_return_error (task, error);
+    } else {
+        g_task_return_boolean (task, TRUE);
+    }
 
-    gerr = gpgme_op_keylist_next(gctx, &gkey);
-    g_return_val_if_fail (GPG_IS_OK (gerr), NULL);
+    return G_SOURCE_REMOVE;
+}
 
-    gerr = gpgme_op_keylist_next(gctx, &end);
-    // XXX supposedly we're only to have one here? What about public vs secret
-    g_return_val_if_fail (!GPG_IS_OK (gerr), NULL);
+/**
+ * seahorse_pgp_backend_preview_keys_async:
+ * @self: A #SeahorsePgpBackend
+ * @data: OpenPGP data, possibly with many keys
+ * @results: (element-type SeahorsePgpKey): Where the keys end up
+ * @cancellable: (nullable): Cancellation
+ * @callback: Called when all keys are listed
+ * @user_data: Data for @callback
+ *
+ * Lists the keys in @data without importing them. The whole of @data is
+ * listed in one go, and the keys are added to @results in batches while
+ * that happens.
+ */
+void
+seahorse_pgp_backend_preview_keys_async (SeahorsePgpBackend  *self,
+                                         GBytes              *data,
+                                         GListStore          *results,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         void                *user_data)
+{
+    g_autoptr(GTask) task = NULL;
+    preview_closure *closure;
+    GError *error = NULL;
 
-    if (gkey->revoked || gkey->expired || gkey->disabled || gkey->invalid || gkey->secret) {
-        //XXX some things can be left here, but what about invalid? disabled?
+    self = self ? self : seahorse_pgp_backend_get ();
+    g_return_if_fail (SEAHORSE_PGP_IS_BACKEND (self));
+    g_return_if_fail (data != NULL);
+    g_return_if_fail (G_IS_LIST_STORE (results));
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, seahorse_pgp_backend_preview_keys_async);
+
+    closure = g_new0 (preview_closure, 1);
+    closure->bytes = g_bytes_ref (data);
+    closure->results = g_object_ref (results);
+    g_task_set_task_data (task, closure, preview_free);
+
+    closure->gctx = preview_context_new (closure->bytes, &closure->data, &error);
+    if (closure->gctx == NULL) {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    seahorse_progress_prep_and_begin (cancellable, task, NULL);
+    g_idle_add_full (G_PRIORITY_LOW, on_idle_preview_batch_of_keys,
+                     g_steal_pointer (&task), g_object_unref);
+}
+
+gboolean
+seahorse_pgp_backend_preview_keys_finish (SeahorsePgpBackend  *self,
+                                          GAsyncResult        *result,
+                                          GError             **error)
+{
+    self = self ? self : seahorse_pgp_backend_get ();
+    g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+SeahorsePgpKey *
+seahorse_pgp_backend_create_key_for_parsed (SeahorsePgpBackend *self,
+                                            GcrParsed *parsed)
+{
+    g_autoptr(GBytes) bytes = NULL;
+    g_autoptr(GError) error = NULL;
+    const void *data;
+    size_t data_len;
+    gpgme_ctx_t gctx;
+    gpgme_data_t gpgme_data = NULL;
+    gpgme_key_t gkey;
+    SeahorsePgpKey *key = NULL;
+
+    g_return_val_if_fail (gcr_parsed_get_format (parsed) == GCR_FORMAT_OPENPGP_PACKET, NULL);
+
+    data = gcr_parsed_get_data (parsed, &data_len);
+    g_return_val_if_fail (data != NULL, NULL);
+
+    bytes = g_bytes_new_static (data, data_len);
+    gctx = preview_context_new (bytes, &gpgme_data, &error);
+    if (gctx == NULL) {
+        g_warning ("Couldn't list the parsed key: %s", error->message);
         return NULL;
     }
 
-    //XXX how do we know it's a public or secret key?
-    // XXX something is off here also, as it shows as a private key only
-    if (gkey->secret)
-        key = SEAHORSE_PGP_KEY (seahorse_gpgme_key_new (NULL, NULL, gkey));
-    else
-        key = SEAHORSE_PGP_KEY (seahorse_gpgme_key_new (NULL, gkey, NULL));
+    /* A parsed OpenPGP packet holds a single key */
+    if (GPG_IS_OK (gpgme_op_keylist_next (gctx, &gkey))) {
+        key = preview_key_new (gkey);
+        gpgme_key_unref (gkey);
+    }
 
-    //XXX don't we need to release the gpgme-context?
+    gpgme_op_keylist_end (gctx);
+    gpgme_data_release (gpgme_data);
+    gpgme_release (gctx);
 
-    return g_steal_pointer (&key);
+    return key;
 }
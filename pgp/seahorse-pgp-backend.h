@@ -29,6 +29,7 @@
 
 #include "seahorse-discovery.h"
 #include "seahorse-gpgme-keyring.h"
+#include "seahorse-keyserver-publish.h"
 #include "seahorse-pgp-key.h"
 #include "seahorse-server-source.h"
 
@@ -57,6 +58,8 @@ SeahorseDiscovery *    seahorse_pgp_backend_get_discovery        (SeahorsePgpBac
 
 GListModel *           seahorse_pgp_backend_get_remotes          (SeahorsePgpBackend *self);
 
+SeahorseKeyserverPublish * seahorse_pgp_backend_get_publish_queue (SeahorsePgpBackend *self);
+
 SeahorseServerSource * seahorse_pgp_backend_lookup_remote        (SeahorsePgpBackend *self,
                                                                   const gchar *uri);
 
@@ -108,5 +111,16 @@ GList*                 seahorse_pgp_backend_discover_keys        (SeahorsePgpBac
 SeahorsePgpKey *       seahorse_pgp_backend_create_key_for_parsed (SeahorsePgpBackend *self,
                                                                    GcrParsed *parsed);
 
+void                   seahorse_pgp_backend_preview_keys_async   (SeahorsePgpBackend  *self,
+                                                                  GBytes              *data,
+                                                                  GListStore          *results,
+                                                                  GCancellable        *cancellable,
+                                                                  GAsyncReadyCallback  callback,
+                                                                  void                *user_data);
+
+gboolean               seahorse_pgp_backend_preview_keys_finish  (SeahorsePgpBackend  *self,
+                                                                  GAsyncResult        *result,
+                                                                  GError             **error);
+
 
 G_END_DECLS
@@ -61,6 +61,7 @@ enum {
 typedef struct _SeahorseServerSourcePrivate {
     gchar *server;
     gchar *uri;
+    GTimeSpan latency;
 } SeahorseServerSourcePrivate;
 
 static void      seahorse_server_source_list_model_init    (GListModelInterface *iface);
@@ -389,3 +390,48 @@ seahorse_server_source_import_finish (SeahorseServerSource *source,
     g_return_val_if_fail (SEAHORSE_SERVER_SOURCE_GET_CLASS (source)->import_finish, NULL);
     return SEAHORSE_SERVER_SOURCE_GET_CLASS (source)->import_finish (source, result, error);
 }
+
+/**
+ * seahorse_server_source_get_latency:
+ * @self: A #SeahorseServerSource
+ *
+ * Returns how long this server usually takes to answer, based on the
+ * requests we made so far.
+ *
+ * Returns: The estimated latency in microseconds, or 0 if unknown
+ */
+GTimeSpan
+seahorse_server_source_get_latency (SeahorseServerSource *self)
+{
+    SeahorseServerSourcePrivate *priv =
+        seahorse_server_source_get_instance_private (self);
+
+    g_return_val_if_fail (SEAHORSE_IS_SERVER_SOURCE (self), 0);
+
+    return priv->latency;
+}
+
+/**
+ * seahorse_server_source_record_latency:
+ * @self: A #SeahorseServerSource
+ * @latency: How long a request took, in microseconds
+ *
+ * Updates the latency estimate with a new measurement. Older measurements
+ * are gradually forgotten, so a server that became slow (or fast) is
+ * noticed quickly.
+ */
+void
+seahorse_server_source_record_latency (SeahorseServerSource *self,
+                                       GTimeSpan             latency)
+{
+    SeahorseServerSourcePrivate *priv =
+        seahorse_server_source_get_instance_private (self);
+
+    g_return_if_fail (SEAHORSE_IS_SERVER_SOURCE (self));
+    g_return_if_fail (latency >= 0);
+
+    if (priv->latency == 0)
+        priv->latency = MAX (latency, 1);
+    else
+        priv->latency = MAX ((priv->latency * 3 + latency) / 4, 1);
+}
@@ -112,3 +112,8 @@ void                   seahorse_server_source_export_async     (SeahorseServerSo
 GBytes *               seahorse_server_source_export_finish    (SeahorseServerSource *self,
                                                                 GAsyncResult *result,
                                                                 GError **error);
+
+GTimeSpan              seahorse_server_source_get_latency      (SeahorseServerSource *self);
+
+void                   seahorse_server_source_record_latency   (SeahorseServerSource *self,
+                                                                GTimeSpan latency);
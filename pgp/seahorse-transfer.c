@@ -26,7 +26,8 @@
 #include "seahorse-transfer.h"
 
 #include "seahorse-server-source.h"
-#include "seahorse-gpgme-key-export-operation.h"
+#include "seahorse-gpgme.h"
+#include "seahorse-gpgme-key.h"
 #include "seahorse-gpgme-keyring.h"
 
 #include "seahorse-common.h"
@@ -35,14 +36,31 @@
 #include "libseahorse/seahorse-util.h"
 
 #include <glib/gi18n.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <gio/gunixinputstream.h>
 
+#include <fcntl.h>
 #include <stdlib.h>
 
+/*
+ * A transfer exports keys from one place and imports them into another.
+ *
+ * Exporting from the keyring happens in a thread, writing into a pipe that
+ * the import reads from at the same time. That way we never hold the whole
+ * export in memory, and the import (e.g. uploading to a key server) starts
+ * with the first key. Key servers hand us their export in one piece.
+ */
+
 typedef struct {
     SeahorsePlace *from;
     SeahorsePlace *to;
     char **keyids;
     GList *keys;
+    int num_pending;                /* The export and/or the import */
+    gboolean importing;
+    GError *export_error;
+    GError *import_error;
 } TransferClosure;
 
 static void
@@ -53,10 +71,42 @@ transfer_closure_free (gpointer user_data)
     g_clear_object (&closure->to);
     g_strfreev (closure->keyids);
     g_list_free_full (closure->keys, g_object_unref);
+    g_clear_error (&closure->export_error);
+    g_clear_error (&closure->import_error);
     g_free (closure);
 }
 
-#if 0
+/* Called when the export or the import is done */
+static void
+transfer_step_done (GTask *task)
+{
+    TransferClosure *closure = g_task_get_task_data (task);
+
+    g_return_if_fail (closure->num_pending > 0);
+
+    closure->num_pending--;
+    if (closure->num_pending > 0)
+        return;
+
+    /* Nothing was imported, that part of the progress is done too */
+    if (!closure->importing) {
+        seahorse_progress_begin (g_task_get_cancellable (task), &closure->to);
+        seahorse_progress_end (g_task_get_cancellable (task), &closure->to);
+    }
+
+    /* A failed import also breaks the export, so report that first */
+    if (closure->import_error != NULL) {
+        g_debug ("[transfer] import failed: %s", closure->import_error->message);
+        g_task_return_error (task, g_steal_pointer (&closure->import_error));
+    } else if (closure->export_error != NULL) {
+        g_debug ("[transfer] export failed: %s", closure->export_error->message);
+        g_task_return_error (task, g_steal_pointer (&closure->export_error));
+    } else if (!g_task_return_error_if_cancelled (task)) {
+        g_debug ("[transfer] done");
+        g_task_return_boolean (task, TRUE);
+    }
+}
+
 static void
 on_source_import_ready (GObject *object,
                         GAsyncResult *result,
@@ -65,98 +115,190 @@ on_source_import_ready (GObject *object,
     g_autoptr(GTask) task = G_TASK (user_data);
     TransferClosure *closure = g_task_get_task_data (task);
     GCancellable *cancellable = g_task_get_cancellable (task);
-    GError *error = NULL;
-    g_autoptr(GList) results = NULL;
+    GList *results;
 
     g_debug ("[transfer] import done");
     seahorse_progress_end (cancellable, &closure->to);
 
     if (SEAHORSE_IS_GPGME_KEYRING (closure->to)) {
         results = seahorse_gpgme_keyring_import_finish (SEAHORSE_GPGME_KEYRING (closure->to),
-                                                        result, &error);
+                                                        result, &closure->import_error);
     } else {
         results = seahorse_server_source_import_finish (SEAHORSE_SERVER_SOURCE (closure->to),
-                                                        result, &error);
+                                                        result, &closure->import_error);
     }
+    g_list_free (results);
 
-    if (results != NULL)
-        g_cancellable_set_error_if_cancelled (cancellable, &error);
+    transfer_step_done (task);
+}
 
-    if (error != NULL)
-        g_task_return_error (task, g_steal_pointer (&error));
-    else
-        g_task_return_boolean (task, TRUE);
+/* Takes over the input stream, which is closed when the import is done */
+static void
+transfer_start_import (GTask        *task,
+                       GInputStream *input)
+{
+    TransferClosure *closure = g_task_get_task_data (task);
+    GCancellable *cancellable = g_task_get_cancellable (task);
+
+    g_debug ("[transfer] starting import");
+    seahorse_progress_begin (cancellable, &closure->to);
+    closure->importing = TRUE;
+    closure->num_pending++;
+
+    if (SEAHORSE_IS_GPGME_KEYRING (closure->to)) {
+        seahorse_gpgme_keyring_import_async (SEAHORSE_GPGME_KEYRING (closure->to),
+                                             input, cancellable,
+                                             on_source_import_ready,
+                                             g_object_ref (task));
+    } else {
+        seahorse_server_source_import_async (SEAHORSE_SERVER_SOURCE (closure->to),
+                                             input, cancellable,
+                                             on_source_import_ready,
+                                             g_object_ref (task));
+    }
 }
 
 static void
-on_source_export_ready (GObject *object,
+on_server_export_ready (GObject *object,
                         GAsyncResult *result,
                         gpointer user_data)
 {
     g_autoptr(GTask) task = G_TASK (user_data);
     TransferClosure *closure = g_task_get_task_data (task);
     GCancellable *cancellable = g_task_get_cancellable (task);
-    GError *error = NULL;
-    gsize stream_size;
+    g_autoptr(GBytes) bytes = NULL;
     g_autoptr(GInputStream) input = NULL;
-    gpointer stream_data = NULL;
 
     g_debug ("[transfer] export done");
     seahorse_progress_end (cancellable, &closure->from);
 
-    if (SEAHORSE_IS_SERVER_SOURCE (closure->from)) {
-        GBytes *stream_bytes;
+    bytes = seahorse_server_source_export_finish (SEAHORSE_SERVER_SOURCE (object),
+                                                  result, &closure->export_error);
 
-        stream_bytes = seahorse_server_source_export_finish (SEAHORSE_SERVER_SOURCE (object),
-                                                             result, &error);
-        stream_data = g_bytes_unref_to_data (stream_bytes, &stream_size);
+    if (bytes != NULL && g_bytes_get_size (bytes) > 0) {
+        input = g_memory_input_stream_new_from_bytes (bytes);
+        transfer_start_import (task, input);
+    } else if (bytes != NULL) {
+        g_debug ("[transfer] nothing to import");
+    }
 
-    } else if (SEAHORSE_IS_GPGME_KEYRING (closure->from)) {
-        stream_data = seahorse_exporter_export_finish (SEAHORSE_EXPORTER (object), result,
-                                                       &stream_size, &error);
+    transfer_step_done (task);
+}
 
-    } else {
-        g_warning ("unsupported source for export: %s", G_OBJECT_TYPE_NAME (object));
-    }
+typedef struct {
+    gpgme_key_t *keys;
+    int fd;
+} KeyringExportData;
 
-    if (error == NULL)
-        g_cancellable_set_error_if_cancelled (cancellable, &error);
+static void
+keyring_export_data_free (void *user_data)
+{
+    KeyringExportData *data = user_data;
+
+    for (unsigned int i = 0; data->keys[i] != NULL; i++)
+        gpgme_key_unref (data->keys[i]);
+    g_free (data->keys);
+    if (data->fd >= 0)
+        g_close (data->fd, NULL);
+    g_free (data);
+}
 
-    if (error != NULL) {
-        g_debug ("[transfer] stopped after export");
-        g_task_return_error (task, g_steal_pointer (&error));
-        return;
+static void
+keyring_export_thread (GTask        *task,
+                       void         *source_object,
+                       void         *task_data,
+                       GCancellable *cancellable)
+{
+    KeyringExportData *data = task_data;
+    gpgme_ctx_t gctx;
+    gpgme_data_t gdata = NULL;
+    gpgme_error_t gerr = 0;
+    GError *error = NULL;
+
+    gctx = seahorse_gpgme_keyring_new_context (&gerr);
+    if (gerr == 0) {
+        gpgme_set_armor (gctx, 1);
+        gerr = gpgme_data_new_from_fd (&gdata, data->fd);
     }
 
-    seahorse_progress_begin (cancellable, &closure->to);
+    /* Blocks whenever the pipe is full, until the import catches up */
+    if (gerr == 0)
+        gerr = gpgme_op_export_keys (gctx, data->keys, 0, gdata);
 
-    if (!stream_size) {
-        g_debug ("[transfer] nothing to import");
-        seahorse_progress_end (cancellable, &closure->to);
+    gpgme_data_release (gdata);
+    g_clear_pointer (&gctx, gpgme_release);
+
+    /* Let the import know that this was everything */
+    g_close (data->fd, NULL);
+    data->fd = -1;
+
+    if (seahorse_gpgme_propagate_error (gerr, &error))
+        g_task_return_error (task, error);
+    else
         g_task_return_boolean (task, TRUE);
-        return;
-    }
+}
 
-    input = g_memory_input_stream_new_from_data (stream_data, stream_size, g_free);
-    stream_data = NULL;
-    stream_size = 0;
+static void
+on_keyring_export_ready (GObject *object,
+                         GAsyncResult *result,
+                         gpointer user_data)
+{
+    g_autoptr(GTask) task = G_TASK (user_data);
+    TransferClosure *closure = g_task_get_task_data (task);
 
-    g_debug ("[transfer] starting import");
-    if (SEAHORSE_IS_GPGME_KEYRING (closure->to)) {
-        seahorse_gpgme_keyring_import_async (SEAHORSE_GPGME_KEYRING (closure->to),
-                                             input, cancellable,
-                                             on_source_import_ready,
-                                             g_steal_pointer (&task));
-    } else {
-        seahorse_server_source_import_async (SEAHORSE_SERVER_SOURCE (closure->to),
-                                             input, cancellable,
-                                             on_source_import_ready,
-                                             g_steal_pointer (&task));
+    g_debug ("[transfer] export done");
+    seahorse_progress_end (g_task_get_cancellable (task), &closure->from);
+
+    g_task_propagate_boolean (G_TASK (result), &closure->export_error);
+    transfer_step_done (task);
+}
+
+static void
+transfer_start_keyring_export (GTask *task)
+{
+    TransferClosure *closure = g_task_get_task_data (task);
+    g_autoptr(GTask) export_task = NULL;
+    g_autoptr(GInputStream) input = NULL;
+    KeyringExportData *data;
+    unsigned int n_keys = 0;
+    int fds[2];
+
+    data = g_new0 (KeyringExportData, 1);
+    data->keys = g_new0 (gpgme_key_t, g_list_length (closure->keys) + 1);
+    data->fd = -1;
+    for (GList *l = closure->keys; l != NULL; l = g_list_next (l)) {
+        gpgme_key_t pubkey;
+
+        if (!SEAHORSE_GPGME_IS_KEY (l->data))
+            continue;
+
+        pubkey = seahorse_gpgme_key_get_public (l->data);
+        if (pubkey != NULL) {
+            gpgme_key_ref (pubkey);
+            data->keys[n_keys++] = pubkey;
+        }
+    }
+
+    /* An empty list would export the whole keyring */
+    if (n_keys == 0 || !g_unix_open_pipe (fds, O_CLOEXEC, &closure->export_error)) {
+        g_debug ("[transfer] nothing to export");
+        keyring_export_data_free (data);
+        seahorse_progress_end (g_task_get_cancellable (task), &closure->from);
+        transfer_step_done (task);
+        return;
     }
+    data->fd = fds[1];
+
+    export_task = g_task_new (NULL, NULL, on_keyring_export_ready, g_object_ref (task));
+    g_task_set_source_tag (export_task, transfer_start_keyring_export);
+    g_task_set_task_data (export_task, data, keyring_export_data_free);
+    g_task_run_in_thread (export_task, keyring_export_thread);
 
-    g_free (stream_data);
+    /* The import runs at the same time, reading what the export writes.
+     * Once the import is done, closing the pipe also stops the export. */
+    input = g_unix_input_stream_new (fds[0], TRUE);
+    transfer_start_import (task, input);
 }
-#endif
 
 static gboolean
 on_timeout_start_transfer (gpointer user_data)
@@ -167,31 +309,34 @@ on_timeout_start_transfer (gpointer user_data)
 
     g_assert (SEAHORSE_IS_PLACE (closure->from));
 
-    //XXX
-#if 0
+    if (g_task_return_error_if_cancelled (task))
+        return G_SOURCE_REMOVE;
+
+    g_debug ("[transfer] starting export");
     seahorse_progress_begin (cancellable, &closure->from);
+    closure->num_pending++;
+
     if (SEAHORSE_IS_SERVER_SOURCE (closure->from)) {
         g_assert (closure->keyids != NULL);
         seahorse_server_source_export_async (SEAHORSE_SERVER_SOURCE (closure->from),
                                              (const char **) closure->keyids,
-                                             cancellable, on_source_export_ready,
+                                             cancellable, on_server_export_ready,
                                              g_object_ref (task));
         return G_SOURCE_REMOVE;
     }
 
     if (SEAHORSE_IS_GPGME_KEYRING (closure->from)) {
-        SeahorseExporter *exporter = NULL;
-
         g_assert (closure->keys != NULL);
-        exporter = seahorse_gpgme_exporter_new_multiple (closure->keys, TRUE);
-        seahorse_exporter_export (exporter, cancellable,
-                                  on_source_export_ready, g_object_ref (task));
-        g_object_unref (exporter);
+        transfer_start_keyring_export (task);
         return G_SOURCE_REMOVE;
     }
-#endif
 
     g_warning ("unsupported source for transfer: %s", G_OBJECT_TYPE_NAME (closure->from));
+    seahorse_progress_end (cancellable, &closure->from);
+    closure->export_error = g_error_new (G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                         _("Can’t transfer keys from %s"),
+                                         G_OBJECT_TYPE_NAME (closure->from));
+    transfer_step_done (task);
     return G_SOURCE_REMOVE;
 }
 
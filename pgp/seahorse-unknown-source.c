@@ -28,6 +28,16 @@
 
 #include <glib/gi18n.h>
 
+#include <errno.h>
+#include <string.h>
+
+/* How long we believe the key servers when they don't have a key */
+#define ABSENT_KEYID_TTL (G_TIME_SPAN_DAY)
+
+/* Changes to the absent key cache are written out after this many seconds,
+ * so that a big discovery doesn't write the file over and over again */
+#define ABSENT_SAVE_DELAY 5
+
 enum {
     PROP_0,
     PROP_LABEL,
@@ -44,6 +54,14 @@ struct _SeahorseUnknownSource {
     GObject parent;
 
     GPtrArray *keys;
+    GHashTable *by_keyid;           /* Normalized key ID -> unknown in keys */
+
+    /* Key IDs that the key servers don't have: normalized key ID -> until
+     * when we believe that (in seconds since the epoch). Loaded on first use. */
+    GHashTable *absent;
+    char *absent_servers;           /* The servers that were asked */
+    char *servers;                  /* The currently configured servers */
+    unsigned int save_id;
 };
 
 static void      seahorse_unknown_source_list_model_iface      (GListModelInterface *iface);
@@ -59,22 +77,28 @@ static void
 seahorse_unknown_source_init (SeahorseUnknownSource *self)
 {
     self->keys = g_ptr_array_new_with_free_func (g_object_unref);
+    self->by_keyid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+/* The hash key for a key ID, matching seahorse_pgp_keyid_equal(): long key
+ * IDs and fingerprints are reduced to the long key ID. */
+static char *
+normalize_keyid (const char *keyid)
+{
+    size_t len = strlen (keyid);
+
+    if (len > 16)
+        keyid += len - 16;
+    return g_ascii_strup (keyid, -1);
 }
 
 static SeahorseUnknown *
 seahorse_unknown_lookup_by_keyid (SeahorseUnknownSource *self,
                                   const char *keyid)
 {
-    for (unsigned int i = 0; i < self->keys->len; i++) {
-        SeahorseUnknown *unknown = g_ptr_array_index (self->keys, i);
-        const char *unknown_keyid;
-
-        unknown_keyid = seahorse_unknown_get_keyid (unknown);
-        if (seahorse_pgp_keyid_equal (keyid, unknown_keyid))
-            return unknown;
-    }
+    g_autofree char *normalized = normalize_keyid (keyid);
 
-    return NULL;
+    return g_hash_table_lookup (self->by_keyid, normalized);
 }
 
 static void
@@ -195,11 +219,21 @@ seahorse_unknown_source_set_property (GObject *obj,
     }
 }
 
+static void      absent_cache_save       (SeahorseUnknownSource *self);
+
 static void
 seahorse_unknown_source_finalize (GObject *obj)
 {
     SeahorseUnknownSource *self = SEAHORSE_UNKNOWN_SOURCE (obj);
 
+    if (self->save_id) {
+        g_clear_handle_id (&self->save_id, g_source_remove);
+        absent_cache_save (self);
+    }
+    g_clear_pointer (&self->absent, g_hash_table_unref);
+    g_free (self->absent_servers);
+    g_free (self->servers);
+    g_hash_table_unref (self->by_keyid);
     g_ptr_array_unref (self->keys);
 
     G_OBJECT_CLASS (seahorse_unknown_source_parent_class)->finalize (obj);
@@ -299,6 +333,7 @@ seahorse_unknown_source_add_object (SeahorseUnknownSource *self,
     if (unknown == NULL) {
         unknown = seahorse_unknown_new (self, keyid, NULL);
         g_ptr_array_add (self->keys, unknown);
+        g_hash_table_insert (self->by_keyid, normalize_keyid (keyid), unknown);
     }
 
     if (cancellable)
@@ -306,3 +341,242 @@ seahorse_unknown_source_add_object (SeahorseUnknownSource *self,
 
     return unknown;
 }
+
+static char *
+absent_cache_path (void)
+{
+    return g_build_filename (g_get_user_cache_dir (), "seahorse",
+                             "absent-keyids", NULL);
+}
+
+static void
+absent_cache_load (SeahorseUnknownSource *self)
+{
+    g_autoptr(GKeyFile) file = NULL;
+    g_autofree char *path = NULL;
+    g_auto(GStrv) keyids = NULL;
+    g_autoptr(GError) error = NULL;
+    int64_t now;
+
+    if (self->absent != NULL)
+        return;
+
+    self->absent = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    path = absent_cache_path ();
+    file = g_key_file_new ();
+    if (!g_key_file_load_from_file (file, path, G_KEY_FILE_NONE, &error)) {
+        if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_message ("Couldn't load absent key cache: %s", error->message);
+        self->absent_servers = g_strdup (self->servers);
+        return;
+    }
+
+    self->absent_servers = g_key_file_get_string (file, "cache", "servers", NULL);
+
+    /* If the servers changed since, they might have the keys now */
+    if (g_strcmp0 (self->absent_servers, self->servers) != 0) {
+        g_free (self->absent_servers);
+        self->absent_servers = g_strdup (self->servers);
+        return;
+    }
+
+    now = g_get_real_time ();
+    keyids = g_key_file_get_keys (file, "absent", NULL, NULL);
+    for (unsigned int i = 0; keyids && keyids[i] != NULL; i++) {
+        int64_t until;
+
+        until = g_key_file_get_int64 (file, "absent", keyids[i], NULL);
+        if (until > now)
+            g_hash_table_insert (self->absent, normalize_keyid (keyids[i]),
+                                 GSIZE_TO_POINTER ((gsize) (until / G_USEC_PER_SEC)));
+    }
+}
+
+static void
+absent_cache_save (SeahorseUnknownSource *self)
+{
+    g_autoptr(GKeyFile) file = NULL;
+    g_autofree char *path = NULL;
+    g_autofree char *dir = NULL;
+    g_autofree char *data = NULL;
+    g_autoptr(GError) error = NULL;
+    GHashTableIter iter;
+    void *key, *value;
+    size_t length;
+
+    g_return_if_fail (self->absent != NULL);
+
+    file = g_key_file_new ();
+    if (self->absent_servers)
+        g_key_file_set_string (file, "cache", "servers", self->absent_servers);
+
+    g_hash_table_iter_init (&iter, self->absent);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+        g_key_file_set_int64 (file, "absent", key,
+                              (int64_t) GPOINTER_TO_SIZE (value) * G_USEC_PER_SEC);
+
+    path = absent_cache_path ();
+    dir = g_path_get_dirname (path);
+    data = g_key_file_to_data (file, &length, NULL);
+
+    if (g_mkdir_with_parents (dir, 0700) < 0 ||
+        !g_file_set_contents_full (path, data, length,
+                                   G_FILE_SET_CONTENTS_CONSISTENT, 0600, &error))
+        g_message ("Couldn't save absent key cache: %s",
+                   error ? error->message : g_strerror (errno));
+}
+
+static gboolean
+on_absent_cache_save_timeout (void *user_data)
+{
+    SeahorseUnknownSource *self = SEAHORSE_UNKNOWN_SOURCE (user_data);
+
+    self->save_id = 0;
+    absent_cache_save (self);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+absent_cache_changed (SeahorseUnknownSource *self)
+{
+    if (self->save_id == 0)
+        self->save_id = g_timeout_add_seconds (ABSENT_SAVE_DELAY,
+                                               on_absent_cache_save_timeout,
+                                               self);
+}
+
+/**
+ * seahorse_unknown_source_set_servers:
+ * @self: The unknown source
+ * @uris: (nullable): The URIs of the configured key servers
+ *
+ * Sets the key servers that keys are looked up on. Keys that were marked
+ * absent on a different set of servers are forgotten.
+ */
+void
+seahorse_unknown_source_set_servers (SeahorseUnknownSource *self,
+                                     const char * const    *uris)
+{
+    g_autoptr(GPtrArray) sorted = NULL;
+
+    g_return_if_fail (SEAHORSE_IS_UNKNOWN_SOURCE (self));
+
+    sorted = g_ptr_array_new ();
+    for (unsigned int i = 0; uris && uris[i] != NULL; i++)
+        g_ptr_array_add (sorted, (char *) uris[i]);
+    g_ptr_array_sort_values (sorted, (GCompareFunc) g_strcmp0);
+    g_ptr_array_add (sorted, NULL);
+
+    g_free (self->servers);
+    self->servers = g_strjoinv (" ", (char **) sorted->pdata);
+
+    /* Nothing to forget if we didn't load the cache yet */
+    if (self->absent == NULL ||
+        g_strcmp0 (self->absent_servers, self->servers) == 0)
+        return;
+
+    g_free (self->absent_servers);
+    self->absent_servers = g_strdup (self->servers);
+    g_hash_table_remove_all (self->absent);
+    absent_cache_changed (self);
+}
+
+/**
+ * seahorse_unknown_source_is_absent:
+ * @self: The unknown source
+ * @keyid: A key ID
+ *
+ * Returns: Whether the key servers recently didn't have the given key, so
+ *   it's no use asking them again
+ */
+gboolean
+seahorse_unknown_source_is_absent (SeahorseUnknownSource *self,
+                                   const char            *keyid)
+{
+    g_autofree char *normalized = NULL;
+    void *value;
+
+    g_return_val_if_fail (SEAHORSE_IS_UNKNOWN_SOURCE (self), FALSE);
+    g_return_val_if_fail (keyid != NULL, FALSE);
+
+    absent_cache_load (self);
+
+    normalized = normalize_keyid (keyid);
+    if (!g_hash_table_lookup_extended (self->absent, normalized, NULL, &value))
+        return FALSE;
+
+    if ((int64_t) GPOINTER_TO_SIZE (value) > g_get_real_time () / G_USEC_PER_SEC)
+        return TRUE;
+
+    g_hash_table_remove (self->absent, normalized);
+    absent_cache_changed (self);
+    return FALSE;
+}
+
+/**
+ * seahorse_unknown_source_mark_absent:
+ * @self: The unknown source
+ * @keyid: A key ID
+ *
+ * Remembers (also across sessions) that the key servers don't have the
+ * given key, so we don't ask them again for a while.
+ */
+void
+seahorse_unknown_source_mark_absent (SeahorseUnknownSource *self,
+                                     const char            *keyid)
+{
+    int64_t until;
+
+    g_return_if_fail (SEAHORSE_IS_UNKNOWN_SOURCE (self));
+    g_return_if_fail (keyid != NULL);
+
+    absent_cache_load (self);
+
+    until = (g_get_real_time () + ABSENT_KEYID_TTL) / G_USEC_PER_SEC;
+    g_hash_table_insert (self->absent, normalize_keyid (keyid),
+                         GSIZE_TO_POINTER ((gsize) until));
+    absent_cache_changed (self);
+}
+
+/**
+ * seahorse_unknown_source_forget_absent:
+ * @self: The unknown source
+ * @keyid: A key ID
+ *
+ * Forgets that the key servers didn't have the given key, for example
+ * when it was found after all.
+ */
+void
+seahorse_unknown_source_forget_absent (SeahorseUnknownSource *self,
+                                       const char            *keyid)
+{
+    g_autofree char *normalized = NULL;
+
+    g_return_if_fail (SEAHORSE_IS_UNKNOWN_SOURCE (self));
+    g_return_if_fail (keyid != NULL);
+
+    absent_cache_load (self);
+
+    normalized = normalize_keyid (keyid);
+    if (g_hash_table_remove (self->absent, normalized))
+        absent_cache_changed (self);
+}
+
+/**
+ * seahorse_unknown_source_flush:
+ * @self: The unknown source
+ *
+ * Writes out pending changes to the absent key cache right away.
+ */
+void
+seahorse_unknown_source_flush (SeahorseUnknownSource *self)
+{
+    g_return_if_fail (SEAHORSE_IS_UNKNOWN_SOURCE (self));
+
+    if (self->save_id == 0)
+        return;
+
+    g_clear_handle_id (&self->save_id, g_source_remove);
+    absent_cache_save (self);
+}
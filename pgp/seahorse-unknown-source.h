@@ -33,3 +33,17 @@ SeahorseUnknownSource *   seahorse_unknown_source_new           (void);
 SeahorseUnknown *         seahorse_unknown_source_add_object    (SeahorseUnknownSource *self,
                                                                  const char *keyid,
                                                                  GCancellable *cancellable);
+
+void                      seahorse_unknown_source_set_servers   (SeahorseUnknownSource *self,
+                                                                 const char * const *uris);
+
+gboolean                  seahorse_unknown_source_is_absent     (SeahorseUnknownSource *self,
+                                                                 const char *keyid);
+
+void                      seahorse_unknown_source_mark_absent   (SeahorseUnknownSource *self,
+                                                                 const char *keyid);
+
+void                      seahorse_unknown_source_forget_absent (SeahorseUnknownSource *self,
+                                                                 const char *keyid);
+
+void                      seahorse_unknown_source_flush         (SeahorseUnknownSource *self);
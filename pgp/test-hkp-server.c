@@ -0,0 +1,476 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "test-hkp-server.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PGP_KEY_BEGIN   "-----BEGIN PGP PUBLIC KEY BLOCK-----"
+#define PGP_KEY_END     "-----END PGP PUBLIC KEY BLOCK-----"
+
+/* Size of the random payload in a synthetic key block, roughly a 4096-bit
+ * RSA key with a single user ID */
+#define KEY_PAYLOAD_SIZE 2048
+
+/* The creation date of all synthetic keys (2021-01-01) */
+#define KEY_CREATED 1609459200
+
+typedef struct {
+    char *fingerprint;
+    char *keyid;
+    char *uid;
+} HkpTestKey;
+
+struct _HkpTestServer {
+    GSocketService *service;
+    char *uri;
+
+    GPtrArray *keys;
+    GHashTable *keys_by_id;
+
+    /* Accessed from the worker threads */
+    int latency_ms;
+    int fail_every;
+    int n_requests;
+    int n_added;
+};
+
+static void
+hkp_test_key_free (void *data)
+{
+    HkpTestKey *key = data;
+    g_free (key->fingerprint);
+    g_free (key->keyid);
+    g_free (key->uid);
+    g_free (key);
+}
+
+static HkpTestKey *
+hkp_test_key_new (unsigned int index)
+{
+    HkpTestKey *key;
+    g_autofree char *seed = NULL;
+    g_autofree char *checksum = NULL;
+
+    key = g_new0 (HkpTestKey, 1);
+
+    seed = g_strdup_printf ("seahorse-hkp-test-key-%u", index);
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, seed, -1);
+    key->fingerprint = g_ascii_strup (checksum, -1);
+    key->keyid = g_strdup (key->fingerprint + 24);
+    key->uid = g_strdup_printf ("Test User %u <user%u@example.org>", index, index);
+
+    return key;
+}
+
+static char *
+build_key_block (unsigned int index)
+{
+    g_autoptr(GRand) rand = NULL;
+    g_autofree guint8 *payload = NULL;
+    g_autofree char *encoded = NULL;
+    GString *block;
+    size_t len;
+
+    rand = g_rand_new_with_seed (index);
+    payload = g_malloc (KEY_PAYLOAD_SIZE);
+    for (size_t i = 0; i < KEY_PAYLOAD_SIZE; i++)
+        payload[i] = g_rand_int_range (rand, 0, 256);
+
+    encoded = g_base64_encode (payload, KEY_PAYLOAD_SIZE);
+    len = strlen (encoded);
+
+    block = g_string_sized_new (len + len / 64 + 128);
+    g_string_append (block, PGP_KEY_BEGIN "\n\n");
+    for (size_t i = 0; i < len; i += 64) {
+        g_string_append_len (block, encoded + i, MIN (64, len - i));
+        g_string_append_c (block, '\n');
+    }
+    g_string_append (block, "=TEST\n" PGP_KEY_END "\n");
+
+    return g_string_free (block, FALSE);
+}
+
+static char *
+build_index_response (HkpTestServer *server,
+                      const char    *search)
+{
+    GString *body;
+    g_autofree char *needle = NULL;
+    g_autofree char *info = NULL;
+    unsigned int count = 0;
+
+    if (search && g_str_has_prefix (search, "0x"))
+        search += 2;
+    needle = g_utf8_casefold (search ? search : "", -1);
+    body = g_string_sized_new (server->keys->len * 128);
+
+    for (unsigned int i = 0; i < server->keys->len; i++) {
+        HkpTestKey *key = g_ptr_array_index (server->keys, i);
+        g_autofree char *haystack = NULL;
+        g_autofree char *escaped = NULL;
+
+        haystack = g_utf8_casefold (key->uid, -1);
+        if (needle[0] && !strstr (haystack, needle) &&
+            g_ascii_strcasecmp (needle, key->keyid) != 0 &&
+            g_ascii_strcasecmp (needle, key->fingerprint) != 0)
+            continue;
+
+        escaped = g_uri_escape_string (key->uid, " ", FALSE);
+        g_string_append_printf (body, "pub:%s:1:4096:%d::\n", key->fingerprint, KEY_CREATED);
+        g_string_append_printf (body, "uid:%s:%d::\n", escaped, KEY_CREATED);
+        count++;
+    }
+
+    info = g_strdup_printf ("info:1:%u\n", count);
+    g_string_prepend (body, info);
+
+    return g_string_free (body, FALSE);
+}
+
+static gboolean
+write_response (GOutputStream *output,
+                unsigned int   status,
+                const char    *reason,
+                const char    *body)
+{
+    g_autofree char *head = NULL;
+    size_t body_len = body ? strlen (body) : 0;
+
+    head = g_strdup_printf ("HTTP/1.1 %u %s\r\n"
+                            "Content-Type: text/plain\r\n"
+                            "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+                            "Connection: close\r\n"
+                            "\r\n",
+                            status, reason, body_len);
+
+    if (!g_output_stream_write_all (output, head, strlen (head), NULL, NULL, NULL))
+        return FALSE;
+    if (body_len > 0 &&
+        !g_output_stream_write_all (output, body, body_len, NULL, NULL, NULL))
+        return FALSE;
+
+    return g_output_stream_flush (output, NULL, NULL);
+}
+
+static void
+handle_lookup (HkpTestServer *server,
+               GHashTable    *params,
+               GOutputStream *output)
+{
+    const char *op, *search;
+
+    op = g_hash_table_lookup (params, "op");
+    search = g_hash_table_lookup (params, "search");
+
+    if (g_strcmp0 (op, "index") == 0) {
+        g_autofree char *body = NULL;
+
+        body = build_index_response (server, search);
+        write_response (output, 200, "OK", body);
+
+    } else if (g_strcmp0 (op, "get") == 0 && search != NULL) {
+        g_autofree char *keyid = NULL;
+        g_autofree char *body = NULL;
+        void *index;
+
+        if (g_str_has_prefix (search, "0x"))
+            search += 2;
+        keyid = g_ascii_strup (search, -1);
+
+        if (!g_hash_table_lookup_extended (server->keys_by_id, keyid, NULL, &index)) {
+            write_response (output, 404, "Not Found", "No keys found\n");
+            return;
+        }
+
+        body = build_key_block (GPOINTER_TO_UINT (index));
+        write_response (output, 200, "OK", body);
+
+    } else {
+        write_response (output, 501, "Not Implemented", "Unsupported operation\n");
+    }
+}
+
+static void
+handle_add (HkpTestServer *server,
+            GHashTable    *params,
+            GOutputStream *output)
+{
+    const char *keytext;
+    const char *pos;
+    int n_keys = 0;
+
+    keytext = g_hash_table_lookup (params, "keytext");
+    if (keytext == NULL) {
+        write_response (output, 400, "Bad Request", "Error: no keytext\n");
+        return;
+    }
+
+    for (pos = strstr (keytext, PGP_KEY_BEGIN); pos != NULL;
+         pos = strstr (pos + 1, PGP_KEY_BEGIN))
+        n_keys++;
+
+    g_atomic_int_add (&server->n_added, n_keys);
+    write_response (output, 200, "OK", "Key block added to key server database.\n");
+}
+
+static gboolean
+on_service_run (GThreadedSocketService *service,
+                GSocketConnection      *connection,
+                GObject                *source_object,
+                void                   *user_data)
+{
+    HkpTestServer *server = user_data;
+    GOutputStream *output;
+    g_autoptr(GDataInputStream) input = NULL;
+    g_autofree char *request_line = NULL;
+    g_auto(GStrv) request = NULL;
+    g_autoptr(GHashTable) params = NULL;
+    g_autofree char *body = NULL;
+    size_t content_length = 0;
+    const char *query;
+    int n_request, fail_every, latency_ms;
+
+    input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+    g_data_input_stream_set_newline_type (input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+    /* Request line, e.g. "GET /pks/lookup?op=index&search=foo HTTP/1.1" */
+    request_line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+    if (request_line == NULL)
+        return TRUE;
+    request = g_strsplit (request_line, " ", 3);
+    if (g_strv_length (request) != 3)
+        return TRUE;
+
+    /* Headers; we only care about the body length */
+    for (;;) {
+        g_autofree char *header = NULL;
+
+        header = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+        if (header == NULL || header[0] == '\0')
+            break;
+        if (g_ascii_strncasecmp (header, "Content-Length:", 15) == 0)
+            content_length = strtoul (header + 15, NULL, 10);
+    }
+
+    if (content_length > 0) {
+        size_t n_read;
+
+        body = g_malloc0 (content_length + 1);
+        if (!g_input_stream_read_all (G_INPUT_STREAM (input), body, content_length,
+                                      &n_read, NULL, NULL))
+            return TRUE;
+    }
+
+    n_request = g_atomic_int_add (&server->n_requests, 1) + 1;
+
+    latency_ms = g_atomic_int_get (&server->latency_ms);
+    if (latency_ms > 0)
+        g_usleep (latency_ms * G_TIME_SPAN_MILLISECOND);
+
+    fail_every = g_atomic_int_get (&server->fail_every);
+    if (fail_every > 0 && n_request % fail_every == 0) {
+        write_response (output, 503, "Service Unavailable", "Error: injected failure\n");
+        return TRUE;
+    }
+
+    if (g_str_equal (request[0], "POST") && g_str_has_prefix (request[1], "/pks/add")) {
+        params = g_uri_parse_params (body ? body : "", -1, "&",
+                                     G_URI_PARAMS_WWW_FORM, NULL);
+        if (params == NULL)
+            write_response (output, 400, "Bad Request", "Error: malformed form\n");
+        else
+            handle_add (server, params, output);
+
+    } else if (g_str_equal (request[0], "GET") && g_str_has_prefix (request[1], "/pks/lookup")) {
+        query = strchr (request[1], '?');
+        params = g_uri_parse_params (query ? query + 1 : "", -1, "&",
+                                     G_URI_PARAMS_WWW_FORM, NULL);
+        if (params == NULL)
+            write_response (output, 400, "Bad Request", "Error: malformed query\n");
+        else
+            handle_lookup (server, params, output);
+
+    } else {
+        write_response (output, 404, "Not Found", "Error: unknown path\n");
+    }
+
+    return TRUE;
+}
+
+/**
+ * hkp_test_server_new:
+ * @n_keys: The amount of synthetic keys to serve
+ *
+ * Starts an HKP server on a random loopback port. Key number `i` has the
+ * user ID "Test User i <useri@example.org>", so searching for "Test User"
+ * returns every key.
+ *
+ * Returns: (transfer full): The running server
+ */
+HkpTestServer *
+hkp_test_server_new (unsigned int n_keys)
+{
+    HkpTestServer *server;
+    g_autoptr(GInetAddress) loopback = NULL;
+    g_autoptr(GSocketAddress) address = NULL;
+    g_autoptr(GSocketAddress) effective = NULL;
+    g_autoptr(GError) error = NULL;
+    uint16_t port;
+
+    server = g_new0 (HkpTestServer, 1);
+    server->keys = g_ptr_array_new_full (n_keys, hkp_test_key_free);
+    server->keys_by_id = g_hash_table_new (g_str_hash, g_str_equal);
+    for (unsigned int i = 0; i < n_keys; i++) {
+        HkpTestKey *key = hkp_test_key_new (i);
+
+        g_ptr_array_add (server->keys, key);
+        g_hash_table_insert (server->keys_by_id, key->keyid, GUINT_TO_POINTER (i));
+        g_hash_table_insert (server->keys_by_id, key->fingerprint, GUINT_TO_POINTER (i));
+    }
+
+    server->service = g_threaded_socket_service_new (32);
+    g_signal_connect (server->service, "run", G_CALLBACK (on_service_run), server);
+
+    loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+    address = g_inet_socket_address_new (loopback, 0);
+    g_socket_listener_add_address (G_SOCKET_LISTENER (server->service), address,
+                                   G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP,
+                                   NULL, &effective, &error);
+    g_assert_no_error (error);
+
+    port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective));
+    server->uri = g_strdup_printf ("hkp://127.0.0.1:%u", port);
+
+    g_socket_service_start (server->service);
+    return server;
+}
+
+/**
+ * hkp_test_server_free:
+ * @server: The server to stop
+ *
+ * Stops listening and frees the server. Requests that are still being
+ * handled should have been awaited by the caller.
+ */
+void
+hkp_test_server_free (HkpTestServer *server)
+{
+    if (server == NULL)
+        return;
+
+    g_socket_service_stop (server->service);
+    g_socket_listener_close (G_SOCKET_LISTENER (server->service));
+    g_signal_handlers_disconnect_by_data (server->service, server);
+    g_clear_object (&server->service);
+
+    g_hash_table_unref (server->keys_by_id);
+    g_ptr_array_unref (server->keys);
+    g_free (server->uri);
+    g_free (server);
+}
+
+/**
+ * hkp_test_server_get_uri:
+ * @server: The server
+ *
+ * Returns: An hkp:// URI suitable for seahorse_hkp_source_new()
+ */
+const char *
+hkp_test_server_get_uri (HkpTestServer *server)
+{
+    return server->uri;
+}
+
+unsigned int
+hkp_test_server_get_n_keys (HkpTestServer *server)
+{
+    return server->keys->len;
+}
+
+/**
+ * hkp_test_server_get_keyid:
+ * @server: The server
+ * @index: The index of the synthetic key
+ *
+ * Returns: The 16-character key ID of the key at @index
+ */
+const char *
+hkp_test_server_get_keyid (HkpTestServer *server,
+                           unsigned int   index)
+{
+    HkpTestKey *key;
+
+    g_return_val_if_fail (index < server->keys->len, NULL);
+
+    key = g_ptr_array_index (server->keys, index);
+    return key->keyid;
+}
+
+/**
+ * hkp_test_server_set_latency:
+ * @server: The server
+ * @latency_ms: The delay added before each response, in milliseconds
+ */
+void
+hkp_test_server_set_latency (HkpTestServer *server,
+                             unsigned int   latency_ms)
+{
+    g_atomic_int_set (&server->latency_ms, latency_ms);
+}
+
+/**
+ * hkp_test_server_set_fail_every:
+ * @server: The server
+ * @fail_every: Answer every n-th request with a 503, or 0 to never fail
+ */
+void
+hkp_test_server_set_fail_every (HkpTestServer *server,
+                                unsigned int   fail_every)
+{
+    g_atomic_int_set (&server->fail_every, fail_every);
+}
+
+/**
+ * hkp_test_server_get_n_requests:
+ * @server: The server
+ *
+ * Returns: The amount of HTTP requests received so far
+ */
+unsigned int
+hkp_test_server_get_n_requests (HkpTestServer *server)
+{
+    return g_atomic_int_get (&server->n_requests);
+}
+
+/**
+ * hkp_test_server_get_n_added:
+ * @server: The server
+ *
+ * Returns: The amount of key blocks received through "/pks/add"
+ */
+unsigned int
+hkp_test_server_get_n_added (HkpTestServer *server)
+{
+    return g_atomic_int_get (&server->n_added);
+}
@@ -0,0 +1,55 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * HkpTestServer: A minimal in-process HKP keyserver for tests and benchmarks.
+ *
+ * - Listens on a random loopback port using a GThreadedSocketService.
+ * - Serves synthetic "op=index" and "op=get" lookups and accepts "/pks/add".
+ * - Can add artificial latency and fail every n-th request.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+typedef struct _HkpTestServer HkpTestServer;
+
+HkpTestServer *   hkp_test_server_new               (unsigned int n_keys);
+
+void              hkp_test_server_free              (HkpTestServer *server);
+
+const char *      hkp_test_server_get_uri           (HkpTestServer *server);
+
+unsigned int      hkp_test_server_get_n_keys        (HkpTestServer *server);
+
+const char *      hkp_test_server_get_keyid         (HkpTestServer *server,
+                                                     unsigned int   index);
+
+void              hkp_test_server_set_latency       (HkpTestServer *server,
+                                                     unsigned int   latency_ms);
+
+void              hkp_test_server_set_fail_every    (HkpTestServer *server,
+                                                     unsigned int   fail_every);
+
+unsigned int      hkp_test_server_get_n_requests    (HkpTestServer *server);
+
+unsigned int      hkp_test_server_get_n_added       (HkpTestServer *server);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HkpTestServer, hkp_test_server_free)
@@ -17,11 +17,97 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include "seahorse-gpgme-keyring.h"
 #include "seahorse-hkp-source.h"
+#include "seahorse-pgp-backend.h"
 #include "seahorse-pgp-key.h"
 #include "seahorse-pgp-uid.h"
+#include "seahorse-transfer.h"
+
+#include "test-hkp-server.h"
+#include "test-util.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+typedef struct _HkpTestFixture {
+    HkpTestServer *server;
+    SeahorseHKPSource *source;
+} HkpTestFixture;
+
+static void
+hkp_test_fixture_setup (HkpTestFixture *fixture,
+                        const void     *user_data)
+{
+    fixture->server = hkp_test_server_new (500);
+    fixture->source = seahorse_hkp_source_new (hkp_test_server_get_uri (fixture->server));
+    g_assert_nonnull (fixture->source);
+}
+
+static void
+hkp_test_fixture_teardown (HkpTestFixture *fixture,
+                           const void     *user_data)
+{
+    g_clear_object (&fixture->source);
+    g_clear_pointer (&fixture->server, hkp_test_server_free);
+}
+
+/* A real (public) key, for the GPGME keyring */
+static const char *TEST_PUBLIC_KEY =
+    "-----BEGIN PGP PUBLIC KEY BLOCK-----\n"
+    "\n"
+    "mDMEatVmExYJKwYBBAHaRw8BAQdAIh0DEYWICtop8jxkdL1ao4pRDmhLMcUKv9Wj\n"
+    "1KnMTDW0JFRyYW5zZmVyIFRlc3QgPHRyYW5zZmVyQGV4YW1wbGUub3JnPoiQBBMW\n"
+    "CAA4FiEEHrG7kpqQB7V/7QkyOwomk79xcjoFAmrVZhMCGwMFCwkIBwIGFQoJCAsC\n"
+    "BBYCAwECHgECF4AACgkQOwomk79xcjpA4QEAh9JPlC65hNOTxLv6hN4p/WOEqFPq\n"
+    "BTVkTAylyh32juAA/162yPJtxkUZ3HvyQUacS25+ppkKZcvGhgEIfzg7Gb0G\n"
+    "=zxJn\n"
+    "-----END PGP PUBLIC KEY BLOCK-----\n";
+
+typedef struct _KeyringTestFixture {
+    HkpTestServer *server;
+    SeahorseHKPSource *source;
+    SeahorseGpgmeKeyring *keyring;
+    char *tmpdir;
+} KeyringTestFixture;
+
+static void
+keyring_test_fixture_setup (KeyringTestFixture *fixture,
+                            const void         *user_data)
+{
+    g_autoptr(GError) error = NULL;
+
+    fixture->tmpdir = g_dir_make_tmp ("seahorse-gpgme-test-XXXXXX.d", &error);
+    g_assert_no_error (error);
+
+    seahorse_pgp_backend_initialize (fixture->tmpdir);
+    fixture->keyring = seahorse_pgp_backend_get_default_keyring (NULL);
+    g_assert_nonnull (fixture->keyring);
+
+    fixture->server = hkp_test_server_new (0);
+    fixture->source = seahorse_hkp_source_new (hkp_test_server_get_uri (fixture->server));
+}
+
+static void
+keyring_test_fixture_teardown (KeyringTestFixture *fixture,
+                               const void         *user_data)
+{
+    g_autoptr(GDir) dir = NULL;
+    const char *name;
+
+    /* GnuPG leaves its keyring files behind */
+    dir = g_dir_open (fixture->tmpdir, 0, NULL);
+    while (dir && (name = g_dir_read_name (dir)) != NULL) {
+        g_autofree char *path = g_build_filename (fixture->tmpdir, name, NULL);
+        g_remove (path);
+    }
+    g_rmdir (fixture->tmpdir);
+    g_clear_pointer (&fixture->tmpdir, g_free);
+
+    g_clear_object (&fixture->source);
+    g_clear_pointer (&fixture->server, hkp_test_server_free);
+}
 
 static void
 test_hkp_lookup_response_simple_no_uid (void)
@@ -115,6 +201,45 @@ test_hkp_lookup_response_empty (void)
     g_assert_cmpuint (g_list_length (keys), ==, 0);
 }
 
+static void
+test_hkp_lookup_response_bytes (void)
+{
+    const char *response =
+        "info:1:2\r\n"
+        "pub:0123456789ABCDEF0123456789ABCDEF01234567:17:2048:712627200:1028160000:r\r\n"
+        "uid:Niels%20De%20Graef%20%3Cnielsdegraef@gmail.com%3E:::\r\n"
+        "\r\n"
+        "pub:89ABCDEF0123456789ABCDEF0123456789ABCDEF:1:4096:712627200::\r\n"
+        "uid:Second:::TRAILING GARBAGE";
+    g_autoptr(GBytes) full = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    g_autolist(SeahorsePgpKey) keys = NULL;
+    SeahorsePgpKey *key;
+    g_autoptr(SeahorsePgpUid) uid = NULL;
+
+    /* Make sure we never look past the end of the (non-NUL-terminated) slice */
+    full = g_bytes_new_static (response, strlen (response));
+    bytes = g_bytes_new_from_bytes (full, 0, strlen (response) - strlen (":::TRAILING GARBAGE"));
+
+    keys = seahorse_hkp_parse_lookup_response_bytes (bytes);
+    g_assert_cmpuint (g_list_length (keys), ==, 2);
+
+    /* Keys are prepended */
+    key = keys->next->data;
+    g_assert_cmpstr (seahorse_pgp_key_get_algo (key), ==, "DSA");
+    g_assert_cmpuint (seahorse_pgp_key_get_length (key), ==, 2048);
+    g_assert_nonnull (seahorse_pgp_key_get_expires (key));
+    g_assert_true (seahorse_item_get_item_flags (SEAHORSE_ITEM (key)) & SEAHORSE_FLAG_REVOKED);
+
+    uid = g_list_model_get_item (seahorse_pgp_key_get_uids (key), 0);
+    g_assert_cmpstr (seahorse_pgp_uid_get_name (uid), ==, "Niels De Graef");
+    g_assert_cmpstr (seahorse_pgp_uid_get_email (uid), ==, "nielsdegraef@gmail.com");
+
+    /* The last uid line got cut off before its columns */
+    key = keys->data;
+    g_assert_cmpuint (g_list_model_get_n_items (seahorse_pgp_key_get_uids (key)), ==, 0);
+}
+
 static void
 test_hkp_is_valid_uri (void)
 {
@@ -131,6 +256,175 @@ test_hkp_is_valid_uri (void)
     g_assert_false (seahorse_hkp_is_valid_uri ("ldap://keys.openpgp.org"));
 }
 
+static void
+test_hkp_server_search (HkpTestFixture *fixture,
+                        const void     *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    g_autoptr(GListStore) results = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(SeahorsePgpKey) key = NULL;
+    gboolean ok;
+
+    results = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+    seahorse_server_source_search_async (source, "Test User", results, NULL,
+                                         test_util_async_ready, &result);
+    ok = seahorse_server_source_search_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_true (ok);
+
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (results)), ==,
+                      hkp_test_server_get_n_keys (fixture->server));
+
+    key = g_list_model_get_item (G_LIST_MODEL (results), 0);
+    g_assert_cmpuint (g_list_model_get_n_items (seahorse_pgp_key_get_uids (key)), ==, 1);
+}
+
+static void
+test_hkp_server_export (HkpTestFixture *fixture,
+                        const void     *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    const char *keyids[4];
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    g_autofree char *data = NULL;
+    unsigned int n_blocks = 0;
+
+    for (unsigned int i = 0; i < 3; i++)
+        keyids[i] = hkp_test_server_get_keyid (fixture->server, i * 100);
+    keyids[3] = NULL;
+
+    hkp_test_server_set_latency (fixture->server, 20);
+
+    seahorse_server_source_export_async (source, keyids, NULL, test_util_async_ready, &result);
+    bytes = seahorse_server_source_export_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (bytes);
+
+    data = g_strndup (g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+    for (const char *pos = strstr (data, "-----BEGIN PGP PUBLIC KEY BLOCK-----");
+         pos != NULL;
+         pos = strstr (pos + 1, "-----BEGIN PGP PUBLIC KEY BLOCK-----"))
+        n_blocks++;
+    g_assert_cmpuint (n_blocks, ==, 3);
+    g_assert_cmpuint (hkp_test_server_get_n_requests (fixture->server), ==, 3);
+}
+
+static void
+test_hkp_server_import (HkpTestFixture *fixture,
+                        const void     *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    g_autoptr(GString) bundle = NULL;
+    g_autoptr(GInputStream) input = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    GList *imported;
+
+    /* Some blocks, with junk in between and a truncated one at the end */
+    bundle = g_string_new ("Some header text\n");
+    for (unsigned int i = 0; i < 3; i++) {
+        g_string_append (bundle, "-----BEGIN PGP PUBLIC KEY BLOCK-----\n\n");
+        for (unsigned int j = 0; j < 2000; j++)
+            g_string_append (bundle, "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVo=\n");
+        g_string_append (bundle, "-----END PGP PUBLIC KEY BLOCK-----\nJunk\n");
+    }
+    g_string_append (bundle, "-----BEGIN PGP PUBLIC KEY BLOCK-----\n\nQUJD");
+
+    input = g_memory_input_stream_new_from_data (g_strdup (bundle->str), bundle->len, g_free);
+
+    seahorse_server_source_import_async (source, input, NULL, test_util_async_ready, &result);
+    imported = seahorse_server_source_import_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_null (imported);
+
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->server), ==, 3);
+}
+
+static void
+test_hkp_server_transfer (HkpTestFixture *fixture,
+                          const void     *user_data)
+{
+    g_autoptr(HkpTestServer) other_server = NULL;
+    g_autoptr(SeahorseHKPSource) other = NULL;
+    const char *keyids[4];
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    gboolean ok;
+
+    other_server = hkp_test_server_new (0);
+    other = seahorse_hkp_source_new (hkp_test_server_get_uri (other_server));
+
+    for (unsigned int i = 0; i < 3; i++)
+        keyids[i] = hkp_test_server_get_keyid (fixture->server, i * 100);
+    keyids[3] = NULL;
+
+    seahorse_transfer_keyids_async (SEAHORSE_SERVER_SOURCE (fixture->source),
+                                    SEAHORSE_PLACE (other), keyids,
+                                    NULL, test_util_async_ready, &result);
+    ok = seahorse_transfer_finish (test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_true (ok);
+
+    g_assert_cmpuint (hkp_test_server_get_n_added (other_server), ==, 3);
+}
+
+static void
+test_hkp_keyring_transfer (KeyringTestFixture *fixture,
+                           const void         *user_data)
+{
+    g_autoptr(GInputStream) input = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    GList *keys;
+    gboolean ok;
+
+    input = g_memory_input_stream_new_from_data (TEST_PUBLIC_KEY, -1, NULL);
+    seahorse_gpgme_keyring_import_async (fixture->keyring, input, NULL,
+                                         test_util_async_ready, &result);
+    keys = seahorse_gpgme_keyring_import_finish (fixture->keyring,
+                                                 test_util_wait_for_result (&result),
+                                                 &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (g_list_length (keys), ==, 1);
+    g_clear_object (&result);
+
+    /* The keyring exports into a pipe, the server reads the other end */
+    seahorse_transfer_keys_async (SEAHORSE_PLACE (fixture->keyring),
+                                  SEAHORSE_PLACE (fixture->source), keys,
+                                  NULL, test_util_async_ready, &result);
+    ok = seahorse_transfer_finish (test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_true (ok);
+    g_list_free (keys);
+
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->server), ==, 1);
+}
+
+static void
+test_hkp_server_failure (HkpTestFixture *fixture,
+                         const void     *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    g_autoptr(GListStore) results = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    gboolean ok;
+
+    hkp_test_server_set_fail_every (fixture->server, 1);
+
+    results = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+    seahorse_server_source_search_async (source, "Test User", results, NULL,
+                                         test_util_async_ready, &result);
+    ok = seahorse_server_source_search_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_nonnull (error);
+    g_assert_false (ok);
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (results)), ==, 0);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -140,6 +434,32 @@ main (int argc, char **argv)
     g_test_add_func ("/hkp/lookup-response-empty", test_hkp_lookup_response_empty);
     g_test_add_func ("/hkp/lookup-response-simple", test_hkp_lookup_response_simple);
     g_test_add_func ("/hkp/lookup-response-simple-no-uid", test_hkp_lookup_response_simple_no_uid);
+    g_test_add_func ("/hkp/lookup-response-bytes", test_hkp_lookup_response_bytes);
+
+    g_test_add ("/hkp/server/search", HkpTestFixture, NULL,
+                hkp_test_fixture_setup,
+                test_hkp_server_search,
+                hkp_test_fixture_teardown);
+    g_test_add ("/hkp/server/export", HkpTestFixture, NULL,
+                hkp_test_fixture_setup,
+                test_hkp_server_export,
+                hkp_test_fixture_teardown);
+    g_test_add ("/hkp/server/import", HkpTestFixture, NULL,
+                hkp_test_fixture_setup,
+                test_hkp_server_import,
+                hkp_test_fixture_teardown);
+    g_test_add ("/hkp/server/transfer", HkpTestFixture, NULL,
+                hkp_test_fixture_setup,
+                test_hkp_server_transfer,
+                hkp_test_fixture_teardown);
+    g_test_add ("/hkp/keyring/transfer", KeyringTestFixture, NULL,
+                keyring_test_fixture_setup,
+                test_hkp_keyring_transfer,
+                keyring_test_fixture_teardown);
+    g_test_add ("/hkp/server/failure", HkpTestFixture, NULL,
+                hkp_test_fixture_setup,
+                test_hkp_server_failure,
+                hkp_test_fixture_teardown);
 
     return g_test_run ();
 }
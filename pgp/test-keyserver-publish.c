@@ -0,0 +1,227 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "seahorse-hkp-source.h"
+#include "seahorse-keyserver-publish.h"
+#include "seahorse-pgp-key.h"
+
+#include "test-hkp-server.h"
+#include "test-util.h"
+
+#include <glib.h>
+
+#define N_KEYS 20
+
+typedef struct _PublishTestFixture {
+    HkpTestServer *server;
+    HkpTestServer *target_server;
+    SeahorseHKPSource *source;
+    GListStore *remotes;
+    GListStore *keys;
+    char *target_uri;
+    char *tmpdir;
+    char *state_path;
+} PublishTestFixture;
+
+static void
+publish_test_fixture_setup (PublishTestFixture *fixture,
+                            const void         *user_data)
+{
+    g_autoptr(SeahorseHKPSource) target = NULL;
+
+    /* Where the keys come from */
+    fixture->server = hkp_test_server_new (N_KEYS);
+    fixture->source = seahorse_hkp_source_new (hkp_test_server_get_uri (fixture->server));
+
+    fixture->keys = test_util_search_keys (SEAHORSE_SERVER_SOURCE (fixture->source), "Test User");
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (fixture->keys)), ==, N_KEYS);
+
+    /* And where they get published */
+    fixture->target_server = hkp_test_server_new (0);
+    fixture->target_uri = g_strdup (hkp_test_server_get_uri (fixture->target_server));
+    target = seahorse_hkp_source_new (fixture->target_uri);
+    fixture->remotes = g_list_store_new (SEAHORSE_TYPE_SERVER_SOURCE);
+    g_list_store_append (fixture->remotes, target);
+
+    test_util_make_state_dir ("publish-test", "publish-queue", &fixture->tmpdir, &fixture->state_path);
+}
+
+static void
+publish_test_fixture_teardown (PublishTestFixture *fixture,
+                               const void         *user_data)
+{
+    test_util_remove_state_dir (&fixture->tmpdir, &fixture->state_path);
+    g_clear_pointer (&fixture->target_uri, g_free);
+    g_clear_object (&fixture->keys);
+    g_clear_object (&fixture->remotes);
+    g_clear_object (&fixture->source);
+    g_clear_pointer (&fixture->target_server, hkp_test_server_free);
+    g_clear_pointer (&fixture->server, hkp_test_server_free);
+}
+
+static SeahorseKeyserverPublish *
+new_publish (PublishTestFixture *fixture)
+{
+    return seahorse_keyserver_publish_new (SEAHORSE_PLACE (fixture->source),
+                                           G_LIST_MODEL (fixture->keys),
+                                           G_LIST_MODEL (fixture->remotes),
+                                           fixture->state_path);
+}
+
+static gboolean
+all_in_state (PublishTestFixture       *fixture,
+              SeahorseKeyserverPublish *publish,
+              SeahorsePublishState      state)
+{
+    for (unsigned int i = 0; i < N_KEYS; i++) {
+        g_autoptr(SeahorsePgpKey) key = NULL;
+
+        key = g_list_model_get_item (G_LIST_MODEL (fixture->keys), i);
+        if (seahorse_keyserver_publish_get_state (publish,
+                                                  seahorse_pgp_key_get_fingerprint (key),
+                                                  fixture->target_uri) != state)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+wait_for_state (PublishTestFixture       *fixture,
+                SeahorseKeyserverPublish *publish,
+                SeahorsePublishState      state)
+{
+    int64_t deadline = g_get_monotonic_time () + 30 * G_TIME_SPAN_SECOND;
+
+    while (!all_in_state (fixture, publish, state)) {
+        g_assert_cmpint (g_get_monotonic_time (), <, deadline);
+        g_main_context_iteration (NULL, TRUE);
+    }
+}
+
+static void
+test_publish_all (PublishTestFixture *fixture,
+                  const void         *user_data)
+{
+    g_autoptr(SeahorseKeyserverPublish) publish = NULL;
+
+    publish = new_publish (fixture);
+    g_assert_cmpuint (seahorse_keyserver_publish_get_n_queued (publish), ==, 0);
+
+    seahorse_keyserver_publish_add (publish, G_LIST_MODEL (fixture->keys),
+                                    fixture->target_uri);
+    g_assert_cmpuint (seahorse_keyserver_publish_get_n_queued (publish), ==, N_KEYS);
+    g_assert_true (all_in_state (fixture, publish, SEAHORSE_PUBLISH_PENDING));
+
+    wait_for_state (fixture, publish, SEAHORSE_PUBLISH_NONE);
+    g_assert_cmpuint (seahorse_keyserver_publish_get_n_queued (publish), ==, 0);
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->target_server), ==, N_KEYS);
+}
+
+static void
+test_publish_add_while_sending (PublishTestFixture *fixture,
+                                const void         *user_data)
+{
+    g_autoptr(SeahorseKeyserverPublish) publish = NULL;
+
+    /* Keeps the first batch on its way for a while */
+    hkp_test_server_set_latency (fixture->target_server, 50);
+
+    publish = new_publish (fixture);
+    seahorse_keyserver_publish_add (publish, G_LIST_MODEL (fixture->keys),
+                                    fixture->target_uri);
+    wait_for_state (fixture, publish, SEAHORSE_PUBLISH_SENDING);
+
+    /* The keys changed in the meantime, so they need to go out again */
+    seahorse_keyserver_publish_add (publish, G_LIST_MODEL (fixture->keys),
+                                    fixture->target_uri);
+    g_assert_true (all_in_state (fixture, publish, SEAHORSE_PUBLISH_SENDING));
+
+    wait_for_state (fixture, publish, SEAHORSE_PUBLISH_NONE);
+    g_assert_cmpuint (seahorse_keyserver_publish_get_n_queued (publish), ==, 0);
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->target_server), ==, 2 * N_KEYS);
+}
+
+static void
+on_publish_failed (SeahorseKeyserverPublish *publish,
+                   const char               *uri,
+                   unsigned int              n_keys,
+                   GError                   *error,
+                   void                     *user_data)
+{
+    unsigned int *n_failed = user_data;
+
+    g_assert_nonnull (error);
+    *n_failed += n_keys;
+}
+
+static void
+test_publish_offline (PublishTestFixture *fixture,
+                      const void         *user_data)
+{
+    g_autoptr(SeahorseKeyserverPublish) publish = NULL;
+    unsigned int n_failed = 0;
+
+    /* The server is unreachable for now */
+    hkp_test_server_set_fail_every (fixture->target_server, 1);
+
+    publish = new_publish (fixture);
+    g_signal_connect (publish, "failed", G_CALLBACK (on_publish_failed), &n_failed);
+    seahorse_keyserver_publish_add (publish, G_LIST_MODEL (fixture->keys),
+                                    fixture->target_uri);
+    wait_for_state (fixture, publish, SEAHORSE_PUBLISH_RETRYING);
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->target_server), ==, 0);
+
+    /* Whoever added the keys hears about it, once */
+    g_assert_cmpuint (n_failed, ==, N_KEYS);
+
+    /* Nothing gets lost when we quit in the meantime */
+    g_clear_object (&publish);
+    publish = new_publish (fixture);
+    g_assert_cmpuint (seahorse_keyserver_publish_get_n_queued (publish), ==, N_KEYS);
+    g_assert_true (all_in_state (fixture, publish, SEAHORSE_PUBLISH_RETRYING));
+
+    /* Once it's back, everything goes out without waiting for the back-off */
+    hkp_test_server_set_fail_every (fixture->target_server, 0);
+    seahorse_keyserver_publish_retry_now (publish);
+    wait_for_state (fixture, publish, SEAHORSE_PUBLISH_NONE);
+    g_assert_cmpuint (seahorse_keyserver_publish_get_n_queued (publish), ==, 0);
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->target_server), ==, N_KEYS);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/keyserver-publish/all", PublishTestFixture, NULL,
+                publish_test_fixture_setup,
+                test_publish_all,
+                publish_test_fixture_teardown);
+    g_test_add ("/keyserver-publish/add-while-sending", PublishTestFixture, NULL,
+                publish_test_fixture_setup,
+                test_publish_add_while_sending,
+                publish_test_fixture_teardown);
+    g_test_add ("/keyserver-publish/offline", PublishTestFixture, NULL,
+                publish_test_fixture_setup,
+                test_publish_offline,
+                publish_test_fixture_teardown);
+
+    return g_test_run ();
+}
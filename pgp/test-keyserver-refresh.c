@@ -0,0 +1,176 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "seahorse-hkp-source.h"
+#include "seahorse-keyserver-refresh.h"
+#include "seahorse-pgp-key.h"
+
+#include "test-hkp-server.h"
+#include "test-util.h"
+
+#include <glib.h>
+
+#define N_KEYS 20
+
+typedef struct _RefreshTestFixture {
+    HkpTestServer *server;
+    HkpTestServer *target_server;
+    SeahorseHKPSource *target;
+    GListStore *remotes;
+    GListStore *keys;
+    char *tmpdir;
+    char *state_path;
+} RefreshTestFixture;
+
+static void
+refresh_test_fixture_setup (RefreshTestFixture *fixture,
+                            const void         *user_data)
+{
+    g_autoptr(SeahorseHKPSource) source = NULL;
+
+    fixture->server = hkp_test_server_new (N_KEYS);
+    source = seahorse_hkp_source_new (hkp_test_server_get_uri (fixture->server));
+    fixture->remotes = g_list_store_new (SEAHORSE_TYPE_SERVER_SOURCE);
+    g_list_store_append (fixture->remotes, source);
+
+    /* Updated keys get uploaded here, so we can count them */
+    fixture->target_server = hkp_test_server_new (0);
+    fixture->target = seahorse_hkp_source_new (hkp_test_server_get_uri (fixture->target_server));
+
+    /* The keys we want to keep fresh */
+    fixture->keys = test_util_search_keys (SEAHORSE_SERVER_SOURCE (source), "Test User");
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (fixture->keys)), ==, N_KEYS);
+
+    test_util_make_state_dir ("refresh-test", "keyserver-refresh", &fixture->tmpdir, &fixture->state_path);
+}
+
+static void
+refresh_test_fixture_teardown (RefreshTestFixture *fixture,
+                               const void         *user_data)
+{
+    test_util_remove_state_dir (&fixture->tmpdir, &fixture->state_path);
+    g_clear_object (&fixture->keys);
+    g_clear_object (&fixture->remotes);
+    g_clear_object (&fixture->target);
+    g_clear_pointer (&fixture->target_server, hkp_test_server_free);
+    g_clear_pointer (&fixture->server, hkp_test_server_free);
+}
+
+static SeahorseKeyserverRefresh *
+new_refresh (RefreshTestFixture *fixture)
+{
+    return seahorse_keyserver_refresh_new (G_LIST_MODEL (fixture->keys),
+                                           G_LIST_MODEL (fixture->remotes),
+                                           SEAHORSE_PLACE (fixture->target),
+                                           fixture->state_path);
+}
+
+/* Returns when the key was refreshed first */
+static int64_t
+wait_for_all_refreshed (RefreshTestFixture       *fixture,
+                        SeahorseKeyserverRefresh *refresh)
+{
+    int64_t deadline = g_get_monotonic_time () + 30 * G_TIME_SPAN_SECOND;
+
+    while (g_get_monotonic_time () < deadline) {
+        int64_t first = G_MAXINT64;
+
+        for (unsigned int i = 0; i < N_KEYS; i++) {
+            g_autoptr(SeahorsePgpKey) key = NULL;
+            int64_t refreshed;
+
+            key = g_list_model_get_item (G_LIST_MODEL (fixture->keys), i);
+            refreshed = seahorse_keyserver_refresh_get_last_refreshed (refresh,
+                                                                       seahorse_pgp_key_get_fingerprint (key));
+            first = MIN (first, refreshed);
+        }
+
+        if (first > 0)
+            return first;
+
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+    g_assert_not_reached ();
+}
+
+static void
+test_refresh_all (RefreshTestFixture *fixture,
+                  const void         *user_data)
+{
+    g_autoptr(SeahorseKeyserverRefresh) refresh = NULL;
+    int64_t first;
+
+    refresh = new_refresh (fixture);
+
+    /* Nothing happens until there's a window */
+    g_assert_cmpint (seahorse_keyserver_refresh_get_window (refresh), ==, 0);
+    g_assert_cmpint (seahorse_keyserver_refresh_get_next_due (refresh), ==, 0);
+
+    seahorse_keyserver_refresh_set_window (refresh, G_TIME_SPAN_SECOND);
+
+    first = wait_for_all_refreshed (fixture, refresh);
+    g_assert_cmpuint (hkp_test_server_get_n_added (fixture->target_server), ==, N_KEYS);
+
+    /* The next round only starts in the next window */
+    g_assert_cmpint (seahorse_keyserver_refresh_get_next_due (refresh), >,
+                     first + G_TIME_SPAN_SECOND / 2);
+}
+
+static void
+test_refresh_persists (RefreshTestFixture *fixture,
+                       const void         *user_data)
+{
+    g_autoptr(SeahorseKeyserverRefresh) refresh = NULL;
+    g_autoptr(SeahorsePgpKey) key = NULL;
+    const char *fingerprint;
+    int64_t refreshed;
+
+    refresh = new_refresh (fixture);
+    seahorse_keyserver_refresh_set_window (refresh, G_TIME_SPAN_SECOND);
+    wait_for_all_refreshed (fixture, refresh);
+
+    key = g_list_model_get_item (G_LIST_MODEL (fixture->keys), 0);
+    fingerprint = seahorse_pgp_key_get_fingerprint (key);
+    refreshed = seahorse_keyserver_refresh_get_last_refreshed (refresh, fingerprint);
+    g_assert_cmpint (refreshed, >, 0);
+    g_clear_object (&refresh);
+
+    /* A new session knows the keys were just refreshed */
+    refresh = new_refresh (fixture);
+    g_assert_cmpint (seahorse_keyserver_refresh_get_last_refreshed (refresh, fingerprint), ==, refreshed);
+    g_assert_cmpint (seahorse_keyserver_refresh_get_next_due (refresh), >, g_get_real_time ());
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/keyserver-refresh/all", RefreshTestFixture, NULL,
+                refresh_test_fixture_setup,
+                test_refresh_all,
+                refresh_test_fixture_teardown);
+    g_test_add ("/keyserver-refresh/persists", RefreshTestFixture, NULL,
+                refresh_test_fixture_setup,
+                test_refresh_persists,
+                refresh_test_fixture_teardown);
+
+    return g_test_run ();
+}
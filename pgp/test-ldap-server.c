@@ -0,0 +1,935 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "test-ldap-server.h"
+
+#include <ldap.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PGP_KEY_BEGIN   "-----BEGIN PGP PUBLIC KEY BLOCK-----"
+#define PGP_KEY_END     "-----END PGP PUBLIC KEY BLOCK-----"
+
+/* Size of the random payload in a synthetic key block */
+#define KEY_PAYLOAD_SIZE 2048
+
+/* The creation date of all synthetic keys */
+#define KEY_CREATED "20210101000000Z"
+
+/* We send out search results in chunks of about this size */
+#define OUTPUT_CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+    char *keyid;
+    char *uid;
+} LdapTestKey;
+
+struct _LdapTestServer {
+    GSocketService *service;
+    char *uri;
+
+    GPtrArray *keys;
+
+    /* Accessed from the worker threads */
+    int latency_ms;
+    int paging;
+    int n_binds;
+    int n_searches;
+    int n_added;
+};
+
+static void
+ldap_test_key_free (void *data)
+{
+    LdapTestKey *key = data;
+    g_free (key->keyid);
+    g_free (key->uid);
+    g_free (key);
+}
+
+static LdapTestKey *
+ldap_test_key_new (unsigned int index)
+{
+    LdapTestKey *key;
+    g_autofree char *seed = NULL;
+    g_autofree char *checksum = NULL;
+
+    key = g_new0 (LdapTestKey, 1);
+
+    seed = g_strdup_printf ("seahorse-ldap-test-key-%u", index);
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, seed, -1);
+    key->keyid = g_ascii_strup (checksum + 24, -1);
+    key->uid = g_strdup_printf ("Test User %u <user%u@example.org>", index, index);
+
+    return key;
+}
+
+static char *
+build_key_block (unsigned int index)
+{
+    g_autoptr(GRand) rand = NULL;
+    g_autofree guint8 *payload = NULL;
+    g_autofree char *encoded = NULL;
+    GString *block;
+    size_t len;
+
+    rand = g_rand_new_with_seed (index);
+    payload = g_malloc (KEY_PAYLOAD_SIZE);
+    for (size_t i = 0; i < KEY_PAYLOAD_SIZE; i++)
+        payload[i] = g_rand_int_range (rand, 0, 256);
+
+    encoded = g_base64_encode (payload, KEY_PAYLOAD_SIZE);
+    len = strlen (encoded);
+
+    block = g_string_sized_new (len + len / 64 + 128);
+    g_string_append (block, PGP_KEY_BEGIN "\n\n");
+    for (size_t i = 0; i < len; i += 64) {
+        g_string_append_len (block, encoded + i, MIN (64, len - i));
+        g_string_append_c (block, '\n');
+    }
+    g_string_append (block, "=TEST\n" PGP_KEY_END "\n");
+
+    return g_string_free (block, FALSE);
+}
+
+/* -----------------------------------------------------------------------------
+ * BER
+ *
+ * Just enough of the encoding to handle the LDAP messages we care about:
+ * single byte tags, and definite lengths.
+ */
+
+typedef struct {
+    const guint8 *data;
+    size_t len;
+} TlvSlice;
+
+/* Reads the next element from @in, and moves past it */
+static gboolean
+tlv_read (TlvSlice *in,
+          guint8   *tag,
+          TlvSlice *value)
+{
+    size_t len, pos = 2;
+
+    if (in->len < 2)
+        return FALSE;
+
+    *tag = in->data[0];
+    len = in->data[1];
+    if (len & 0x80) {
+        size_t n_bytes = len & 0x7f;
+
+        if (n_bytes == 0 || n_bytes > 4 || in->len < 2 + n_bytes)
+            return FALSE;
+
+        len = 0;
+        for (size_t i = 0; i < n_bytes; i++)
+            len = (len << 8) | in->data[2 + i];
+        pos += n_bytes;
+    }
+
+    if (in->len - pos < len)
+        return FALSE;
+
+    value->data = in->data + pos;
+    value->len = len;
+    in->data += pos + len;
+    in->len -= pos + len;
+    return TRUE;
+}
+
+static gboolean
+tlv_read_expect (TlvSlice *in,
+                 guint8    expected,
+                 TlvSlice *value)
+{
+    guint8 tag;
+
+    return tlv_read (in, &tag, value) && tag == expected;
+}
+
+static unsigned int
+tlv_to_uint (const TlvSlice *value)
+{
+    unsigned int result = 0;
+
+    for (size_t i = 0; i < value->len; i++)
+        result = (result << 8) | value->data[i];
+    return result;
+}
+
+static gboolean
+tlv_equal (const TlvSlice *value,
+           const char     *str)
+{
+    size_t len = strlen (str);
+
+    return value->len == len &&
+           g_ascii_strncasecmp ((const char *) value->data, str, len) == 0;
+}
+
+static void
+tlv_append (GByteArray *out,
+            guint8      tag,
+            const void *data,
+            size_t      len)
+{
+    guint8 header[6];
+    size_t n = 0;
+
+    header[n++] = tag;
+    if (len < 0x80) {
+        header[n++] = len;
+    } else {
+        unsigned int n_bytes = 0;
+
+        for (size_t l = len; l > 0; l >>= 8)
+            n_bytes++;
+        header[n++] = 0x80 | n_bytes;
+        for (int i = n_bytes - 1; i >= 0; i--)
+            header[n++] = (len >> (8 * i)) & 0xff;
+    }
+
+    g_byte_array_append (out, header, n);
+    g_byte_array_append (out, data, len);
+}
+
+static void
+tlv_append_string (GByteArray *out,
+                   const char *str)
+{
+    tlv_append (out, LBER_OCTETSTRING, str, strlen (str));
+}
+
+static void
+tlv_append_uint (GByteArray   *out,
+                 guint8        tag,
+                 unsigned int  value)
+{
+    guint8 bytes[5] = { 0, value >> 24, value >> 16, value >> 8, value };
+    size_t start = 0;
+
+    /* Shortest encoding, but keep a zero byte if the sign bit would be set */
+    while (start < 4 && bytes[start] == 0 && !(bytes[start + 1] & 0x80))
+        start++;
+
+    tlv_append (out, tag, bytes + start, sizeof (bytes) - start);
+}
+
+static void
+tlv_append_array (GByteArray *out,
+                  guint8      tag,
+                  GByteArray *inner)
+{
+    tlv_append (out, tag, inner->data, inner->len);
+}
+
+/* -----------------------------------------------------------------------------
+ * LDAP
+ */
+
+static void
+append_message (GByteArray   *out,
+                unsigned int  msgid,
+                guint8        op_tag,
+                GByteArray   *op,
+                GByteArray   *controls)
+{
+    g_autoptr(GByteArray) message = g_byte_array_new ();
+
+    tlv_append_uint (message, LBER_INTEGER, msgid);
+    tlv_append_array (message, op_tag, op);
+    if (controls)
+        tlv_append_array (message, LDAP_TAG_CONTROLS, controls);
+
+    tlv_append_array (out, LBER_SEQUENCE, message);
+}
+
+static void
+append_result (GByteArray   *out,
+               unsigned int  msgid,
+               guint8        op_tag,
+               int           code,
+               GByteArray   *controls)
+{
+    g_autoptr(GByteArray) result = g_byte_array_new ();
+
+    tlv_append_uint (result, LBER_ENUMERATED, code);
+    tlv_append_string (result, "");     /* matchedDN */
+    tlv_append_string (result, "");     /* diagnosticMessage */
+
+    append_message (out, msgid, op_tag, result, controls);
+}
+
+static void
+append_attribute (GByteArray *attributes,
+                  const char *name,
+                  size_t      name_len,
+                  const char *value)
+{
+    g_autoptr(GByteArray) attribute = g_byte_array_new ();
+    g_autoptr(GByteArray) values = g_byte_array_new ();
+
+    tlv_append_string (values, value);
+    tlv_append (attribute, LBER_OCTETSTRING, name, name_len);
+    tlv_append_array (attribute, LBER_SET, values);
+    tlv_append_array (attributes, LBER_SEQUENCE, attribute);
+}
+
+static void
+append_entry (GByteArray   *out,
+              unsigned int  msgid,
+              const char   *dn,
+              GByteArray   *attributes)
+{
+    g_autoptr(GByteArray) entry = g_byte_array_new ();
+
+    tlv_append_string (entry, dn);
+    tlv_append_array (entry, LBER_SEQUENCE, attributes);
+
+    append_message (out, msgid, LDAP_RES_SEARCH_ENTRY, entry, NULL);
+}
+
+static gboolean
+flush_output (GOutputStream *output,
+              GByteArray    *out)
+{
+    gboolean ret;
+
+    ret = g_output_stream_write_all (output, out->data, out->len, NULL, NULL, NULL);
+    g_byte_array_set_size (out, 0);
+    return ret;
+}
+
+/* The attributes we can match on, all single valued */
+static const char *
+key_get_attribute (LdapTestKey    *key,
+                   const TlvSlice *attr)
+{
+    if (tlv_equal (attr, "pgpcertid"))
+        return key->keyid;
+    if (tlv_equal (attr, "pgpuserid"))
+        return key->uid;
+    if (tlv_equal (attr, "pgpkeycreatetime"))
+        return KEY_CREATED;
+    if (tlv_equal (attr, "pgpkeysize"))
+        return "4096";
+    if (tlv_equal (attr, "pgpkeytype"))
+        return "RSA";
+    if (tlv_equal (attr, "pgprevoked") || tlv_equal (attr, "pgpdisabled"))
+        return "0";
+    if (tlv_equal (attr, "objectclass"))
+        return "pgpKeyInfo";
+    return NULL;
+}
+
+/* Like strstr(), but case insensitive and with a length */
+static const char *
+find_nocase (const char     *haystack,
+             size_t          len,
+             const TlvSlice *needle)
+{
+    for (size_t i = 0; i + needle->len <= len; i++) {
+        if (g_ascii_strncasecmp (haystack + i, (const char *) needle->data, needle->len) == 0)
+            return haystack + i;
+    }
+    return NULL;
+}
+
+static gboolean
+substrings_match (const char *value,
+                  TlvSlice    parts)
+{
+    const char *pos = value;
+    size_t remaining = strlen (value);
+    TlvSlice part;
+    guint8 tag;
+
+    while (parts.len > 0 && tlv_read (&parts, &tag, &part)) {
+        const char *found;
+
+        switch (tag) {
+        case LDAP_SUBSTRING_INITIAL:
+            if (remaining < part.len ||
+                g_ascii_strncasecmp (pos, (const char *) part.data, part.len) != 0)
+                return FALSE;
+            break;
+        case LDAP_SUBSTRING_ANY:
+            found = find_nocase (pos, remaining, &part);
+            if (found == NULL)
+                return FALSE;
+            remaining -= found - pos;
+            pos = found;
+            break;
+        case LDAP_SUBSTRING_FINAL:
+            if (remaining < part.len ||
+                g_ascii_strncasecmp (pos + remaining - part.len,
+                                     (const char *) part.data, part.len) != 0)
+                return FALSE;
+            break;
+        default:
+            return FALSE;
+        }
+
+        pos += part.len;
+        remaining -= part.len;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+filter_matches (LdapTestKey *key,
+                guint8       tag,
+                TlvSlice     filter)
+{
+    TlvSlice attr, value;
+    const char *actual;
+    guint8 sub_tag;
+
+    switch (tag) {
+    case LDAP_FILTER_AND:
+    case LDAP_FILTER_OR:
+        while (filter.len > 0 && tlv_read (&filter, &sub_tag, &value)) {
+            gboolean matches = filter_matches (key, sub_tag, value);
+
+            if (tag == LDAP_FILTER_OR && matches)
+                return TRUE;
+            if (tag == LDAP_FILTER_AND && !matches)
+                return FALSE;
+        }
+        return tag == LDAP_FILTER_AND;
+
+    case LDAP_FILTER_NOT:
+        return tlv_read (&filter, &sub_tag, &value) &&
+               !filter_matches (key, sub_tag, value);
+
+    case LDAP_FILTER_EQUALITY:
+        if (!tlv_read_expect (&filter, LBER_OCTETSTRING, &attr) ||
+            !tlv_read_expect (&filter, LBER_OCTETSTRING, &value))
+            return FALSE;
+        actual = key_get_attribute (key, &attr);
+        return actual && tlv_equal (&value, actual);
+
+    case LDAP_FILTER_SUBSTRINGS:
+        if (!tlv_read_expect (&filter, LBER_OCTETSTRING, &attr) ||
+            !tlv_read_expect (&filter, LBER_SEQUENCE, &value))
+            return FALSE;
+        actual = key_get_attribute (key, &attr);
+        return actual && substrings_match (actual, value);
+
+    case LDAP_FILTER_PRESENT:
+        return key_get_attribute (key, &filter) != NULL;
+
+    default:
+        return FALSE;
+    }
+}
+
+/* Looks for the paged results control (RFC 2696) */
+static gboolean
+parse_page_control (TlvSlice      controls,
+                    unsigned int *page_size,
+                    unsigned int *offset)
+{
+    TlvSlice control, oid, value, request, size, cookie;
+    guint8 tag;
+
+    while (controls.len > 0 && tlv_read_expect (&controls, LBER_SEQUENCE, &control)) {
+        if (!tlv_read_expect (&control, LBER_OCTETSTRING, &oid) ||
+            !tlv_equal (&oid, LDAP_CONTROL_PAGEDRESULTS))
+            continue;
+
+        /* Skip the criticality */
+        if (control.len > 0 && control.data[0] == LBER_BOOLEAN &&
+            !tlv_read (&control, &tag, &value))
+            return FALSE;
+
+        if (!tlv_read_expect (&control, LBER_OCTETSTRING, &value) ||
+            !tlv_read_expect (&value, LBER_SEQUENCE, &request) ||
+            !tlv_read_expect (&request, LBER_INTEGER, &size) ||
+            !tlv_read_expect (&request, LBER_OCTETSTRING, &cookie))
+            return FALSE;
+
+        /* Our cookie is simply the index of the next key to look at */
+        *page_size = tlv_to_uint (&size);
+        *offset = 0;
+        for (size_t i = 0; i < cookie.len && g_ascii_isdigit (cookie.data[i]); i++)
+            *offset = *offset * 10 + (cookie.data[i] - '0');
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static GByteArray *
+build_page_control (unsigned int next_offset)
+{
+    g_autoptr(GByteArray) request = g_byte_array_new ();
+    g_autoptr(GByteArray) value = g_byte_array_new ();
+    g_autoptr(GByteArray) control = g_byte_array_new ();
+    g_autofree char *cookie = NULL;
+    GByteArray *controls;
+
+    /* An empty cookie tells the client there are no more pages */
+    cookie = next_offset ? g_strdup_printf ("%u", next_offset) : g_strdup ("");
+
+    tlv_append_uint (request, LBER_INTEGER, 0);
+    tlv_append_string (request, cookie);
+    tlv_append_array (value, LBER_SEQUENCE, request);
+
+    tlv_append_string (control, LDAP_CONTROL_PAGEDRESULTS);
+    tlv_append_array (control, LBER_OCTETSTRING, value);
+
+    controls = g_byte_array_new ();
+    tlv_append_array (controls, LBER_SEQUENCE, control);
+    return controls;
+}
+
+static void
+append_key_entry (GByteArray     *out,
+                  unsigned int    msgid,
+                  LdapTestKey    *key,
+                  unsigned int    index,
+                  TlvSlice        attrs)
+{
+    static const char *DEFAULT_ATTRS[] = {
+        "pgpcertid", "pgpuserid", "pgprevoked", "pgpdisabled",
+        "pgpkeycreatetime", "pgpkeysize", "pgpkeytype", NULL
+    };
+    g_autoptr(GByteArray) attributes = g_byte_array_new ();
+    g_autofree char *dn = NULL;
+    TlvSlice attr;
+
+    /* No attributes asked for means all of them (except the key data) */
+    if (attrs.len == 0) {
+        for (unsigned int i = 0; DEFAULT_ATTRS[i]; i++) {
+            TlvSlice name = { (const guint8 *) DEFAULT_ATTRS[i], strlen (DEFAULT_ATTRS[i]) };
+            append_attribute (attributes, DEFAULT_ATTRS[i], name.len,
+                              key_get_attribute (key, &name));
+        }
+    }
+
+    while (attrs.len > 0 && tlv_read_expect (&attrs, LBER_OCTETSTRING, &attr)) {
+        const char *value;
+
+        if (tlv_equal (&attr, "pgpkey") || tlv_equal (&attr, "pgpkeyv2")) {
+            g_autofree char *block = build_key_block (index);
+            append_attribute (attributes, (const char *) attr.data, attr.len, block);
+            continue;
+        }
+
+        value = key_get_attribute (key, &attr);
+        if (value != NULL)
+            append_attribute (attributes, (const char *) attr.data, attr.len, value);
+    }
+
+    dn = g_strdup_printf ("pgpCertID=%s," LDAP_TEST_SERVER_BASE_DN, key->keyid);
+    append_entry (out, msgid, dn, attributes);
+}
+
+static gboolean
+handle_search (LdapTestServer *server,
+               GOutputStream  *output,
+               GByteArray     *out,
+               unsigned int    msgid,
+               TlvSlice        request,
+               TlvSlice        controls)
+{
+    TlvSlice base, scope, deref, size_limit, time_limit, types_only, filter, attrs;
+    unsigned int page_size = 0, offset = 0, next_offset = 0, n_sent = 0;
+    g_autoptr(GByteArray) response_controls = NULL;
+    gboolean paged;
+    guint8 filter_tag;
+
+    if (!tlv_read_expect (&request, LBER_OCTETSTRING, &base) ||
+        !tlv_read_expect (&request, LBER_ENUMERATED, &scope) ||
+        !tlv_read_expect (&request, LBER_ENUMERATED, &deref) ||
+        !tlv_read_expect (&request, LBER_INTEGER, &size_limit) ||
+        !tlv_read_expect (&request, LBER_INTEGER, &time_limit) ||
+        !tlv_read_expect (&request, LBER_BOOLEAN, &types_only) ||
+        !tlv_read (&request, &filter_tag, &filter) ||
+        !tlv_read_expect (&request, LBER_SEQUENCE, &attrs)) {
+        append_result (out, msgid, LDAP_RES_SEARCH_RESULT, LDAP_PROTOCOL_ERROR, NULL);
+        return flush_output (output, out);
+    }
+
+    g_atomic_int_inc (&server->n_searches);
+
+    /* What SeahorseLDAPSource asks for when connecting */
+    if (tlv_equal (&base, "cn=PGPServerInfo")) {
+        g_autoptr(GByteArray) attributes = g_byte_array_new ();
+
+        append_attribute (attributes, "basekeyspacedn", strlen ("basekeyspacedn"),
+                          LDAP_TEST_SERVER_BASE_DN);
+        append_attribute (attributes, "version", strlen ("version"), "1");
+        append_entry (out, msgid, "cn=PGPServerInfo", attributes);
+        append_result (out, msgid, LDAP_RES_SEARCH_RESULT, LDAP_SUCCESS, NULL);
+        return flush_output (output, out);
+    }
+
+    if (!tlv_equal (&base, LDAP_TEST_SERVER_BASE_DN)) {
+        append_result (out, msgid, LDAP_RES_SEARCH_RESULT, LDAP_NO_SUCH_OBJECT, NULL);
+        return flush_output (output, out);
+    }
+
+    paged = g_atomic_int_get (&server->paging) &&
+            parse_page_control (controls, &page_size, &offset);
+
+    for (unsigned int i = offset; i < server->keys->len; i++) {
+        LdapTestKey *key = g_ptr_array_index (server->keys, i);
+
+        if (!filter_matches (key, filter_tag, filter))
+            continue;
+
+        if (paged && page_size > 0 && n_sent == page_size) {
+            next_offset = i;
+            break;
+        }
+
+        append_key_entry (out, msgid, key, i, attrs);
+        n_sent++;
+
+        if (out->len >= OUTPUT_CHUNK_SIZE && !flush_output (output, out))
+            return FALSE;
+    }
+
+    if (paged)
+        response_controls = build_page_control (next_offset);
+
+    append_result (out, msgid, LDAP_RES_SEARCH_RESULT, LDAP_SUCCESS, response_controls);
+    return flush_output (output, out);
+}
+
+static gboolean
+handle_add (LdapTestServer *server,
+            GOutputStream  *output,
+            GByteArray     *out,
+            unsigned int    msgid,
+            TlvSlice        request)
+{
+    TlvSlice dn, attributes, attribute, type, values, value;
+    int n_keys = 0;
+
+    if (!tlv_read_expect (&request, LBER_OCTETSTRING, &dn) ||
+        !tlv_read_expect (&request, LBER_SEQUENCE, &attributes)) {
+        append_result (out, msgid, LDAP_RES_ADD, LDAP_PROTOCOL_ERROR, NULL);
+        return flush_output (output, out);
+    }
+
+    while (attributes.len > 0 && tlv_read_expect (&attributes, LBER_SEQUENCE, &attribute)) {
+        if (!tlv_read_expect (&attribute, LBER_OCTETSTRING, &type) ||
+            !tlv_read_expect (&attribute, LBER_SET, &values))
+            break;
+
+        while (values.len > 0 && tlv_read_expect (&values, LBER_OCTETSTRING, &value)) {
+            const char *data = (const char *) value.data;
+            const char *end = data + value.len;
+
+            while ((data = g_strstr_len (data, end - data, PGP_KEY_BEGIN)) != NULL) {
+                n_keys++;
+                data++;
+            }
+        }
+    }
+
+    g_atomic_int_add (&server->n_added, n_keys);
+    append_result (out, msgid, LDAP_RES_ADD, LDAP_SUCCESS, NULL);
+    return flush_output (output, out);
+}
+
+/* Reads the contents of the next LDAPMessage envelope */
+static GBytes *
+read_message (GInputStream *input)
+{
+    guint8 header[2];
+    guint8 length[4];
+    size_t n_read, len;
+    guint8 *data;
+
+    if (!g_input_stream_read_all (input, header, sizeof (header), &n_read, NULL, NULL) ||
+        n_read != sizeof (header) || header[0] != LBER_SEQUENCE)
+        return NULL;
+
+    len = header[1];
+    if (len & 0x80) {
+        size_t n_bytes = len & 0x7f;
+
+        if (n_bytes == 0 || n_bytes > sizeof (length) ||
+            !g_input_stream_read_all (input, length, n_bytes, &n_read, NULL, NULL) ||
+            n_read != n_bytes)
+            return NULL;
+
+        len = 0;
+        for (size_t i = 0; i < n_bytes; i++)
+            len = (len << 8) | length[i];
+    }
+
+    data = g_malloc (len);
+    if (!g_input_stream_read_all (input, data, len, &n_read, NULL, NULL) || n_read != len) {
+        g_free (data);
+        return NULL;
+    }
+
+    return g_bytes_new_take (data, len);
+}
+
+static gboolean
+on_service_run (GThreadedSocketService *service,
+                GSocketConnection      *connection,
+                GObject                *source_object,
+                void                   *user_data)
+{
+    LdapTestServer *server = user_data;
+    GInputStream *input;
+    GOutputStream *output;
+    g_autoptr(GByteArray) out = NULL;
+
+    input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+    output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+    out = g_byte_array_sized_new (OUTPUT_CHUNK_SIZE);
+
+    /* Handle requests until the client unbinds or goes away */
+    for (;;) {
+        g_autoptr(GBytes) message = NULL;
+        TlvSlice in, value, op;
+        TlvSlice controls = { NULL, 0 };
+        unsigned int msgid;
+        int latency_ms;
+        guint8 op_tag;
+        gboolean ok = TRUE;
+
+        message = read_message (input);
+        if (message == NULL)
+            break;
+
+        in.data = g_bytes_get_data (message, &in.len);
+        if (!tlv_read_expect (&in, LBER_INTEGER, &value) ||
+            !tlv_read (&in, &op_tag, &op))
+            break;
+        msgid = tlv_to_uint (&value);
+
+        if (in.len > 0 && !tlv_read_expect (&in, LDAP_TAG_CONTROLS, &controls))
+            break;
+
+        if (op_tag == LDAP_REQ_SEARCH || op_tag == LDAP_REQ_ADD) {
+            latency_ms = g_atomic_int_get (&server->latency_ms);
+            if (latency_ms > 0)
+                g_usleep (latency_ms * G_TIME_SPAN_MILLISECOND);
+        }
+
+        switch (op_tag) {
+        case LDAP_REQ_BIND:
+            g_atomic_int_inc (&server->n_binds);
+            append_result (out, msgid, LDAP_RES_BIND, LDAP_SUCCESS, NULL);
+            ok = flush_output (output, out);
+            break;
+        case LDAP_REQ_SEARCH:
+            ok = handle_search (server, output, out, msgid, op, controls);
+            break;
+        case LDAP_REQ_ADD:
+            ok = handle_add (server, output, out, msgid, op);
+            break;
+        case LDAP_REQ_ABANDON:
+            break;
+        case LDAP_REQ_UNBIND:
+        default:
+            ok = FALSE;
+            break;
+        }
+
+        if (!ok)
+            break;
+    }
+
+    return TRUE;
+}
+
+/**
+ * ldap_test_server_new:
+ * @n_keys: The amount of synthetic keys to serve
+ *
+ * Starts an LDAP server on a random loopback port. Key number `i` has the
+ * user ID "Test User i <useri@example.org>", so searching for "Test User"
+ * returns every key. Paged results are supported by default.
+ *
+ * Returns: (transfer full): The running server
+ */
+LdapTestServer *
+ldap_test_server_new (unsigned int n_keys)
+{
+    LdapTestServer *server;
+    g_autoptr(GInetAddress) loopback = NULL;
+    g_autoptr(GSocketAddress) address = NULL;
+    g_autoptr(GSocketAddress) effective = NULL;
+    g_autoptr(GError) error = NULL;
+    uint16_t port;
+
+    server = g_new0 (LdapTestServer, 1);
+    server->paging = TRUE;
+    server->keys = g_ptr_array_new_full (n_keys, ldap_test_key_free);
+    for (unsigned int i = 0; i < n_keys; i++)
+        g_ptr_array_add (server->keys, ldap_test_key_new (i));
+
+    server->service = g_threaded_socket_service_new (32);
+    g_signal_connect (server->service, "run", G_CALLBACK (on_service_run), server);
+
+    loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+    address = g_inet_socket_address_new (loopback, 0);
+    g_socket_listener_add_address (G_SOCKET_LISTENER (server->service), address,
+                                   G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP,
+                                   NULL, &effective, &error);
+    g_assert_no_error (error);
+
+    port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective));
+    server->uri = g_strdup_printf ("ldap://127.0.0.1:%u", port);
+
+    g_socket_service_start (server->service);
+    return server;
+}
+
+/**
+ * ldap_test_server_free:
+ * @server: The server to stop
+ *
+ * Stops listening and frees the server. Clients should have disconnected
+ * (e.g. by finalizing their #SeahorseLDAPSource) before this is called.
+ */
+void
+ldap_test_server_free (LdapTestServer *server)
+{
+    if (server == NULL)
+        return;
+
+    g_socket_service_stop (server->service);
+    g_socket_listener_close (G_SOCKET_LISTENER (server->service));
+    g_signal_handlers_disconnect_by_data (server->service, server);
+    g_clear_object (&server->service);
+
+    g_ptr_array_unref (server->keys);
+    g_free (server->uri);
+    g_free (server);
+}
+
+/**
+ * ldap_test_server_get_uri:
+ * @server: The server
+ *
+ * Returns: An ldap:// URI suitable for seahorse_ldap_source_new()
+ */
+const char *
+ldap_test_server_get_uri (LdapTestServer *server)
+{
+    return server->uri;
+}
+
+unsigned int
+ldap_test_server_get_n_keys (LdapTestServer *server)
+{
+    return server->keys->len;
+}
+
+/**
+ * ldap_test_server_get_keyid:
+ * @server: The server
+ * @index: The index of the synthetic key
+ *
+ * Returns: The 16-character key ID of the key at @index
+ */
+const char *
+ldap_test_server_get_keyid (LdapTestServer *server,
+                            unsigned int    index)
+{
+    LdapTestKey *key;
+
+    g_return_val_if_fail (index < server->keys->len, NULL);
+
+    key = g_ptr_array_index (server->keys, index);
+    return key->keyid;
+}
+
+/**
+ * ldap_test_server_set_latency:
+ * @server: The server
+ * @latency_ms: The delay added before answering a search or add, in
+ *   milliseconds
+ */
+void
+ldap_test_server_set_latency (LdapTestServer *server,
+                              unsigned int    latency_ms)
+{
+    g_atomic_int_set (&server->latency_ms, latency_ms);
+}
+
+/**
+ * ldap_test_server_set_paging:
+ * @server: The server
+ * @paging: Whether to honor the paged results control
+ *
+ * Without paging, all results are sent in one go and the control is
+ * ignored, like older servers do.
+ */
+void
+ldap_test_server_set_paging (LdapTestServer *server,
+                             gboolean        paging)
+{
+    g_atomic_int_set (&server->paging, paging);
+}
+
+/**
+ * ldap_test_server_get_n_binds:
+ * @server: The server
+ *
+ * Returns: The amount of bind requests received so far, which is also the
+ *   amount of connections that were set up
+ */
+unsigned int
+ldap_test_server_get_n_binds (LdapTestServer *server)
+{
+    return g_atomic_int_get (&server->n_binds);
+}
+
+/**
+ * ldap_test_server_get_n_searches:
+ * @server: The server
+ *
+ * Returns: The amount of search requests received so far (including the
+ *   ones for the server info, and each page)
+ */
+unsigned int
+ldap_test_server_get_n_searches (LdapTestServer *server)
+{
+    return g_atomic_int_get (&server->n_searches);
+}
+
+/**
+ * ldap_test_server_get_n_added:
+ * @server: The server
+ *
+ * Returns: The amount of key blocks received through add requests
+ */
+unsigned int
+ldap_test_server_get_n_added (LdapTestServer *server)
+{
+    return g_atomic_int_get (&server->n_added);
+}
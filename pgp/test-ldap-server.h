@@ -0,0 +1,62 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * LdapTestServer: A minimal in-process LDAP keyserver for tests and benchmarks.
+ *
+ * - Listens on a random loopback port using a GThreadedSocketService.
+ * - Speaks just enough LDAPv3 for SeahorseLDAPSource: anonymous binds,
+ *   searches (with the paged results control) and adds.
+ * - Serves a PGP keyserver directory of synthetic keys, and can add
+ *   artificial latency.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+/* The base DN under which the keys are found */
+#define LDAP_TEST_SERVER_BASE_DN "ou=active,o=pgp keyspace,c=us"
+
+typedef struct _LdapTestServer LdapTestServer;
+
+LdapTestServer *  ldap_test_server_new              (unsigned int n_keys);
+
+void              ldap_test_server_free             (LdapTestServer *server);
+
+const char *      ldap_test_server_get_uri          (LdapTestServer *server);
+
+unsigned int      ldap_test_server_get_n_keys       (LdapTestServer *server);
+
+const char *      ldap_test_server_get_keyid        (LdapTestServer *server,
+                                                     unsigned int    index);
+
+void              ldap_test_server_set_latency      (LdapTestServer *server,
+                                                     unsigned int    latency_ms);
+
+void              ldap_test_server_set_paging       (LdapTestServer *server,
+                                                     gboolean        paging);
+
+unsigned int      ldap_test_server_get_n_binds      (LdapTestServer *server);
+
+unsigned int      ldap_test_server_get_n_searches   (LdapTestServer *server);
+
+unsigned int      ldap_test_server_get_n_added      (LdapTestServer *server);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (LdapTestServer, ldap_test_server_free)
@@ -21,7 +21,43 @@
 #include "seahorse-pgp-key.h"
 #include "seahorse-pgp-uid.h"
 
+#include "test-ldap-server.h"
+#include "test-util.h"
+
 #include <glib.h>
+#include <string.h>
+
+typedef struct _LdapTestFixture {
+    LdapTestServer *server;
+    SeahorseLDAPSource *source;
+} LdapTestFixture;
+
+static void
+ldap_test_fixture_setup (LdapTestFixture *fixture,
+                         const void      *user_data)
+{
+    fixture->server = ldap_test_server_new (500);
+    fixture->source = seahorse_ldap_source_new (ldap_test_server_get_uri (fixture->server));
+    g_assert_nonnull (fixture->source);
+}
+
+static void
+ldap_test_fixture_teardown (LdapTestFixture *fixture,
+                            const void      *user_data)
+{
+    g_clear_object (&fixture->source);
+    g_clear_pointer (&fixture->server, ldap_test_server_free);
+}
+
+static unsigned int
+search_server (LdapTestFixture *fixture,
+               const char      *match)
+{
+    g_autoptr(GListStore) results = NULL;
+
+    results = test_util_search_keys (SEAHORSE_SERVER_SOURCE (fixture->source), match);
+    return g_list_model_get_n_items (G_LIST_MODEL (results));
+}
 
 static void
 test_ldap_is_valid_uri (void)
@@ -38,6 +74,114 @@ test_ldap_is_valid_uri (void)
     g_assert_false (seahorse_ldap_is_valid_uri ("hkp://keys.openpgp.org"));
 }
 
+static void
+test_ldap_server_search (LdapTestFixture *fixture,
+                         const void      *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    g_autoptr(GListStore) results = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    SeahorsePgpKey *key;
+
+    results = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+    seahorse_server_source_search_async (source, "user42@", results, NULL,
+                                         test_util_async_ready, &result);
+    seahorse_server_source_search_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (results)), ==, 1);
+    key = g_list_model_get_item (G_LIST_MODEL (results), 0);
+    g_assert_cmpstr (seahorse_pgp_key_get_keyid (key), ==,
+                     ldap_test_server_get_keyid (fixture->server, 42));
+    g_object_unref (key);
+}
+
+static void
+test_ldap_server_search_paged (LdapTestFixture *fixture,
+                               const void      *user_data)
+{
+    /* 500 keys come in 2 pages, after asking for the server info */
+    g_assert_cmpuint (search_server (fixture, "Test User"), ==, 500);
+    g_assert_cmpuint (ldap_test_server_get_n_searches (fixture->server), ==, 3);
+
+    /* The next search reuses the connection and the server info */
+    g_assert_cmpuint (search_server (fixture, "Test User"), ==, 500);
+    g_assert_cmpuint (ldap_test_server_get_n_searches (fixture->server), ==, 5);
+    g_assert_cmpuint (ldap_test_server_get_n_binds (fixture->server), ==, 1);
+}
+
+static void
+test_ldap_server_search_unpaged (LdapTestFixture *fixture,
+                                 const void      *user_data)
+{
+    ldap_test_server_set_paging (fixture->server, FALSE);
+
+    g_assert_cmpuint (search_server (fixture, "Test User"), ==, 500);
+    g_assert_cmpuint (ldap_test_server_get_n_searches (fixture->server), ==, 2);
+}
+
+static void
+test_ldap_server_export (LdapTestFixture *fixture,
+                         const void      *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    const char *keyids[4];
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+    const char *data, *pos;
+    unsigned int n_blocks = 0;
+
+    keyids[0] = ldap_test_server_get_keyid (fixture->server, 1);
+    keyids[1] = ldap_test_server_get_keyid (fixture->server, 100);
+    keyids[2] = ldap_test_server_get_keyid (fixture->server, 499);
+    keyids[3] = NULL;
+
+    seahorse_server_source_export_async (source, keyids, NULL, test_util_async_ready, &result);
+    bytes = seahorse_server_source_export_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (bytes);
+
+    data = g_bytes_get_data (bytes, NULL);
+    for (pos = strstr (data, "-----BEGIN PGP PUBLIC KEY BLOCK-----"); pos != NULL;
+         pos = strstr (pos + 1, "-----BEGIN PGP PUBLIC KEY BLOCK-----"))
+        n_blocks++;
+    g_assert_cmpuint (n_blocks, ==, 3);
+
+    /* The server info, and all keys in one go */
+    g_assert_cmpuint (ldap_test_server_get_n_searches (fixture->server), ==, 2);
+}
+
+static void
+test_ldap_server_import (LdapTestFixture *fixture,
+                         const void      *user_data)
+{
+    SeahorseServerSource *source = SEAHORSE_SERVER_SOURCE (fixture->source);
+    g_autoptr(GString) bundle = NULL;
+    g_autoptr(GInputStream) input = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+    GList *imported;
+
+    bundle = g_string_new ("Some header text\n");
+    for (unsigned int i = 0; i < 3; i++) {
+        g_string_append (bundle, "-----BEGIN PGP PUBLIC KEY BLOCK-----\n\n");
+        for (unsigned int j = 0; j < 50; j++)
+            g_string_append (bundle, "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVo=\n");
+        g_string_append (bundle, "-----END PGP PUBLIC KEY BLOCK-----\nJunk\n");
+    }
+
+    input = g_memory_input_stream_new_from_data (g_strdup (bundle->str), bundle->len, g_free);
+
+    seahorse_server_source_import_async (source, input, NULL, test_util_async_ready, &result);
+    imported = seahorse_server_source_import_finish (source, test_util_wait_for_result (&result), &error);
+    g_assert_no_error (error);
+    g_assert_null (imported);
+
+    g_assert_cmpuint (ldap_test_server_get_n_added (fixture->server), ==, 3);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -45,5 +189,26 @@ main (int argc, char **argv)
 
     g_test_add_func ("/ldap/valid-uri", test_ldap_is_valid_uri);
 
+    g_test_add ("/ldap/server/search", LdapTestFixture, NULL,
+                ldap_test_fixture_setup,
+                test_ldap_server_search,
+                ldap_test_fixture_teardown);
+    g_test_add ("/ldap/server/search-paged", LdapTestFixture, NULL,
+                ldap_test_fixture_setup,
+                test_ldap_server_search_paged,
+                ldap_test_fixture_teardown);
+    g_test_add ("/ldap/server/search-unpaged", LdapTestFixture, NULL,
+                ldap_test_fixture_setup,
+                test_ldap_server_search_unpaged,
+                ldap_test_fixture_teardown);
+    g_test_add ("/ldap/server/export", LdapTestFixture, NULL,
+                ldap_test_fixture_setup,
+                test_ldap_server_export,
+                ldap_test_fixture_teardown);
+    g_test_add ("/ldap/server/import", LdapTestFixture, NULL,
+                ldap_test_fixture_setup,
+                test_ldap_server_import,
+                ldap_test_fixture_teardown);
+
     return g_test_run ();
 }
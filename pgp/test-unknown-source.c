@@ -0,0 +1,149 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "seahorse-unknown-source.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#define KEYID "1234567890ABCDEF"
+#define FINGERPRINT "0011223344556677AABBCCDD" KEYID
+
+static const char *servers_a[] = { "hkps://keys.example.org", "ldap://example.com", NULL };
+static const char *servers_b[] = { "hkps://keys.example.org", NULL };
+
+static SeahorseUnknownSource *
+new_source (const char **servers)
+{
+    SeahorseUnknownSource *source;
+
+    source = seahorse_unknown_source_new ();
+    seahorse_unknown_source_set_servers (source, servers);
+    return source;
+}
+
+static void
+test_lookup (void)
+{
+    g_autoptr(SeahorseUnknownSource) source = seahorse_unknown_source_new ();
+    SeahorseUnknown *unknown, *same;
+
+    unknown = seahorse_unknown_source_add_object (source, KEYID, NULL);
+    g_assert_nonnull (unknown);
+
+    /* Casing and the fingerprint form don't matter */
+    same = seahorse_unknown_source_add_object (source, "1234567890abcdef", NULL);
+    g_assert_true (same == unknown);
+    same = seahorse_unknown_source_add_object (source, FINGERPRINT, NULL);
+    g_assert_true (same == unknown);
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (source)), ==, 1);
+
+    same = seahorse_unknown_source_add_object (source, "FEDCBA0987654321", NULL);
+    g_assert_true (same != unknown);
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (source)), ==, 2);
+}
+
+static void
+test_absent (void)
+{
+    g_autoptr(SeahorseUnknownSource) source = new_source (servers_a);
+
+    g_assert_false (seahorse_unknown_source_is_absent (source, KEYID));
+
+    seahorse_unknown_source_mark_absent (source, FINGERPRINT);
+    g_assert_true (seahorse_unknown_source_is_absent (source, KEYID));
+    g_assert_true (seahorse_unknown_source_is_absent (source, "1234567890abcdef"));
+    g_assert_false (seahorse_unknown_source_is_absent (source, "FEDCBA0987654321"));
+
+    seahorse_unknown_source_forget_absent (source, KEYID);
+    g_assert_false (seahorse_unknown_source_is_absent (source, KEYID));
+}
+
+static void
+test_absent_persists (void)
+{
+    g_autoptr(SeahorseUnknownSource) source = NULL;
+
+    source = new_source (servers_a);
+    seahorse_unknown_source_mark_absent (source, KEYID);
+    g_clear_object (&source);
+
+    source = new_source (servers_a);
+    g_assert_true (seahorse_unknown_source_is_absent (source, KEYID));
+}
+
+static void
+test_absent_other_servers (void)
+{
+    g_autoptr(SeahorseUnknownSource) source = NULL;
+
+    source = new_source (servers_a);
+    seahorse_unknown_source_mark_absent (source, KEYID);
+    seahorse_unknown_source_flush (source);
+    g_clear_object (&source);
+
+    /* The cache was for other servers */
+    source = new_source (servers_b);
+    g_assert_false (seahorse_unknown_source_is_absent (source, KEYID));
+
+    /* Changing the servers later on works the same */
+    seahorse_unknown_source_mark_absent (source, KEYID);
+    seahorse_unknown_source_set_servers (source, servers_a);
+    g_assert_false (seahorse_unknown_source_is_absent (source, KEYID));
+}
+
+static void
+test_absent_expires (void)
+{
+    g_autoptr(SeahorseUnknownSource) source = NULL;
+    g_autoptr(GKeyFile) file = NULL;
+    g_autofree char *dir = NULL;
+    g_autofree char *path = NULL;
+    g_autoptr(GError) error = NULL;
+    int64_t now = g_get_real_time ();
+
+    dir = g_build_filename (g_get_user_cache_dir (), "seahorse", NULL);
+    path = g_build_filename (dir, "absent-keyids", NULL);
+    g_assert_cmpint (g_mkdir_with_parents (dir, 0700), ==, 0);
+
+    file = g_key_file_new ();
+    g_key_file_set_string (file, "cache", "servers", "hkps://keys.example.org ldap://example.com");
+    g_key_file_set_int64 (file, "absent", KEYID, now - G_TIME_SPAN_MINUTE);
+    g_key_file_set_int64 (file, "absent", "FEDCBA0987654321", now + G_TIME_SPAN_HOUR);
+    g_key_file_save_to_file (file, path, &error);
+    g_assert_no_error (error);
+
+    source = new_source (servers_a);
+    g_assert_false (seahorse_unknown_source_is_absent (source, KEYID));
+    g_assert_true (seahorse_unknown_source_is_absent (source, "FEDCBA0987654321"));
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+    g_test_add_func ("/unknown-source/lookup", test_lookup);
+    g_test_add_func ("/unknown-source/absent", test_absent);
+    g_test_add_func ("/unknown-source/absent-persists", test_absent_persists);
+    g_test_add_func ("/unknown-source/absent-other-servers", test_absent_other_servers);
+    g_test_add_func ("/unknown-source/absent-expires", test_absent_expires);
+
+    return g_test_run ();
+}
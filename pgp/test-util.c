@@ -0,0 +1,110 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "test-util.h"
+
+#include "seahorse-pgp-key.h"
+
+#include <glib/gstdio.h>
+#include <sys/resource.h>
+
+void
+test_util_async_ready (GObject      *source,
+                       GAsyncResult *result,
+                       void         *user_data)
+{
+    GAsyncResult **out = user_data;
+    *out = g_object_ref (result);
+}
+
+GAsyncResult *
+test_util_wait_for_result (GAsyncResult **result)
+{
+    while (*result == NULL)
+        g_main_context_iteration (NULL, TRUE);
+    return *result;
+}
+
+GListStore *
+test_util_search_keys (SeahorseServerSource *source,
+                       const char           *match)
+{
+    g_autoptr(GListStore) keys = NULL;
+    g_autoptr(GAsyncResult) result = NULL;
+    g_autoptr(GError) error = NULL;
+
+    keys = g_list_store_new (SEAHORSE_PGP_TYPE_KEY);
+    seahorse_server_source_search_async (source, match, keys, NULL,
+                                         test_util_async_ready, &result);
+    seahorse_server_source_search_finish (source, test_util_wait_for_result (&result),
+                                          &error);
+    g_assert_no_error (error);
+
+    return g_steal_pointer (&keys);
+}
+
+void
+test_util_make_state_dir (const char  *prefix,
+                          const char  *filename,
+                          char       **tmpdir,
+                          char       **state_path)
+{
+    g_autoptr(GError) error = NULL;
+    g_autofree char *template = NULL;
+
+    template = g_strdup_printf ("seahorse-%s-XXXXXX.d", prefix);
+    *tmpdir = g_dir_make_tmp (template, &error);
+    g_assert_no_error (error);
+    *state_path = g_build_filename (*tmpdir, filename, NULL);
+}
+
+void
+test_util_remove_state_dir (char **tmpdir,
+                            char **state_path)
+{
+    g_unlink (*state_path);
+    g_rmdir (*tmpdir);
+    g_clear_pointer (state_path, g_free);
+    g_clear_pointer (tmpdir, g_free);
+}
+
+void
+test_util_on_first_result (GListModel   *results,
+                           unsigned int  position,
+                           unsigned int  removed,
+                           unsigned int  added,
+                           void         *user_data)
+{
+    int64_t *first_result = user_data;
+
+    if (*first_result == 0 && added > 0)
+        *first_result = g_get_monotonic_time ();
+}
+
+double
+test_util_peak_rss_mib (void)
+{
+    struct rusage usage;
+
+    if (getrusage (RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    /* ru_maxrss is in KiB on Linux */
+    return usage.ru_maxrss / 1024.0;
+}
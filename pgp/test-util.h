@@ -0,0 +1,61 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Helpers shared by the keyserver tests and benchmarks.
+ */
+
+#pragma once
+
+#include "seahorse-server-source.h"
+
+#include <gio/gio.h>
+
+/* A GAsyncReadyCallback that stores a ref to the result in user_data,
+ * which should point to a (GAsyncResult *) that is initially NULL. */
+void              test_util_async_ready           (GObject       *source,
+                                                   GAsyncResult  *result,
+                                                   void          *user_data);
+
+/* Iterates the main context until test_util_async_ready() set the result */
+GAsyncResult *    test_util_wait_for_result       (GAsyncResult **result);
+
+/* Searches the source and returns a list of the keys that were found */
+GListStore *      test_util_search_keys           (SeahorseServerSource *source,
+                                                   const char           *match);
+
+/* Makes a temporary directory, and the path of a state file in there */
+void              test_util_make_state_dir        (const char  *prefix,
+                                                   const char  *filename,
+                                                   char       **tmpdir,
+                                                   char       **state_path);
+
+/* Removes what test_util_make_state_dir() made, and frees the strings */
+void              test_util_remove_state_dir      (char **tmpdir,
+                                                   char **state_path);
+
+/* An "items-changed" handler that stores the time of the first addition
+ * in user_data, which should point to an int64_t that is initially 0 */
+void              test_util_on_first_result       (GListModel   *results,
+                                                   unsigned int  position,
+                                                   unsigned int  removed,
+                                                   unsigned int  added,
+                                                   void         *user_data);
+
+double            test_util_peak_rss_mib          (void);
@@ -27,6 +27,11 @@ public class Seahorse.ImportDialog : Adw.Window {
     private Gcr.Parser parser;
     private GenericArray<Gcr.Parsed> parsed_items = new GenericArray<Gcr.Parsed>();
 
+    // All OpenPGP keys are previewed together once the input is parsed,
+    // rather than spawning gpg for each of them
+    private ByteArray pgp_data = new ByteArray();
+    private GLib.ListStore pgp_keys = new GLib.ListStore(typeof(Seahorse.Item));
+
     public InputStream input { get; construct set; }
 
     static construct {
@@ -41,6 +46,8 @@ public class Seahorse.ImportDialog : Adw.Window {
         this.parser.parsed.connect(on_parser_parsed);
         this.parser.authenticate.connect(on_parser_authenticate);
 
+        this.pgp_keys.items_changed.connect(on_pgp_keys_changed);
+
         parse_input.begin();
     }
 
@@ -66,6 +73,26 @@ public class Seahorse.ImportDialog : Adw.Window {
             // XXX show some kind of error status page
             show_error("Failed to read input: %s".printf(err.message));
         }
+
+        if (this.pgp_data.len == 0)
+            return;
+
+        try {
+            var data = ByteArray.free_to_bytes((owned) this.pgp_data);
+            this.pgp_data = new ByteArray();
+            yield Pgp.Backend.get().preview_keys_async(data, this.pgp_keys, cancellable);
+            debug("Previewed %u OpenPGP keys", this.pgp_keys.get_n_items());
+        } catch (GLib.Error err) {
+            warning("Couldn't preview OpenPGP keys: %s", err.message);
+            show_error("Couldn't read OpenPGP keys: %s".printf(err.message));
+        }
+    }
+
+    private void on_pgp_keys_changed(GLib.ListModel keys, uint position, uint removed, uint added) {
+        for (uint i = position; i < position + added; i++) {
+            var key = (Viewable) keys.get_item(i);
+            this.container.append(key.create_panel());
+        }
     }
 
     private void on_parser_parsed(Gcr.Parser parser) {
@@ -82,8 +109,7 @@ public class Seahorse.ImportDialog : Adw.Window {
                 break;
             case Gcr.DataFormat.OPENPGP_PACKET:
                 debug("Parser found OpenPGP packet");
-                var key = Pgp.Backend.get().create_key_for_parsed(parsed);
-                this.container.append(((Viewable) key).create_panel());
+                this.pgp_data.append(parsed.get_data());
                 break;
             case Gcr.DataFormat.OPENSSH_PUBLIC:
                 debug("Parser found Public SSH Key");
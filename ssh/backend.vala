@@ -22,6 +22,7 @@
 public class Seahorse.Ssh.Backend : GLib.Object, GLib.ListModel, Seahorse.Backend {
 
     private Source dot_ssh;
+    private KnownHosts known_hosts;
 
     public string name { get { return SEAHORSE_SSH_NAME; } }
     public string label { get { return _("Secure Shell"); } }
@@ -41,6 +42,17 @@ public class Seahorse.Ssh.Backend : GLib.Object, GLib.ListModel, Seahorse.Backen
             }
             notify_property("loaded");
         });
+
+        string known_hosts_path = Path.build_filename(this.dot_ssh.base_directory,
+                                                      KnownHosts.KNOWN_HOSTS_FILE);
+        this.known_hosts = new KnownHosts(known_hosts_path);
+        this.known_hosts.load.begin(null, (obj, res) => {
+            try {
+                this.known_hosts.load.end(res);
+            } catch (GLib.Error e) {
+                warning("Failed to load known hosts: %s", e.message);
+            }
+        });
     }
 
     public Backend() {
@@ -50,20 +62,29 @@ public class Seahorse.Ssh.Backend : GLib.Object, GLib.ListModel, Seahorse.Backen
     public static Backend? instance { get; internal set; default = null; }
 
     public GLib.Type get_item_type() {
-        return typeof(Ssh.Source);
+        return typeof(Seahorse.Place);
     }
 
     public uint get_n_items() {
-        return 1;
+        return 2;
     }
 
     public GLib.Object? get_item(uint position) {
-        return (position == 0)? this.dot_ssh : null;
+        switch (position) {
+            case 0:
+                return this.dot_ssh;
+            case 1:
+                return this.known_hosts;
+            default:
+                return null;
+        }
     }
 
     public Seahorse.Place? lookup_place(string uri) {
         if (this.dot_ssh != null && this.dot_ssh.uri != null && this.dot_ssh.uri == uri)
             return this.dot_ssh;
+        if (this.known_hosts != null && this.known_hosts.uri == uri)
+            return this.known_hosts;
 
         return null;
     }
@@ -75,4 +96,8 @@ public class Seahorse.Ssh.Backend : GLib.Object, GLib.ListModel, Seahorse.Backen
     public Source get_dot_ssh() {
         return this.dot_ssh;
     }
+
+    public KnownHosts get_known_hosts() {
+        return this.known_hosts;
+    }
 }
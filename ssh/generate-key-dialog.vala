@@ -96,7 +96,13 @@ public class Seahorse.Ssh.GenerateKeyDialog : Adw.Dialog {
         uint bits = this.key_length_chooser.get_length();
 
         // The filename
-        string filename = this.source.new_filename_for_algorithm(type);
+        string filename;
+        try {
+            filename = this.source.reserve_filename_for_algorithm(type);
+        } catch (GLib.Error e) {
+            Seahorse.Util.show_error(null, _("Couldn’t generate Secure Shell key"), e.message);
+            return;
+        }
 
         // We start creation
         try {
@@ -115,6 +121,7 @@ public class Seahorse.Ssh.GenerateKeyDialog : Adw.Dialog {
                 Seahorse.Util.show_error(null, _("Couldn’t load newly generated Secure Shell key"), e.message);
             }
         } catch (GLib.Error e) {
+            this.source.release_filename(filename);
             Seahorse.Util.show_error(null, _("Couldn’t generate Secure Shell key"), e.message);
         }
     }
@@ -18,6 +18,11 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * Writes the new contents of a file for {@link KeyData.replace_file}.
+ */
+internal delegate void Seahorse.Ssh.ReplaceFileFunc(OutputStream output) throws GLib.Error;
+
 public class Seahorse.Ssh.KeyData : GLib.Object {
 
     /* Used by callers */
@@ -33,6 +38,9 @@ public class Seahorse.Ssh.KeyData : GLib.Object {
     public uint length { get; internal set; }           /* Number of bits */
     public Algorithm algo { get; internal set; }             /* Key algorithm */
 
+    // The base64 key blob, as found in rawdata (see get_blob())
+    internal string? blob = null;
+
     public bool is_valid() {
         return this.fingerprint != null;
     }
@@ -58,39 +66,60 @@ public class Seahorse.Ssh.KeyData : GLib.Object {
         if (line == null || line.strip() == "")
             throw new Error.GENERAL("Can't parse key from empty line.");
 
-        string no_leading = line.chug();
-        KeyData result = new KeyData();
-        result.rawdata = no_leading;
+        uchar[] buffer = {};
+        return parse_line_with_buffer(line, ref buffer);
+    }
+
+    /**
+     * Does the same as parse_line(), but tokenizes the line in place and
+     * decodes the key blob into the given buffer, which is grown when needed.
+     * That way, a parser of many lines can reuse it for every line.
+     */
+    internal static KeyData parse_line_with_buffer(string line,
+                                                   ref uchar[] buffer) throws GLib.Error {
+        unowned uint8[] text = line.data;
+
+        // Skip leading whitespace
+        int type_start = 0;
+        while (type_start < text.length && is_space(text[type_start]))
+            type_start++;
 
         // Get the type
-        string[] type_rest = no_leading.split_set(" \t", 2);
-        if (type_rest.length != 2)
+        int type_end = find_separator(text, type_start);
+        if (type_end == text.length)
             throw new Error.GENERAL("Can't distinguish type from data (space missing).");
-
-        string type = type_rest[0];
-        if (type == "")
+        if (type_end == type_start)
             throw new Error.GENERAL("Key doesn't have a type.");
 
-        result.algo = Algorithm.guess_from_string(type);
-        if (result.algo == Algorithm.UNKNOWN)
+        string type = line.substring(type_start, type_end - type_start);
+        var algo = Algorithm.guess_from_string(type);
+        if (algo == Algorithm.UNKNOWN)
             throw new Error.GENERAL("Key doesn't have a valid type (%s).".printf(type));
 
-        // Prepare for decoding
-        string rest = type_rest[1];
-        if (rest == "")
+        // Find the data, and the comment after it
+        int blob_start = type_end + 1;
+        int blob_end = find_separator(text, blob_start);
+        int comment_start = (blob_end < text.length)? blob_end + 1 : -1;
+        while (blob_end > blob_start && is_space(text[blob_end - 1]))
+            blob_end--;
+        if (blob_end == blob_start)
             throw new Error.GENERAL("Key doesn't have any data.");
-        string[] data_comment = rest.split_set(" \t", 2);
 
         // Decode it, and parse binary stuff
-        uchar[] bytes = Base64.decode(data_comment[0].strip());
-        result.fingerprint = parse_key_blob(bytes);
+        int n_bytes = decode_base64(text, blob_start, blob_end, ref buffer);
+
+        KeyData result = new KeyData();
+        result.rawdata = line.offset(type_start);
+        result.algo = algo;
+        result.blob = line.substring(blob_start, blob_end - blob_start);
+        result.fingerprint = parse_key_blob(buffer[0:n_bytes]);
 
         // The number of bits
-        result.length = calc_bits(result.algo, bytes.length);
+        result.length = calc_bits(algo, n_bytes);
 
         // And the rest is the comment
-        if (data_comment.length == 2) {
-            string comment = data_comment[1];
+        if (comment_start >= 0) {
+            unowned string comment = line.offset(comment_start);
 
             if (!comment.validate()) // If not utf8-valid, assume latin1
                 result.comment = convert(comment, comment.length, "UTF-8", "ISO-8859-1");
@@ -101,6 +130,89 @@ public class Seahorse.Ssh.KeyData : GLib.Object {
         return result;
     }
 
+    private static inline bool is_space(uint8 c) {
+        return ((char) c).isspace();
+    }
+
+    // Returns the index of the first space or tab from start (or the length)
+    private static int find_separator(uint8[] text, int start) {
+        int i = start;
+        while (i < text.length && text[i] != ' ' && text[i] != '\t')
+            i++;
+        return i;
+    }
+
+    // The value of each base64 character, or 0xff if it isn't one
+    private const uint8[] BASE64_VALUES = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+        0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+        0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+    };
+
+    /**
+     * Decodes the base64 in text[start:end] into the buffer and returns the
+     * number of decoded bytes.
+     *
+     * The bulk of the data is decoded 4 characters (so 3 bytes) at a time
+     * with a lookup table. Anything else (padding, line breaks, garbage) is
+     * left to a slower loop, which skips invalid characters the same way
+     * Base64.decode() does.
+     */
+    private static int decode_base64(uint8[] text, int start, int end,
+                                     ref uchar[] buffer) {
+        int needed = ((end - start) / 4 + 1) * 3;
+        if (buffer.length < needed)
+            buffer = new uchar[needed];
+
+        int n_out = 0;
+        int i = start;
+        for (; i + 4 <= end; i += 4) {
+            uint32 a = BASE64_VALUES[text[i]];
+            uint32 b = BASE64_VALUES[text[i + 1]];
+            uint32 c = BASE64_VALUES[text[i + 2]];
+            uint32 d = BASE64_VALUES[text[i + 3]];
+            if (((a | b | c | d) & 0x80) != 0)
+                break;
+
+            uint32 quad = (a << 18) | (b << 12) | (c << 6) | d;
+            buffer[n_out++] = (uchar) (quad >> 16);
+            buffer[n_out++] = (uchar) (quad >> 8);
+            buffer[n_out++] = (uchar) quad;
+        }
+
+        uint32 bits = 0;
+        int n_bits = 0;
+        for (; i < end; i++) {
+            if (text[i] == '=')
+                break;
+            uint32 value = BASE64_VALUES[text[i]];
+            if (value == 0xff)
+                continue;
+
+            bits = (bits << 6) | value;
+            n_bits += 6;
+            if (n_bits >= 8) {
+                n_bits -= 8;
+                buffer[n_out++] = (uchar) (bits >> n_bits);
+            }
+        }
+
+        return n_out;
+    }
+
     internal static string parse_key_blob(uchar[] bytes) throws GLib.Error {
         string digest = Checksum.compute_for_data(ChecksumType.MD5, bytes);
         if (digest == null)
@@ -138,38 +250,156 @@ public class Seahorse.Ssh.KeyData : GLib.Object {
         }
     }
 
+    /**
+     * Returns the base64 encoded key blob, which is the same for any line
+     * that contains this key (regardless of options or comment).
+     */
+    internal unowned string? get_blob() {
+        if (this.blob == null && this.rawdata != null)
+            this.blob = find_blob(this.rawdata);
+        return this.blob;
+    }
+
+    // Finds the key blob in a line, without decoding it. As a blob starts
+    // with the 32-bit length of the key type, its base64 starts with "AAAA".
+    // Commented out lines don't have one, so they're never filtered out.
+    private static string? find_blob(string line) {
+        int i = 0;
+        while (line[i] == ' ' || line[i] == '\t')
+            i++;
+        if (line[i] == '#')
+            return null;
+
+        foreach (unowned var field in line.split_set(" \t")) {
+            if (field.has_prefix("AAAA"))
+                return field;
+        }
+        return null;
+    }
+
     // Adds and/or removes a keydata to a file (if added is already there, it is added at the back of the file).
     public static void filter_file(string filename, KeyData? add, KeyData? remove = null) throws GLib.Error {
         // By default filter out the one we're adding
         if (remove == null)
             remove = add;
 
-        string contents;
-        FileUtils.get_contents(filename, out contents);
-
-        var results = new StringBuilder();
+        KeyData[] adds = {};
+        if (add != null)
+            adds += add;
+        KeyData[] removes = {};
+        if (remove != null)
+            removes += remove;
 
-        // Load each line
-        bool first = true;
-        string[] lines = (contents ?? "").split("\n");
-        foreach (string line in lines) {
-            if (remove != null && remove.match(line))
-                continue;
+        filter_file_many(filename, adds, removes);
+    }
 
-            if (!first)
-                results.append_c('\n');
-            first = false;
-            results.append(line);
+    /**
+     * Adds and removes any number of keys to/from a file in one pass. Keys
+     * that are added are removed first, so they end up at the back.
+     *
+     * The file is streamed line by line into a temporary file next to it,
+     * which then replaces the original one. Lines are matched on their raw
+     * key blob, so they don't need to be decoded or fingerprinted. Comment
+     * lines are always kept.
+     *
+     * If filename is a symlink, the file it points to is replaced, so the
+     * link stays in place.
+     */
+    public static void filter_file_many(string filename,
+                                        KeyData[] add,
+                                        KeyData[] remove,
+                                        Cancellable? cancellable = null) throws GLib.Error {
+        var filtered = new GenericSet<string>(str_hash, str_equal);
+        foreach (unowned var keydata in remove) {
+            if (keydata.get_blob() != null)
+                filtered.add(keydata.get_blob());
         }
-
-        // Add any that need adding
-        if (add != null) {
-            if (!first)
-                results.append_c('\n');
-            results.append(add.rawdata);
+        foreach (unowned var keydata in add) {
+            if (keydata.get_blob() != null)
+                filtered.add(keydata.get_blob());
         }
 
-        FileUtils.set_contents(filename, results.str);
+        replace_file(filename, (output) => {
+            var data_output = new DataOutputStream(output);
+            data_output.close_base_stream = false;
+
+            try {
+                var file = File.new_for_path(filename);
+                var input = new DataInputStream(file.read(cancellable));
+
+                string? line;
+                while ((line = input.read_line(null, cancellable)) != null) {
+                    string? blob = find_blob(line);
+                    if (blob != null && filtered.contains(blob))
+                        continue;
+
+                    data_output.put_string(line, cancellable);
+                    data_output.put_byte('\n', cancellable);
+                }
+            } catch (IOError.NOT_FOUND e) {
+                // Nothing to filter, only to add
+            }
+
+            // Add any that need adding
+            var added = new GenericSet<string>(str_hash, str_equal);
+            foreach (unowned var keydata in add) {
+                unowned var blob = keydata.get_blob();
+                if (blob != null && added.contains(blob))
+                    continue;
+                if (blob != null)
+                    added.add(blob);
+
+                data_output.put_string(keydata.rawdata, cancellable);
+                data_output.put_byte('\n', cancellable);
+            }
+
+            data_output.flush(cancellable);
+        }, cancellable);
+    }
+
+    /**
+     * Atomically replaces a file: write_func writes the new contents to a
+     * temporary file next to it, which is synced to disk and then renamed
+     * over the original. The temporary file keeps the permissions of the
+     * original (new files stay private), and is removed again on failure.
+     *
+     * If filename is a symlink, the file it points to is replaced, so the
+     * link stays in place.
+     */
+    internal static void replace_file(string filename,
+                                      ReplaceFileFunc write_func,
+                                      Cancellable? cancellable = null) throws GLib.Error {
+        // Replace the file a symlink points to, not the link itself
+        string? target = Posix.realpath(filename);
+        if (target != null)
+            filename = target;
+
+        string tmpname = filename + ".XXXXXX";
+        int fd = FileUtils.mkstemp(tmpname);
+        if (fd < 0)
+            throw new Error.GENERAL("Couldn't create a temporary file for %s: %s"
+                                    .printf(filename, strerror(errno)));
+
+        // Keep the permissions of the original
+        Posix.Stat st;
+        if (Posix.stat(filename, out st) == 0)
+            Posix.fchmod(fd, (Posix.mode_t) (st.st_mode & 07777));
+
+        var output = new UnixOutputStream(fd, true);
+        try {
+            write_func(output);
+
+            output.flush(cancellable);
+            if (Posix.fsync(fd) != 0)
+                throw new Error.GENERAL("Couldn't write %s: %s".printf(tmpname, strerror(errno)));
+            output.close(cancellable);
+
+            if (FileUtils.rename(tmpname, filename) != 0)
+                throw new Error.GENERAL("Couldn't replace %s: %s".printf(filename, strerror(errno)));
+        } catch (GLib.Error e) {
+            FileUtils.unlink(tmpname);
+            throw e;
+        }
     }
 
     public unowned string? get_location() {
@@ -205,6 +435,16 @@ public class Seahorse.Ssh.SecData : GLib.Object {
      * @param data The data that contains a private key.
      */
     public static SecData parse_data(DataInputStream data, string initial_line) throws GLib.Error {
+        // First get our raw data (if there is none, don't bother)
+        string rawdata = parse_lines_block(data, initial_line, SSH_PRIVATE_BEGIN, SSH_PRIVATE_END);
+        return parse_block(initial_line, rawdata);
+    }
+
+    /**
+     * Parses a private key of which all lines (starting with initial_line)
+     * were already collected in rawdata.
+     */
+    internal static SecData parse_block(string initial_line, string? rawdata) throws GLib.Error {
         var secdata = new SecData();
 
         // Get the comment
@@ -212,8 +452,6 @@ public class Seahorse.Ssh.SecData : GLib.Object {
             secdata.comment = initial_line.substring(SSH_KEY_SECRET_SIG.length).strip();
         }
 
-        // First get our raw data (if there is none, don't bother)
-        string rawdata = parse_lines_block(data, initial_line, SSH_PRIVATE_BEGIN, SSH_PRIVATE_END);
         if (rawdata == null || rawdata == "")
             throw new Error.GENERAL("Private key contains no data.");
 
@@ -35,10 +35,26 @@ public class Seahorse.Ssh.KeyDeleteOperation : DeleteOperation {
 
     public override async bool execute(Cancellable? cancellable = null) throws GLib.Error {
         debug("Deleting %u SSH keys", this.items.length);
+
+        // Entries of a known_hosts file are all taken out in one rewrite
+        var known_hosts = new HashTable<KnownHosts, GenericArray<Key>>(direct_hash, direct_equal);
+
         foreach (unowned var item in this.items) {
             var key = (Ssh.Key) item;
-            delete_key(key);
+            if (key.place is KnownHosts) {
+                var place = (KnownHosts) key.place;
+                if (!known_hosts.contains(place))
+                    known_hosts[place] = new GenericArray<Key>();
+                known_hosts[place].add(key);
+            } else {
+                delete_key(key);
+            }
         }
+
+        foreach (var place in known_hosts.get_keys()) {
+            yield place.remove_keys_async(known_hosts[place].data, cancellable);
+        }
+
         return true;
     }
 
@@ -53,6 +53,14 @@ public class Seahorse.Ssh.KeyPanel : Seahorse.Panel {
 
         update_ui();
 
+        // Host keys can only be looked at (or deleted)
+        if (key.place is KnownHosts) {
+            this.comment_row.editable = false;
+            this.trust_check.visible = false;
+            var action = (SimpleAction) this.actions.lookup_action("remote-upload");
+            action.set_enabled(false);
+        }
+
         // A public key only
         if (key.usage != Seahorse.Usage.PRIVATE_KEY) {
             var action = (SimpleAction) this.actions.lookup_action("change-passphrase");
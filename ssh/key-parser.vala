@@ -0,0 +1,122 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Parses a stream of public and private SSH keys, like an authorized_keys
+ * file or a bunch of keys that are being imported.
+ *
+ * The data can be fed in chunks of any size. Lines are cut out of those into
+ * a single (reused) buffer and tokenized in place, so the only allocations
+ * per line are the ones of the resulting KeyData.
+ */
+internal class Seahorse.Ssh.KeyParser : GLib.Object {
+
+    /** How much data callers should read at once */
+    public const size_t CHUNK_SIZE = 64 * 1024;
+
+    public GenericArray<KeyData> public_keys { get; default = new GenericArray<KeyData>(); }
+    public GenericArray<SecData> secret_keys { get; default = new GenericArray<SecData>(); }
+
+    // The (possibly incomplete) line we're currently at
+    private StringBuilder line = new StringBuilder.sized(1024);
+
+    // A private key can span several lines, so these are collected first
+    private StringBuilder? secret_block = null;
+    private string? secret_first_line = null;
+
+    // Reused for decoding the key blob of each line
+    private uchar[] decode_buffer = new uchar[1024];
+
+    /**
+     * Parses the next chunk of data. Lines that aren't complete yet are kept
+     * until the next call (or until finish() is called).
+     */
+    public void feed(uint8[] data) throws GLib.Error {
+        int start = 0;
+        for (int i = 0; i < data.length; i++) {
+            if (data[i] != '\n')
+                continue;
+
+            if (i > start)
+                this.line.append_len((string) (&data[start]), i - start);
+            handle_line(this.line.str);
+            this.line.truncate(0);
+            start = i + 1;
+        }
+
+        if (start < data.length)
+            this.line.append_len((string) (&data[start]), data.length - start);
+    }
+
+    /**
+     * Parses whatever is left after the last chunk of data.
+     */
+    public void finish() throws GLib.Error {
+        if (this.line.len > 0) {
+            handle_line(this.line.str);
+            this.line.truncate(0);
+        }
+
+        // A private key without an end (this is what parse_data() does too)
+        if (this.secret_block != null)
+            finish_secret_block();
+    }
+
+    private void handle_line(string line) throws GLib.Error {
+        // Everything up to the end marker belongs to the private key
+        if (this.secret_block != null) {
+            this.secret_block.append(line);
+            this.secret_block.append_c('\n');
+            if (SecData.SSH_PRIVATE_END in line)
+                finish_secret_block();
+            return;
+        }
+
+        // Remove leading whitespace
+        int start = 0;
+        while (line[start] != '\0' && line[start].isspace())
+            start++;
+
+        // Ignore comments and empty lines (not a parse error, but no data)
+        if (line[start] == '\0' || line[start] == '#')
+            return;
+
+        unowned string rest = line.offset(start);
+
+        // First of all, check for a private key, as it can span several lines
+        if (SecData.contains_private_key(rest)) {
+            this.secret_first_line = rest;
+            this.secret_block = new StringBuilder(rest);
+            this.secret_block.append_c('\n');
+            return;
+        }
+
+        // See if we have a public key
+        var keydata = KeyData.parse_line_with_buffer(rest, ref this.decode_buffer);
+        this.public_keys.add(keydata);
+    }
+
+    private void finish_secret_block() throws GLib.Error {
+        var secdata = SecData.parse_block(this.secret_first_line, this.secret_block.str);
+        this.secret_keys.add(secdata);
+
+        this.secret_block = null;
+        this.secret_first_line = null;
+    }
+}
@@ -31,10 +31,11 @@ public class Seahorse.Ssh.Key : Object, Viewable, Seahorse.Item, Exportable, Del
         construct set { this._key_data = value; }
     }
 
-    private unowned Source? source;
+    // Either the Source (~/.ssh) or the KnownHosts this key comes from
+    private unowned Place? _place;
     public Place? place {
-        owned get { return this.source; }
-        set { this.source = (Source) value; }
+        owned get { return this._place; }
+        set { this._place = value; }
     }
 
     private static GLib.Icon PUBLIC_KEY_ICON = new ThemedIcon("key-item-symbolic");
@@ -133,8 +134,8 @@ public class Seahorse.Ssh.Key : Object, Viewable, Seahorse.Item, Exportable, Del
 
     public bool exportable { get { return true; } }
 
-    public Key(Source? source, KeyData key_data) {
-        Object(key_data: key_data, place: source);
+    public Key(Place? place, KeyData key_data) {
+        Object(key_data: key_data, place: place);
     }
 
     public void refresh() {
@@ -158,12 +159,21 @@ public class Seahorse.Ssh.Key : Object, Viewable, Seahorse.Item, Exportable, Del
      * from authorized_keys), so propagate that up to the previously loaded key.
      */
     public void merge_keydata(KeyData keydata) {
-        if (!this.key_data.authorized && keydata.authorized) {
-            this.key_data.authorized = true;
-            // Notify the 2 properties that can change based on authorized
-            notify_property("item-flags");
-            notify_property("trust");
-        }
+        if (!this.key_data.authorized && keydata.authorized)
+            update_authorized(true);
+    }
+
+    /**
+     * Changes whether this key is in the authorized keys.
+     */
+    public void update_authorized(bool authorized) {
+        if (this.key_data.authorized == authorized)
+            return;
+
+        this.key_data.authorized = authorized;
+        // Notify the 2 properties that can change based on authorized
+        notify_property("item-flags");
+        notify_property("trust");
     }
 
     public struct KeyParseResult {
@@ -174,62 +184,77 @@ public class Seahorse.Ssh.Key : Object, Viewable, Seahorse.Item, Exportable, Del
     /**
      * Parses an input stream into public/private keys.
      *
+     * The stream is read in big chunks, which are then split into lines and
+     * parsed by a KeyParser.
+     *
      * @param input The input stream that needs to be parsed.
      * @param cancellable Can be used to cancel the parsing.
      */
     public static async KeyParseResult parse(GLib.InputStream input,
                                              Cancellable? cancellable = null)
                                              throws GLib.Error {
-        var pubkeys = new GenericArray<KeyData>();
-        var seckeys = new GenericArray<SecData>();
-
-        // Fetch the data into a string
-        var data = new DataInputStream(input);
+        var parser = new KeyParser();
+        var buffer = new uint8[KeyParser.CHUNK_SIZE];
 
         while (true) {
-            // Read the next line, and remove leading whitespace
-            var raw_line = yield data.read_line_utf8_async(Priority.DEFAULT, cancellable, null);
-            if (raw_line == null)
+            var n_read = yield input.read_async(buffer, Priority.DEFAULT, cancellable);
+            if (n_read <= 0)
                 break;
 
-            string line = raw_line.chug();
-
-            // Ignore comments and empty lines (not a parse error, but no data)
-            if (line == "" || line.has_prefix("#"))
-                continue;
-
-            // First of all, check for a private key, as it can span several lines
-            if (SecData.contains_private_key(line)) {
-                try {
-                    var secdata = SecData.parse_data(data, line);
-                    seckeys.add(secdata);
-                    continue;
-                } catch (GLib.Error e) {
-                    warning(e.message);
-                }
-            }
-
-            // See if we have a public key
-            var keydata = KeyData.parse_line(line);
-            pubkeys.add(keydata);
+            parser.feed(buffer[0:(int) n_read]);
         }
+        parser.finish();
 
-        var result = KeyParseResult();
-        result.public_keys = pubkeys.steal();
-        result.secret_keys = seckeys.steal();
-        return result;
+        return parser_result(parser);
     }
 
     /**
      * Parses the contents of the given file into public/private keys.
      *
+     * The file is read and parsed in a separate thread, so big files (like
+     * a long authorized_keys) don't block the main loop.
+     *
      * @param data The file that will be parsed.
      * @param cancellable Can be used to cancel the parsing.
      */
     public static async KeyParseResult parse_file(string filename,
                                                   Cancellable? cancellable = null) throws GLib.Error {
-        var file = GLib.File.new_for_path(filename);
-        var file_stream = yield file.read_async();
-        return yield parse(file_stream, cancellable);
+        SourceFunc callback = parse_file.callback;
+        var parser = new KeyParser();
+        GLib.Error? err = null;
+
+        Thread<void*> thread = new Thread<void*>("parse-file", () => {
+            try {
+                var file = GLib.File.new_for_path(filename);
+                var input = file.read(cancellable);
+                var buffer = new uint8[KeyParser.CHUNK_SIZE];
+
+                ssize_t n_read;
+                while ((n_read = input.read(buffer, cancellable)) > 0)
+                    parser.feed(buffer[0:(int) n_read]);
+                parser.finish();
+            } catch (GLib.Error e) {
+                err = e;
+            }
+
+            Idle.add((owned) callback);
+            return null;
+        });
+
+        yield;
+
+        thread.join();
+
+        if (err != null)
+            throw err;
+
+        return parser_result(parser);
+    }
+
+    private static KeyParseResult parser_result(KeyParser parser) {
+        var result = KeyParseResult();
+        result.public_keys = parser.public_keys.steal();
+        result.secret_keys = parser.secret_keys.steal();
+        return result;
     }
 }
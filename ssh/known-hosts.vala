@@ -0,0 +1,625 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * The {@link Place} with the host keys of a known_hosts file.
+ *
+ * Such a file can easily have hundreds of thousands of entries, so it isn't
+ * parsed up front: it is memory-mapped, and loading only looks for the
+ * offset of each entry. A {@link Key} is created when its row is asked for,
+ * and the indexes by host and by fingerprint are built the first time
+ * they're needed.
+ *
+ * Note that the key manager filters this model and binds it to a
+ * {@link Gtk.ListBox}, which asks for every row, so there a key is still
+ * created for each entry.
+ */
+public class Seahorse.Ssh.KnownHosts : GLib.Object, GLib.ListModel, Seahorse.Place {
+
+    public const string KNOWN_HOSTS_FILE = "known_hosts";
+
+    // A hashed host is "|1|" base64(salt) "|" base64(HMAC-SHA1(salt, host))
+    private const string HASHED_HOST_PREFIX = "|1|";
+    private const size_t HASHED_HOST_DIGEST_SIZE = 20;
+
+    /** The path to the known_hosts file */
+    public string filename { get; construct; }
+
+    // The (mapped) contents of the file, and where each entry starts in it.
+    private Bytes contents = new Bytes(null);
+    private int[] entries = {};
+    // Some details of the file that was mapped, to see whether it changed
+    private Posix.Stat? mapped_stat = null;
+
+    // The keys that currently exist, by position. These aren't owned: they
+    // live only as long as somebody (e.g. a list row) is using them.
+    private HashTable<uint, unowned Key> keys_by_position =
+        new HashTable<uint, unowned Key>(direct_hash, direct_equal);
+    private HashTable<void*, uint> positions_by_key =
+        new HashTable<void*, uint>(direct_hash, direct_equal);
+
+    // Built on first use. Plain hostnames are looked up directly; hashed
+    // hosts and wildcard patterns have to be tried one by one.
+    private HashTable<string, PositionList>? hosts_index = null;
+    private GenericArray<HostMatcher>? host_matchers = null;
+    private HashTable<string, PositionList>? fingerprints_index = null;
+
+    // Reused for decoding key blobs
+    private uchar[] decode_buffer = new uchar[1024];
+
+    private uint scheduled_reload_source = 0;
+    private FileMonitor? monitor = null;
+
+    // The positions of the entries that have the same host or fingerprint
+    private class PositionList {
+        public uint[] positions = {};
+    }
+
+    // An entry that can't be found in the hosts index
+    private class HostMatcher {
+        public uint position;
+        public string? pattern = null;
+        public uint8[]? salt = null;
+        public uint8[]? hash = null;
+
+        public bool matches(string host) {
+            if (this.pattern != null)
+                return PatternSpec.match_simple(this.pattern, host);
+
+            var hmac = new Hmac(ChecksumType.SHA1, this.salt);
+            hmac.update(host.data);
+            var digest = new uint8[HASHED_HOST_DIGEST_SIZE];
+            size_t digest_len = digest.length;
+            hmac.get_digest(digest, ref digest_len);
+
+            return digest_len == this.hash.length
+                && Memory.cmp((void*) digest, (void*) this.hash, digest_len) == 0;
+        }
+    }
+
+    public string label {
+        owned get { return _("Known hosts"); }
+        set { }
+    }
+
+    public string description {
+        owned get { return _("OpenSSH known hosts: %s").printf(this.filename); }
+    }
+
+    public string uri {
+        owned get { return "openssh-known-hosts://%s".printf(this.filename); }
+    }
+
+    public Place.Category category {
+        get { return Place.Category.KEYS; }
+    }
+
+    public GLib.ActionGroup? actions {
+        owned get { return null; }
+    }
+
+    public unowned string? action_prefix {
+        get { return null; }
+    }
+
+    public MenuModel? menu_model {
+        owned get { return null; }
+    }
+
+    construct {
+        try {
+            var file = File.new_for_path(this.filename);
+            this.monitor = file.monitor_file(FileMonitorFlags.WATCH_MOVES, null);
+            this.monitor.changed.connect(on_file_changed);
+        } catch (GLib.Error e) {
+            warning("couldn't monitor %s: %s", this.filename, e.message);
+        }
+    }
+
+    public KnownHosts(string filename) {
+        GLib.Object(filename: filename);
+    }
+
+    public override void dispose() {
+        if (this.scheduled_reload_source != 0) {
+            GLib.Source.remove(this.scheduled_reload_source);
+            this.scheduled_reload_source = 0;
+        }
+        forget_keys();
+        base.dispose();
+    }
+
+    /**
+     * Maps the file and finds the entries in it.
+     *
+     * @param cancellable Use this to cancel the operation.
+     */
+    public async bool load(Cancellable? cancellable) throws GLib.Error {
+        Bytes contents;
+        Posix.Stat? st = null;
+
+        try {
+            var mapped = new MappedFile(this.filename, false);
+            contents = mapped.get_bytes();
+
+            Posix.Stat buf;
+            if (Posix.stat(this.filename, out buf) == 0)
+                st = buf;
+        } catch (FileError.NOENT e) {
+            // No known hosts (yet)
+            contents = new Bytes(null);
+        }
+
+        set_contents(contents, st);
+        return true;
+    }
+
+    private void set_contents(Bytes contents, Posix.Stat? st) {
+        uint n_removed = this.entries.length;
+
+        forget_keys();
+        this.hosts_index = null;
+        this.host_matchers = null;
+        this.fingerprints_index = null;
+
+        this.contents = contents;
+        this.mapped_stat = st;
+        this.entries = find_entries(contents.get_data());
+
+        items_changed(0, n_removed, this.entries.length);
+    }
+
+    // Returns the offset of each entry, skipping comments and empty lines
+    private static int[] find_entries(uint8[]? data) {
+        int[] entries = {};
+        if (data == null)
+            return entries;
+
+        int start = 0;
+        while (start < data.length) {
+            int end = find_line_end(data, start);
+
+            int i = start;
+            while (i < end && ((char) data[i]).isspace())
+                i++;
+            if (i < end && data[i] != '#')
+                entries += start;
+
+            start = end + 1;
+        }
+
+        return entries;
+    }
+
+    private static int find_line_end(uint8[] data, int start) {
+        int end = start;
+        while (end < data.length && data[end] != '\n')
+            end++;
+        return end;
+    }
+
+    // Returns a copy of the line of an entry
+    private string get_line(uint position) {
+        unowned uint8[] data = this.contents.get_data();
+        int start = this.entries[position];
+        int end = find_line_end(data, start);
+
+        var line = new StringBuilder.sized(end - start + 1);
+        line.append_len((string) (&data[start]), end - start);
+        return line.str;
+    }
+
+    // Finds the hosts and the key in an entry; the latter starts at key_start.
+    // Entries can start with a marker like "@revoked", which is skipped.
+    private static string get_hosts(string line, out int key_start) {
+        int hosts_start = skip_spaces(line, 0);
+        if (line[hosts_start] == '@')
+            hosts_start = skip_spaces(line, skip_field(line, hosts_start));
+
+        int hosts_end = skip_field(line, hosts_start);
+        key_start = skip_spaces(line, hosts_end);
+        return line.substring(hosts_start, hosts_end - hosts_start);
+    }
+
+    private static int skip_field(string str, int offset) {
+        while (str[offset] != '\0' && !str[offset].isspace())
+            offset++;
+        return offset;
+    }
+
+    private static int skip_spaces(string str, int offset) {
+        while (str[offset] != '\0' && str[offset].isspace())
+            offset++;
+        return offset;
+    }
+
+    public GLib.Type get_item_type() {
+        return typeof(Ssh.Key);
+    }
+
+    public uint get_n_items() {
+        return this.entries.length;
+    }
+
+    public GLib.Object? get_item(uint position) {
+        if (position >= this.entries.length)
+            return null;
+
+        unowned var existing = this.keys_by_position[position];
+        if (existing != null)
+            return existing;
+
+        var key = new Key(this, parse_entry(position));
+        this.keys_by_position[position] = key;
+        this.positions_by_key[(void*) key] = position;
+        key.weak_ref(on_key_finalized);
+        return key;
+    }
+
+    private KeyData parse_entry(uint position) {
+        string line = get_line(position);
+        int key_start;
+        string hosts = get_hosts(line, out key_start);
+
+        KeyData keydata;
+        try {
+            keydata = KeyData.parse_line_with_buffer(line.offset(key_start),
+                                                     ref this.decode_buffer);
+        } catch (GLib.Error e) {
+            // Still show it, so it can be removed
+            debug("Invalid entry in %s: %s", this.filename, e.message);
+            keydata = new KeyData();
+            keydata.rawdata = line.offset(key_start);
+        }
+
+        // The hosts are what makes an entry recognizable
+        if (hosts.has_prefix(HASHED_HOST_PREFIX))
+            keydata.comment = _("Hashed host");
+        else
+            keydata.comment = hosts.replace(",", ", ");
+        keydata.pubfile = this.filename;
+        keydata.partial = true;
+        return keydata;
+    }
+
+    private void on_key_finalized(GLib.Object key) {
+        void* orig_key;
+        uint position;
+        if (this.positions_by_key.lookup_extended((void*) key, out orig_key, out position)) {
+            this.positions_by_key.remove((void*) key);
+            this.keys_by_position.remove(position);
+        }
+    }
+
+    private void forget_keys() {
+        foreach (unowned var key in this.keys_by_position.get_values())
+            key.weak_unref(on_key_finalized);
+        this.keys_by_position.remove_all();
+        this.positions_by_key.remove_all();
+    }
+
+    /**
+     * Returns the position of a key from this place in the model, or -1.
+     */
+    public int get_position(Key key) {
+        void* orig_key;
+        uint position;
+        if (this.positions_by_key.lookup_extended((void*) key, out orig_key, out position))
+            return (int) position;
+        return -1;
+    }
+
+    /**
+     * Finds the entries for the given host, including those with a hashed
+     * hostname or a wildcard pattern.
+     *
+     * @param hostname The name or address of the host.
+     * @param port The SSH port of the host.
+     * @return The positions of the matching entries, in order.
+     */
+    public uint[] lookup_host(string hostname, uint port = 22) {
+        ensure_hosts_index();
+
+        // This is how ssh writes it (and hashes it)
+        string host = hostname.ascii_down();
+        if (port != 22)
+            host = "[%s]:%u".printf(host, port);
+
+        uint[] matched = {};
+        foreach (unowned var matcher in this.host_matchers.data) {
+            if (matcher.matches(host))
+                matched += matcher.position;
+        }
+
+        unowned var indexed = this.hosts_index[host];
+        if (indexed == null)
+            return matched;
+        return merge_positions(indexed.positions, matched);
+    }
+
+    /**
+     * Finds the entries with the given key.
+     *
+     * @param fingerprint The fingerprint of the key.
+     * @return The positions of the matching entries, in order.
+     */
+    public uint[] lookup_fingerprint(string fingerprint) {
+        ensure_fingerprints_index();
+
+        unowned var indexed = this.fingerprints_index[fingerprint];
+        if (indexed == null)
+            return {};
+        return indexed.positions;
+    }
+
+    private void ensure_hosts_index() {
+        if (this.hosts_index != null)
+            return;
+
+        this.hosts_index = new HashTable<string, PositionList>(str_hash, str_equal);
+        this.host_matchers = new GenericArray<HostMatcher>();
+
+        for (uint i = 0; i < this.entries.length; i++) {
+            int key_start;
+            string hosts = get_hosts(get_line(i), out key_start);
+
+            foreach (unowned var host in hosts.split(",")) {
+                // Negated patterns only exclude hosts
+                if (host == "" || host.has_prefix("!"))
+                    continue;
+
+                if (host.has_prefix(HASHED_HOST_PREFIX)) {
+                    var parts = host.split("|");
+                    if (parts.length != 4)
+                        continue;
+
+                    var matcher = new HostMatcher();
+                    matcher.position = i;
+                    matcher.salt = Base64.decode(parts[2]);
+                    matcher.hash = Base64.decode(parts[3]);
+                    this.host_matchers.add(matcher);
+                } else if ("*" in host || "?" in host) {
+                    var matcher = new HostMatcher();
+                    matcher.position = i;
+                    matcher.pattern = host.ascii_down();
+                    this.host_matchers.add(matcher);
+                } else {
+                    add_to_index(this.hosts_index, host.ascii_down(), i);
+                }
+            }
+        }
+    }
+
+    private void ensure_fingerprints_index() {
+        if (this.fingerprints_index != null)
+            return;
+
+        this.fingerprints_index = new HashTable<string, PositionList>(str_hash, str_equal);
+
+        for (uint i = 0; i < this.entries.length; i++) {
+            string line = get_line(i);
+            int key_start;
+            get_hosts(line, out key_start);
+
+            try {
+                var keydata = KeyData.parse_line_with_buffer(line.offset(key_start),
+                                                             ref this.decode_buffer);
+                add_to_index(this.fingerprints_index, keydata.fingerprint, i);
+            } catch (GLib.Error e) {
+                // Not a valid key, so it can't be found by its fingerprint
+            }
+        }
+    }
+
+    private static void add_to_index(HashTable<string, PositionList> index,
+                                     string name,
+                                     uint position) {
+        var list = index[name];
+        if (list == null) {
+            list = new PositionList();
+            index[name] = list;
+        }
+
+        // An entry can list the same host more than once
+        if (list.positions.length == 0 || list.positions[list.positions.length - 1] != position)
+            list.positions += position;
+    }
+
+    // Merges 2 sorted lists of positions
+    private static uint[] merge_positions(uint[] a, uint[] b) {
+        uint[] result = {};
+        int i = 0, j = 0;
+        while (i < a.length || j < b.length) {
+            uint next;
+            if (j >= b.length || (i < a.length && a[i] <= b[j]))
+                next = a[i++];
+            else
+                next = b[j++];
+
+            if (result.length == 0 || result[result.length - 1] != next)
+                result += next;
+        }
+        return result;
+    }
+
+    /**
+     * Removes the entries of the given keys from the file.
+     *
+     * @param keys Keys from this place.
+     * @param cancellable Allows the operation to be cancelled.
+     */
+    public async void remove_keys_async(Key[] keys,
+                                        Cancellable? cancellable = null) throws GLib.Error {
+        uint[] positions = {};
+        foreach (unowned var key in keys) {
+            int position = get_position(key);
+            if (position >= 0)
+                positions += position;
+        }
+
+        yield remove_entries_async(positions, cancellable);
+    }
+
+    /**
+     * Removes any number of entries from the file, which is only rewritten
+     * once. The file is replaced atomically, and the model is reloaded.
+     *
+     * If the file changed since it was loaded, it's reloaded first, and the
+     * entries with the same lines as the given ones are removed instead.
+     *
+     * @param positions The positions of the entries in this model.
+     * @param cancellable Allows the operation to be cancelled.
+     */
+    public async void remove_entries_async(uint[] positions,
+                                           Cancellable? cancellable = null) throws GLib.Error {
+        var removed = new bool[this.entries.length];
+        bool any_removed = false;
+        foreach (var position in positions) {
+            if (position < this.entries.length) {
+                removed[position] = true;
+                any_removed = true;
+            }
+        }
+
+        if (!any_removed)
+            return;
+
+        // Don't write back an old copy over changes somebody else made
+        if (!is_mapped_file_current()) {
+            var removed_lines = new HashTable<string, uint>(str_hash, str_equal);
+            for (uint i = 0; i < removed.length; i++) {
+                if (removed[i]) {
+                    var line = get_line(i);
+                    removed_lines[line] = removed_lines[line] + 1;
+                }
+            }
+
+            yield load(cancellable);
+
+            removed = new bool[this.entries.length];
+            any_removed = false;
+            for (uint i = 0; i < this.entries.length && removed_lines.size() > 0; i++) {
+                var line = get_line(i);
+                uint count = removed_lines[line];
+                if (count == 0)
+                    continue;
+
+                removed[i] = true;
+                any_removed = true;
+                if (count > 1)
+                    removed_lines[line] = count - 1;
+                else
+                    removed_lines.remove(line);
+            }
+
+            if (!any_removed)
+                return;
+        }
+
+        SourceFunc callback = remove_entries_async.callback;
+        GLib.Error? err = null;
+        Bytes contents = this.contents;
+        int[] entries = this.entries;
+
+        Thread<void*> thread = new Thread<void*>("known-hosts-remove", () => {
+            try {
+                KeyData.replace_file(this.filename, (output) => {
+                    write_without_entries(output, contents.get_data(),
+                                          entries, removed, cancellable);
+                }, cancellable);
+            } catch (GLib.Error e) {
+                err = e;
+            }
+
+            Idle.add((owned) callback);
+            return null;
+        });
+
+        yield;
+
+        thread.join();
+
+        if (err != null)
+            throw err;
+
+        yield load(cancellable);
+    }
+
+    // Writes the contents, leaving out the removed entries (the spans in
+    // between are copied as a whole)
+    private static void write_without_entries(OutputStream output,
+                                              uint8[] data,
+                                              int[] entries,
+                                              bool[] removed,
+                                              Cancellable? cancellable) throws GLib.Error {
+        size_t written;
+        int span_start = 0;
+        for (int i = 0; i < entries.length; i++) {
+            if (!removed[i])
+                continue;
+
+            if (entries[i] > span_start)
+                output.write_all(data[span_start:entries[i]], out written, cancellable);
+            span_start = int.min(find_line_end(data, entries[i]) + 1, data.length);
+        }
+        if (span_start < data.length)
+            output.write_all(data[span_start:data.length], out written, cancellable);
+    }
+
+    // Whether the file is still the one that was mapped (or still missing)
+    private bool is_mapped_file_current() {
+        Posix.Stat st;
+        if (Posix.stat(this.filename, out st) != 0)
+            return this.mapped_stat == null;
+
+        return this.mapped_stat != null &&
+               st.st_ino == this.mapped_stat.st_ino &&
+               st.st_size == this.mapped_stat.st_size &&
+               st.st_mtime == this.mapped_stat.st_mtime;
+    }
+
+    private void on_file_changed(File file, File? other_file, FileMonitorEvent event_type) {
+        if (event_type != FileMonitorEvent.CHANGES_DONE_HINT &&
+            event_type != FileMonitorEvent.DELETED &&
+            event_type != FileMonitorEvent.CREATED &&
+            event_type != FileMonitorEvent.MOVED_IN &&
+            event_type != FileMonitorEvent.RENAMED)
+            return;
+
+        if (this.scheduled_reload_source == 0)
+            this.scheduled_reload_source = Timeout.add(500, scheduled_reload);
+    }
+
+    private bool scheduled_reload() {
+        this.scheduled_reload_source = 0;
+
+        // Skip our own changes, which were already reloaded
+        if (is_mapped_file_current())
+            return false;
+
+        load.begin(null, (obj, res) => {
+            try {
+                load.end(res);
+            } catch (GLib.Error e) {
+                warning("Couldn't reload %s: %s", this.filename, e.message);
+            }
+        });
+        return false; // don't run again
+    }
+}
@@ -43,11 +43,15 @@ public abstract class Operation : GLib.Object {
      * @param command The command that should be launched.
      * @param input The standard input for the command, or null if none expected.
      * @param cancellable Can be used if you want to cancel. The process will be killed.
+     * @param passphrase If set, the askpass helper answers with this instead
+     *                   of prompting. It's handed over in the environment,
+     *                   which (unlike the command line) other users can't read.
      * @return The output of the command.
      */
     protected async string? operation_async(string command,
                                             string? input,
-                                            Cancellable? cancellable) throws GLib.Error
+                                            Cancellable? cancellable,
+                                            string? passphrase = null) throws GLib.Error
             requires(command != "") {
 
         // Strip the command name for logging purposes
@@ -78,6 +82,8 @@ public abstract class Operation : GLib.Object {
             launcher.setenv("SEAHORSE_SSH_ASKPASS_TITLE", prompt_title, true);
         if (this.prompt_message != null)
             launcher.setenv("SEAHORSE_SSH_ASKPASS_MESSAGE", prompt_message, true);
+        if (passphrase != null)
+            launcher.setenv("SEAHORSE_SSH_ASKPASS_PASSPHRASE", passphrase, true);
 
         launcher.set_child_setup(() => {
             // No terminal for this process
@@ -121,9 +127,12 @@ public class UploadOperation : Operation {
             requires(hostname != "") {
         this.prompt_title = _("Remote Host Password");
 
-        if (port == null)
-            port = "";
+        string cmd = build_command(username, hostname, port);
+        yield operation_async(cmd, build_data(keys), cancellable);
+    }
 
+    // The public keys, as they should be appended to authorized_keys
+    internal static string build_data(List<Key> keys) {
         StringBuilder data = new StringBuilder.sized(1024);
         keys.foreach((key) => {
             KeyData keydata = key.key_data;
@@ -132,16 +141,242 @@ public class UploadOperation : Operation {
                 data.append_c('\n');
             }
         });
+        return data.str;
+    }
+
+    /*
+     * This command creates the .ssh directory if necessary (with appropriate permissions)
+     * and then appends all input data onto the end of .ssh/authorized_keys
+     */
+    public static string build_command(string username, string hostname, string? port,
+                                       string? extra_options = null) {
+        string port_str = (port != null && port != "")? "-p %s".printf(Shell.quote(port)) : "";
 
-        /*
-         * This command creates the .ssh directory if necessary (with appropriate permissions)
-         * and then appends all input data onto the end of .ssh/authorized_keys
-         */
         // TODO: Important, we should handle the host checking properly
-        string cmd = "%s '%s@%s' %s %s -o StrictHostKeyChecking=no \"umask 077; test -d .ssh || mkdir .ssh ; cat >> .ssh/authorized_keys\""
-                               .printf(Config.SSH_PATH, username, hostname, port != "" ? "-p" : "", port);
+        return "%s %s %s %s -o StrictHostKeyChecking=no \"umask 077; test -d .ssh || mkdir .ssh ; cat >> .ssh/authorized_keys\""
+                   .printf(Config.SSH_PATH, Shell.quote(username + "@" + hostname),
+                           port_str, extra_options ?? "");
+    }
+}
+
+/**
+ * A host to upload keys to with a {@link FleetUploadOperation}.
+ */
+public class UploadTarget : GLib.Object {
+    public string username { get; construct set; }
+    public string hostname { get; construct set; }
+    public string? port { get; construct set; }
+
+    public UploadTarget(string username, string hostname, string? port = null) {
+        GLib.Object(username: username, hostname: hostname, port: port);
+    }
+
+    /**
+     * Parses a "host", "host:port" or "[host]:port" string. An IPv6 address
+     * only has a port if it's between brackets.
+     */
+    public UploadTarget.parse(string username, string host_port) {
+        string hostname = host_port;
+        string? port = null;
+
+        int end = host_port.index_of_char(']');
+        if (host_port.has_prefix("[") && end > 0) {
+            hostname = host_port.substring(1, end - 1);
+            if (host_port.get_char(end + 1) == ':')
+                port = host_port.substring(end + 2);
+        } else if (host_port.index_of_char(':') == host_port.last_index_of_char(':')) {
+            string[] host_port_split = host_port.split(":", 2);
+            hostname = host_port_split[0];
+            if (host_port_split.length == 2)
+                port = host_port_split[1];
+        }
+
+        this(username, hostname, port);
+    }
+
+    public string to_string() {
+        string hostname = this.hostname.contains(":")? "[%s]".printf(this.hostname) : this.hostname;
+        if (this.port != null && this.port != "")
+            return "%s@%s:%s".printf(this.username, hostname, this.port);
+        return "%s@%s".printf(this.username, hostname);
+    }
+}
+
+/**
+ * An operation that does the same thing for many items, a few of them at the
+ * same time.
+ *
+ * Subclasses implement run_job() for a single item, and call run_jobs() to
+ * go over all of them.
+ */
+public abstract class BatchOperation : Operation {
+
+    /** How many items are handled at the same time */
+    public uint max_concurrent { get; set; default = 1; }
+
+    /** How many items are done (whether it failed or not) */
+    public uint n_done { get; private set; default = 0; }
+
+    /** How many items failed */
+    public uint n_failed { get; private set; default = 0; }
+
+    /** How many items there are in total */
+    public uint n_total { get; private set; default = 0; }
+
+    private uint next_job;
+
+    /**
+     * Handles the item at the given index.
+     */
+    protected abstract async void run_job(uint index, Cancellable? cancellable) throws GLib.Error;
+
+    /**
+     * Called when the item at the given index is done. The error is null on
+     * success.
+     */
+    protected virtual void job_done(uint index, GLib.Error? error) {
+    }
+
+    /**
+     * Calls run_job() for each of the n_jobs items, with no more than
+     * max_concurrent of them running at the same time. Failures are counted
+     * in n_failed. When cancelled, the items that didn't start yet are
+     * skipped.
+     */
+    protected async void run_jobs(uint n_jobs, Cancellable? cancellable) {
+        this.next_job = 0;
+        this.n_total = n_jobs;
+        this.n_done = 0;
+        this.n_failed = 0;
+
+        // Each worker takes the next item when it's done with the previous
+        SourceFunc callback = run_jobs.callback;
+        uint n_workers = uint.min(uint.max(this.max_concurrent, 1), n_jobs);
+        uint running = n_workers;
+        for (uint i = 0; i < n_workers; i++) {
+            run_worker.begin(cancellable, (obj, res) => {
+                run_worker.end(res);
+                if (--running == 0)
+                    callback();
+            });
+        }
+
+        if (n_workers > 0)
+            yield;
+    }
+
+    private async void run_worker(Cancellable? cancellable) {
+        while (this.next_job < this.n_total) {
+            if (cancellable != null && cancellable.is_cancelled())
+                return;
+
+            uint index = this.next_job++;
+            GLib.Error? error = null;
+            try {
+                yield run_job(index, cancellable);
+            } catch (GLib.Error e) {
+                error = e;
+                this.n_failed++;
+            }
+
+            this.n_done++;
+            job_done(index, error);
+        }
+    }
+}
+
+/**
+ * Uploads a set of keys to many hosts, a few of them at the same time.
+ *
+ * The connections are shared through OpenSSH's ControlMaster sockets,
+ * which are kept around for a while, so doing something else on the same
+ * host right after doesn't need a new login.
+ */
+public class FleetUploadOperation : BatchOperation {
+
+    /** How many hosts are uploaded to at the same time, by default */
+    public const uint DEFAULT_MAX_CONCURRENT = 8;
+
+    // How long (in seconds) a master connection stays around when unused
+    private const uint CONTROL_PERSIST = 60;
+
+    /** Emitted for each host when it's done. The error is null on success. */
+    public signal void host_done(UploadTarget target, GLib.Error? error);
+
+    private UploadTarget[] targets;
+    private string data;
+    private string control_options;
+
+    construct {
+        this.max_concurrent = DEFAULT_MAX_CONCURRENT;
+    }
+
+    /**
+     * Uploads a set of keys to all the given hosts.
+     *
+     * @param keys The keys that should be uploaded.
+     * @param targets The hosts the keys should be uploaded to.
+     * @param cancellable Used if you want to cancel the operation.
+     */
+    public async void upload_async(List<Key> keys,
+                                   UploadTarget[] targets,
+                                   Cancellable? cancellable) throws GLib.Error
+            requires(keys != null) {
+        this.prompt_title = _("Remote Host Password");
+
+        this.targets = targets;
+        this.data = UploadOperation.build_data(keys);
+        this.control_options = get_control_options();
+
+        yield run_jobs(targets.length, cancellable);
+
+        if (cancellable != null)
+            cancellable.set_error_if_cancelled();
 
-        yield operation_async(cmd, data.str, cancellable);
+        if (this.n_failed > 0)
+            throw new Error.GENERAL(ngettext("Couldn’t upload keys to %u of %u host",
+                                             "Couldn’t upload keys to %u of %u hosts",
+                                             this.n_total).printf(this.n_failed, this.n_total));
+    }
+
+    protected override async void run_job(uint index, Cancellable? cancellable) throws GLib.Error {
+        var target = this.targets[index];
+        string cmd = UploadOperation.build_command(target.username,
+                                                   target.hostname,
+                                                   target.port,
+                                                   this.control_options);
+        try {
+            yield operation_async(cmd, this.data, cancellable);
+        } catch (GLib.Error e) {
+            warning("Couldn't upload keys to %s: %s", target.to_string(), e.message);
+            throw e;
+        }
+    }
+
+    protected override void job_done(uint index, GLib.Error? error) {
+        host_done(this.targets[index], error);
+    }
+
+    // Options to share connections to the same host through a socket in a
+    // private directory. Without such a directory, it's one connection each.
+    private static string get_control_options() {
+        string dir = Path.build_filename(Environment.get_user_runtime_dir(),
+                                         "seahorse", "ssh-control");
+        if (DirUtils.create_with_parents(dir, 0700) != 0) {
+            warning("Couldn't create SSH control directory %s: %s", dir, strerror(errno));
+            return "";
+        }
+
+        return build_control_options(dir);
+    }
+
+    /**
+     * The ssh options to share connections through sockets in the given
+     * directory.
+     */
+    public static string build_control_options(string dir) {
+        return "-o ControlMaster=auto -o ControlPath=%s -o ControlPersist=%u"
+                   .printf(Shell.quote(Path.build_filename(dir, "%C")), CONTROL_PERSIST);
     }
 }
 
@@ -189,13 +424,143 @@ public class GenerateOperation : Operation {
 
         this.prompt_title = _("Passphrase for New Secure Shell Key");
 
+        string cmd = build_command(filename, email, type, bits);
+        yield operation_async(cmd, null, cancellable);
+    }
+
+    /*
+     * Unless the key is unencrypted, ssh-keygen asks for a passphrase through
+     * the askpass helper. A passphrase never goes on the command line, where
+     * anybody could read it.
+     */
+    public static string build_command(string filename,
+                                       string comment,
+                                       Algorithm type,
+                                       uint bits,
+                                       bool unencrypted = false) {
         string algo = type.to_string().down();
         string bits_str = (bits != 0)? "-b '%u'".printf(bits) : "";
-        string comment = GLib.Shell.quote(email);
+        string passphrase_str = unencrypted? "-N ''" : "";
 
-        string cmd = "%s %s -t '%s' -C %s -f '%s'".printf(Config.SSH_KEYGEN_PATH, bits_str, algo, comment, filename);
+        return "%s %s -t '%s' -C %s %s -f '%s'".printf(Config.SSH_KEYGEN_PATH, bits_str, algo,
+                                                       GLib.Shell.quote(comment), passphrase_str,
+                                                       filename);
+    }
+}
 
-        yield operation_async(cmd, null, cancellable);
+/**
+ * The kind of key to make with a {@link BatchGenerateOperation}.
+ *
+ * A key gets a passphrase, unless it's explicitly made with
+ * {@link GenerateSpec.unencrypted}.
+ */
+public class GenerateSpec : GLib.Object {
+    public Algorithm algo { get; construct set; }
+    public uint bits { get; construct set; }
+    public string comment { get; construct set; }
+    public string? passphrase { get; construct set; default = null; }
+
+    /** Whether the key is written without a passphrase, on purpose */
+    public bool unencrypted { get; construct set; default = false; }
+
+    public GenerateSpec(Algorithm algo, uint bits, string comment, string passphrase) {
+        GLib.Object(algo: algo, bits: bits, comment: comment, passphrase: passphrase);
+    }
+
+    /**
+     * A key without a passphrase, e.g. for something that runs unattended.
+     */
+    public GenerateSpec.unencrypted(Algorithm algo, uint bits, string comment) {
+        GLib.Object(algo: algo, bits: bits, comment: comment, unencrypted: true);
+    }
+}
+
+/**
+ * Generates many SSH keys, with a few ssh-keygen processes running at the
+ * same time.
+ *
+ * Since there's nobody to type a passphrase for each key, every
+ * {@link GenerateSpec} needs to have one, or has to be marked as unencrypted.
+ */
+public class BatchGenerateOperation : BatchOperation {
+
+    /** Emitted for each key when it's done. The error is null on success. */
+    public signal void key_done(GenerateSpec spec, GLib.Error? error);
+
+    private Source source;
+    private GenerateSpec[] specs;
+    // The private key file for each spec, once it's generated
+    private string?[] filenames;
+
+    construct {
+        // One per CPU
+        this.max_concurrent = get_num_processors();
+    }
+
+    /**
+     * Generates all the given keys and adds them to the source in one go.
+     *
+     * @param source The source the keys are added to.
+     * @param specs The keys that should be generated.
+     * @param cancellable Used if you want to cancel the operation.
+     * @return The new keys.
+     */
+    public async Key[] generate_async(Source source,
+                                      GenerateSpec[] specs,
+                                      Cancellable? cancellable) throws GLib.Error {
+        foreach (unowned var spec in specs) {
+            if (spec.algo == Algorithm.UNKNOWN)
+                throw new Error.GENERAL("Can't generate key for an unknown algorithm");
+            if ((spec.passphrase == null || spec.passphrase == "") && !spec.unencrypted)
+                throw new Error.GENERAL("Key '%s' has no passphrase".printf(spec.comment));
+        }
+
+        this.source = source;
+        this.specs = specs;
+        this.filenames = new string?[specs.length];
+
+        yield run_jobs(specs.length, cancellable);
+
+        // Whatever got generated is added, even if something else failed
+        string[] generated = {};
+        foreach (unowned var filename in this.filenames) {
+            if (filename != null)
+                generated += filename;
+        }
+        var keys = yield source.add_keys_from_filenames(generated);
+
+        if (cancellable != null)
+            cancellable.set_error_if_cancelled();
+
+        if (this.n_failed > 0)
+            throw new Error.GENERAL(ngettext("Couldn’t generate %u of %u key",
+                                             "Couldn’t generate %u of %u keys",
+                                             this.n_total).printf(this.n_failed, this.n_total));
+
+        return keys;
+    }
+
+    protected override async void run_job(uint index, Cancellable? cancellable) throws GLib.Error {
+        var spec = this.specs[index];
+        string? filename = null;
+        try {
+            filename = this.source.reserve_filename_for_algorithm(spec.algo);
+            string cmd = GenerateOperation.build_command(filename, spec.comment,
+                                                         spec.algo, spec.bits,
+                                                         spec.unencrypted);
+            yield operation_async(cmd, null, cancellable,
+                                  spec.unencrypted? null : spec.passphrase);
+            this.filenames[index] = filename;
+        } catch (GLib.Error e) {
+            warning("Couldn't generate key '%s': %s", spec.comment, e.message);
+            if (filename != null)
+                this.source.release_filename(filename);
+            throw e;
+        }
+    }
+
+    protected override void job_done(uint index, GLib.Error? error) {
+        key_done(this.specs[index], error);
     }
 }
 
@@ -215,9 +580,23 @@ public class PrivateImportOperation : Operation {
         if (data == null || data.rawdata == null)
             throw new Error.GENERAL("Trying to import private key that is empty.");
 
-        // No filename specified, make one up
-        string file = filename ?? source.new_filename_for_algorithm(data.algo);
+        // No filename specified, claim one
+        string file = filename ?? source.reserve_filename_for_algorithm(data.algo);
+
+        try {
+            return yield import_to_file(data, file, cancellable);
+        } catch (GLib.Error e) {
+            if (filename == null) {
+                FileUtils.unlink(file);
+                source.release_filename(file);
+            }
+            throw e;
+        }
+    }
 
+    private async string import_to_file(SecData data,
+                                        string file,
+                                        Cancellable cancellable) throws GLib.Error {
         // Add the comment to the output
         string message = (data.comment != null) ?
             _("Importing key: %s").printf(data.comment) : _("Importing key. Enter passphrase");
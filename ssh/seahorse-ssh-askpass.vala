@@ -31,6 +31,16 @@ public int main(string[] args) {
     /* Non buffered stdout */
     setvbuf(Posix.stdout, null, _IONBF, 0);
 
+    /* Seahorse already knows the passphrase, so there's nothing to ask */
+    unowned var passphrase = Environment.get_variable("SEAHORSE_SSH_ASKPASS_PASSPHRASE");
+    if (passphrase != null) {
+        if (Posix.write(1, passphrase, passphrase.length) != passphrase.length) {
+            warning("couldn't write out password properly");
+            return 1;
+        }
+        return 0;
+    }
+
     var app = new Adw.Application(null, ApplicationFlags.HANDLES_COMMAND_LINE);
     app.command_line.connect(on_app_command_line);
 
@@ -32,15 +32,31 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
     public const string AUTHORIZED_KEYS_FILE = "authorized_keys";
     public const string OTHER_KEYS_FILE = "other_keys.seahorse";
 
+    // How much of a file is needed to see whether it's a private key
+    private const size_t PRIVATE_KEY_PEEK_SIZE = 512;
+
     // The home directory for SSH keys.
     private string ssh_homedir;
     // Source for refresh timeout
     private uint scheduled_refresh_source = 0;
+    // The files that changed since the refresh was scheduled
+    private GenericSet<string> changed_files = new GenericSet<string>(str_hash, str_equal);
+    // Set for a while after a full load was started, to ignore changes
+    private bool monitor_blocked = false;
     // For monitoring the .ssh directory
     private FileMonitor? monitor_handle = null;
 
     // The list of Seahorse.Ssh.Keys
     private GenericArray<Ssh.Key> keys = new GenericArray<Ssh.Key>();
+    // Lookup tables for the keys above, kept in sync with it
+    private HashTable<string, Ssh.Key> keys_by_fingerprint =
+        new HashTable<string, Ssh.Key>(str_hash, str_equal);
+    private HashTable<string, Ssh.Key> keys_by_privfile =
+        new HashTable<string, Ssh.Key>(str_hash, str_equal);
+    // For each basename of new keys (e.g. "id_ed25519"), the first suffix
+    // that might still be free. See reserve_filename_for_algorithm().
+    private HashTable<string, int> next_filename_suffix =
+        new HashTable<string, int>(str_hash, str_equal);
 
     public string label {
         owned get { return _("OpenSSH keys"); }
@@ -92,17 +108,23 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
         monitor_ssh_homedir();
     }
 
-    private bool check_file_for_ssh(string filename) {
-        if(!FileUtils.test(filename, FileTest.IS_REGULAR))
-            return false;
-
+    // Checks the start of the file for a private key header, so we don't
+    // have to read all of big unrelated files like known_hosts
+    private async bool check_file_for_ssh(string filename,
+                                          Cancellable? cancellable = null) {
         try {
-            string contents;
-            FileUtils.get_contents(filename, out contents);
+            var file = File.new_for_path(filename);
+            var stream = yield file.read_async(Priority.DEFAULT, cancellable);
+
+            var buffer = new uint8[PRIVATE_KEY_PEEK_SIZE];
+            size_t n_read;
+            yield stream.read_all_async(buffer, Priority.DEFAULT, cancellable, out n_read);
+            yield stream.close_async(Priority.DEFAULT, cancellable);
 
             // Check for our signature
-            return " PRIVATE KEY-----" in contents;
-        } catch (FileError e) {
+            string header = ((string) buffer).substring(0, (long) n_read);
+            return " PRIVATE KEY-----" in header;
+        } catch (GLib.Error e) {
             warning("Error reading file '%s' to check for SSH key. %s".printf(filename, e.message));
         }
 
@@ -115,18 +137,31 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
             GLib.Source.remove(this.scheduled_refresh_source);
             this.scheduled_refresh_source = 0;
         }
+        this.changed_files.remove_all();
+        this.monitor_blocked = false;
     }
 
     private bool scheduled_refresh() {
-        debug("Scheduled refresh event ocurring now");
-        cancel_scheduled_refresh();
-        load.begin(null);
-        return false; // don't run again
-    }
-
-    private bool scheduled_dummy() {
-        debug("Dummy refresh event occurring now");
         this.scheduled_refresh_source = 0;
+
+        if (this.monitor_blocked) {
+            debug("Dummy refresh event occurring now");
+            this.monitor_blocked = false;
+            return false; // don't run again
+        }
+
+        debug("Scheduled refresh event ocurring now");
+        var files = (owned) this.changed_files;
+        this.changed_files = new GenericSet<string>(str_hash, str_equal);
+        foreach (unowned var filename in files) {
+            reload_file.begin(filename, (obj, res) => {
+                try {
+                    reload_file.end(res);
+                } catch (GLib.Error err) {
+                    warning("Couldn't reload SSH file: %s", err.message);
+                }
+            });
+        }
         return false; // don't run again
     }
 
@@ -137,34 +172,116 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
 
         try {
             this.monitor_handle = dot_ssh_dir.monitor_directory(FileMonitorFlags.NONE, null);
-            this.monitor_handle.changed.connect((file, other_file, event_type) => {
-                if (this.scheduled_refresh_source != 0 ||
-                    (event_type != FileMonitorEvent.CHANGED &&
-                     event_type != FileMonitorEvent.CHANGES_DONE_HINT &&
-                     event_type != FileMonitorEvent.DELETED &&
-                     event_type != FileMonitorEvent.CREATED))
-                    return;
-
-                string? path = file.get_path();
-                if (path == null)
-                    return;
-
-                // Filter out any noise
-                if (event_type != FileMonitorEvent.DELETED
-                        && !path.has_suffix(AUTHORIZED_KEYS_FILE)
-                        && !path.has_suffix(OTHER_KEYS_FILE)
-                        && !path.has_suffix(".pub")
-                        && !SecData.contains_private_key(path))
-                    return;
-
-                debug("Scheduling refresh event due to file changes");
-                this.scheduled_refresh_source = Timeout.add(500, scheduled_refresh);
-            });
+            this.monitor_handle.changed.connect(on_ssh_homedir_changed);
         } catch (GLib.Error e) {
             warning("couldn't monitor ssh directory: %s: %s", this.ssh_homedir, e.message);
         }
     }
 
+    private void on_ssh_homedir_changed(File file, File? other_file, FileMonitorEvent event_type) {
+        if (this.monitor_blocked ||
+            (event_type != FileMonitorEvent.CHANGED &&
+             event_type != FileMonitorEvent.CHANGES_DONE_HINT &&
+             event_type != FileMonitorEvent.DELETED &&
+             event_type != FileMonitorEvent.CREATED))
+            return;
+
+        string? basename = file.get_basename();
+        if (basename == null)
+            return;
+
+        // Filter out any noise
+        string filename = Path.build_filename(this.ssh_homedir, basename);
+        if (basename != AUTHORIZED_KEYS_FILE
+                && basename != OTHER_KEYS_FILE
+                && !basename.has_suffix(".pub")
+                && !this.keys_by_privfile.contains(filename)
+                && !FileUtils.test(filename + ".pub", FileTest.EXISTS))
+            return;
+
+        // Bursts of events for the same files end up in the same refresh
+        this.changed_files.add(filename);
+        if (this.scheduled_refresh_source == 0) {
+            debug("Scheduling refresh event due to file changes");
+            this.scheduled_refresh_source = Timeout.add(500, scheduled_refresh);
+        }
+    }
+
+    // Reloads the keys of a single file, after it changed
+    private async void reload_file(string filename) throws GLib.Error {
+        if (filename == authorized_keys_path())
+            yield reload_public_file(filename, true);
+        else if (filename == other_keys_path())
+            yield reload_public_file(filename, false);
+        else if (filename.has_suffix(".pub"))
+            yield reload_private_key(filename.substring(0, filename.length - 4));
+        else
+            yield reload_private_key(filename);
+    }
+
+    // Updates the model with what's (still) in a file of public keys
+    private async void reload_public_file(string pubfile, bool authorized) throws GLib.Error {
+        KeyData[] keydatas = {};
+        if (FileUtils.test(pubfile, FileTest.IS_REGULAR)) {
+            var result = yield Key.parse_file(pubfile);
+            keydatas = result.public_keys;
+        }
+
+        var fingerprints = new GenericSet<string>(str_hash, str_equal);
+        foreach (unowned var keydata in keydatas)
+            fingerprints.add(keydata.fingerprint);
+
+        // Drop the keys that aren't in there anymore
+        for (uint i = this.keys.length; i > 0; i--) {
+            var key = this.keys[i - 1];
+            if (fingerprints.contains(key.fingerprint))
+                continue;
+
+            if (key.key_data.partial && key.key_data.pubfile == pubfile)
+                remove_object(key);
+            else if (authorized && key.key_data.authorized)
+                key.update_authorized(false);
+        }
+
+        // And add (or merge) the ones that are
+        add_keys_from_parsed_data(keydatas, pubfile, true, authorized);
+    }
+
+    // Reloads a key pair, after either of the files changed
+    private async void reload_private_key(string privfile) throws GLib.Error {
+        bool was_authorized = false;
+
+        var old = this.keys_by_privfile[privfile];
+        if (old != null && yield is_same_key(old, privfile))
+            return;
+
+        if (old != null) {
+            was_authorized = old.key_data.authorized;
+            remove_object(old);
+        }
+
+        var key = yield load_key_for_private_file(privfile);
+        if (key != null && was_authorized && key.fingerprint == old.fingerprint)
+            key.update_authorized(true);
+    }
+
+    // Whether the files of a key pair still contain the given (loaded) key,
+    // like right after we added it ourselves.
+    private async bool is_same_key(Key key, string privfile) {
+        string pubfile = privfile + ".pub";
+        if (!FileUtils.test(privfile, FileTest.IS_REGULAR)
+                || !FileUtils.test(pubfile, FileTest.IS_REGULAR))
+            return false;
+
+        try {
+            var result = yield Key.parse_file(pubfile);
+            return result.public_keys.length == 1
+                && result.public_keys[0].fingerprint == key.fingerprint;
+        } catch (GLib.Error e) {
+            return false;
+        }
+    }
+
     public GLib.Type get_item_type() {
         return typeof(Ssh.Key);
     }
@@ -182,11 +299,29 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
     public void remove_object(Ssh.Key key) {
         uint pos;
         if (this.keys.find(key, out pos)) {
+            unindex_key(key);
             this.keys.remove_index(pos);
             items_changed(pos, 1, 0);
         }
     }
 
+    private void index_key(Ssh.Key key) {
+        if (key.fingerprint != null)
+            this.keys_by_fingerprint[key.fingerprint] = key;
+        if (key.key_data.privfile != null)
+            this.keys_by_privfile[key.key_data.privfile] = key;
+    }
+
+    private void unindex_key(Ssh.Key key) {
+        unowned var fingerprint = key.fingerprint;
+        if (fingerprint != null && this.keys_by_fingerprint[fingerprint] == key)
+            this.keys_by_fingerprint.remove(fingerprint);
+
+        unowned var privfile = key.key_data.privfile;
+        if (privfile != null && this.keys_by_privfile[privfile] == key)
+            this.keys_by_privfile.remove(privfile);
+    }
+
     public string authorized_keys_path() {
         return Path.build_filename(this.ssh_homedir, AUTHORIZED_KEYS_FILE);
     }
@@ -200,27 +335,27 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
             return null;
 
         // Check if it was already loaded once. If not, load it now
-        for (uint i = 0; i < this.keys.length; i++) {
-            unowned var key = this.keys[i];
-            if (key.key_data.privfile == privfile) {
-                return key;
-            }
-        }
+        var key = this.keys_by_privfile[privfile];
+        if (key != null)
+            return key;
 
         return yield load_key_for_private_file(privfile);
     }
 
     // Loads the (public) key for a private key.
-    private async Key? load_key_for_private_file(string privfile) throws GLib.Error {
+    private async Key? load_key_for_private_file(string privfile,
+                                                 Cancellable? cancellable = null) throws GLib.Error {
         string pubfile = privfile + ".pub";
         Key? key = null;
 
         // possibly an SSH key?
-        if (FileUtils.test(privfile, FileTest.EXISTS)
-                && FileUtils.test(pubfile, FileTest.EXISTS)
-                && check_file_for_ssh(privfile)) {
+        if (!FileUtils.test(privfile, FileTest.IS_REGULAR)
+                || !FileUtils.test(pubfile, FileTest.EXISTS))
+            return null;
+
+        if (yield check_file_for_ssh(privfile, cancellable)) {
             try {
-                var result = yield Key.parse_file(pubfile);
+                var result = yield Key.parse_file(pubfile, cancellable);
                 foreach (unowned var keydata in result.public_keys) {
                     key = add_key_from_parsed_data(keydata, pubfile, false, false, privfile);
                 }
@@ -240,17 +375,32 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
     public async bool load(GLib.Cancellable? cancellable) throws GLib.Error {
         // Schedule a dummy refresh. This blocks all monitoring for a while
         cancel_scheduled_refresh();
-        this.scheduled_refresh_source = Timeout.add(500, scheduled_dummy);
+        this.monitor_blocked = true;
+        this.scheduled_refresh_source = Timeout.add(500, scheduled_refresh);
         debug("scheduled a dummy refresh");
 
         // List the .ssh directory for private keys
-        Dir dir = Dir.open(this.ssh_homedir);
+        var dir = File.new_for_path(this.ssh_homedir);
+        var enumerator = yield dir.enumerate_children_async(
+            FileAttribute.STANDARD_NAME + "," + FileAttribute.STANDARD_TYPE,
+            FileQueryInfoFlags.NONE, Priority.DEFAULT, cancellable);
+
+        var filenames = new GenericSet<string>(str_hash, str_equal);
+        List<FileInfo> infos;
+        while ((infos = yield enumerator.next_files_async(64, Priority.DEFAULT, cancellable)) != null) {
+            foreach (unowned var info in infos) {
+                if (info.get_file_type() == FileType.REGULAR)
+                    filenames.add(info.get_name());
+            }
+        }
+
+        // Load each key file in ~/.ssh: those are the ones with a .pub next to them
+        foreach (unowned var filename in filenames) {
+            if (!filenames.contains(filename + ".pub"))
+                continue;
 
-        // Load each key file in ~/.ssh
-        string? filename = null;
-        while ((filename = dir.read_name()) != null) {
             string privfile = Path.build_filename(this.ssh_homedir, filename);
-            load_key_for_private_file.begin(privfile, (obj, res) => {
+            load_key_for_private_file.begin(privfile, cancellable, (obj, res) => {
                 try {
                     load_key_for_private_file.end(res);
                 } catch (GLib.Error err) {
@@ -261,20 +411,16 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
 
         // Now load the authorized keys (if it exists)
         string pubfile = authorized_keys_path();
-        if (FileUtils.test(pubfile, FileTest.IS_REGULAR)) {
-            var result = yield Key.parse_file(pubfile);
-            foreach (unowned var keydata in result.public_keys) {
-                add_key_from_parsed_data(keydata, pubfile, true, true, null);
-            }
+        if (filenames.contains(AUTHORIZED_KEYS_FILE)) {
+            var result = yield Key.parse_file(pubfile, cancellable);
+            add_keys_from_parsed_data(result.public_keys, pubfile, true, true);
         }
 
         // Load the "other keys" (public keys without authorization)
         pubfile = other_keys_path();
-        if (FileUtils.test(pubfile, FileTest.IS_REGULAR)) {
-            var result = yield Key.parse_file(pubfile);
-            foreach (unowned var keydata in result.public_keys) {
-                add_key_from_parsed_data(keydata, pubfile, true, false, null);
-            }
+        if (filenames.contains(OTHER_KEYS_FILE)) {
+            var result = yield Key.parse_file(pubfile, cancellable);
+            add_keys_from_parsed_data(result.public_keys, pubfile, true, false);
         }
 
         return true;
@@ -305,30 +451,171 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
         // Create a new key
         Key key = new Key(this, keydata);
         this.keys.add(key);
+        index_key(key);
         items_changed(this.keys.length - 1, 0, 1);
 
         return key;
     }
 
+    /**
+     * Adds many parsed keys to the model, with a single change notification
+     * for all the new ones.
+     *
+     * @return The keys, in the same order as the keydatas.
+     */
+    public Key[] add_keys_from_parsed_data(KeyData[] keydatas,
+                                           string pubfile,
+                                           bool partial,
+                                           bool authorized) {
+        foreach (unowned var keydata in keydatas) {
+            if (keydata == null)
+                continue;
+
+            keydata.pubfile = pubfile;
+            keydata.partial = partial;
+            keydata.authorized = authorized;
+        }
+
+        return add_parsed_keys(keydatas);
+    }
+
+    /**
+     * Loads the key pairs of the given private key files, and adds them to
+     * the model with a single change notification.
+     *
+     * @param privfiles The private key files (with a .pub next to each).
+     * @param cancellable Use this to cancel the operation.
+     * @return The keys that were loaded.
+     */
+    public async Key[] add_keys_from_filenames(string[] privfiles,
+                                               Cancellable? cancellable = null) throws GLib.Error {
+        KeyData[] keydatas = {};
+        foreach (unowned var privfile in privfiles) {
+            string pubfile = privfile + ".pub";
+            var result = yield Key.parse_file(pubfile, cancellable);
+            foreach (unowned var keydata in result.public_keys) {
+                keydata.pubfile = pubfile;
+                keydata.privfile = privfile;
+                keydata.partial = false;
+                keydata.authorized = false;
+                keydatas += keydata;
+            }
+        }
+
+        return add_parsed_keys(keydatas);
+    }
+
+    // Adds the keys (or merges them with the ones we already have)
+    private Key[] add_parsed_keys(KeyData[] keydatas) {
+        Key[] result = {};
+        uint first_new = this.keys.length;
+
+        foreach (unowned var keydata in keydatas) {
+            if (keydata == null || !keydata.is_valid())
+                continue;
+
+            Key? key = find_key_by_fingerprint(keydata.fingerprint);
+            if (key != null) {
+                key.merge_keydata(keydata);
+            } else {
+                key = new Key(this, keydata);
+                this.keys.add(key);
+                index_key(key);
+            }
+            result += key;
+        }
+
+        if (this.keys.length > first_new)
+            items_changed(first_new, 0, this.keys.length - first_new);
+
+        return result;
+    }
+
     /**
      * Parse an inputstream into a list of keys and import those keys.
+     *
+     * The public keys that aren't known yet are all added to the other keys
+     * file at once.
+     *
+     * @return The keys that were imported.
      */
     public async List<Key>? import_async(InputStream input,
                                          Gtk.Window? transient_for,
                                          Cancellable? cancellable = null) throws GLib.Error {
         var result = yield Key.parse(input, cancellable);
+        var imported = new List<Key>();
 
-        string fullpath = other_keys_path();
+        // Only write the ones we don't have yet, and each of them only once
+        var seen = new GenericSet<string>(str_hash, str_equal);
+        KeyData[] new_keys = {};
         foreach (unowned var keydata in result.public_keys) {
-            yield import_public_async(keydata, fullpath, cancellable);
+            if (!keydata.is_valid() || keydata.rawdata == null)
+                throw new Error.GENERAL("Trying to import an invalid public key.");
+
+            if (seen.contains(keydata.fingerprint))
+                continue;
+            seen.add(keydata.fingerprint);
+
+            var key = find_key_by_fingerprint(keydata.fingerprint);
+            if (key != null)
+                imported.append(key);
+            else
+                new_keys += keydata;
         }
+
+        if (new_keys.length > 0) {
+            string fullpath = other_keys_path();
+            yield filter_file_async(fullpath, new_keys, new KeyData[0], cancellable);
+
+            foreach (var key in add_keys_from_parsed_data(new_keys, fullpath, true, false))
+                imported.append(key);
+        }
+
         foreach (unowned var secdata in result.secret_keys) {
-            var op = new PrivateImportOperation();
-            yield op.import_private_async(this, secdata, null, cancellable);
+            // Claim the filename, so nothing else writes a key there meanwhile
+            string privfile = reserve_filename_for_algorithm(secdata.algo);
+            try {
+                var op = new PrivateImportOperation();
+                yield op.import_private_async(this, secdata, privfile, cancellable);
+            } catch (GLib.Error e) {
+                FileUtils.unlink(privfile);
+                release_filename(privfile);
+                throw e;
+            }
+
+            var key = yield add_key_from_filename(privfile);
+            if (key != null)
+                imported.append(key);
         }
 
-        // TODO: The list of keys imported?
-        return null;
+        return imported;
+    }
+
+    // Runs KeyData.filter_file_many() on a worker thread
+    private async void filter_file_async(string filename,
+                                         KeyData[] add,
+                                         KeyData[] remove,
+                                         Cancellable? cancellable) throws GLib.Error {
+        SourceFunc callback = filter_file_async.callback;
+        GLib.Error? err = null;
+
+        Thread<void*> thread = new Thread<void*>("filter-file", () => {
+            try {
+                KeyData.filter_file_many(filename, add, remove, cancellable);
+            } catch (GLib.Error e) {
+                err = e;
+            }
+
+            Idle.add((owned)callback);
+            return null;
+        });
+
+        yield;
+
+        thread.join();
+
+        if (err != null)
+            throw err;
     }
 
     /**
@@ -350,26 +637,54 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
     }
 
     /**
-     * Returns a possible filename for a key.
+     * Finds a filename for a new key and claims it, by creating the (empty)
+     * public key file next to it. That file is created exclusively, so keys
+     * that are generated at the same time (even by other processes) never
+     * get the same filename. ssh-keygen overwrites it with the actual key.
+     *
+     * Use release_filename() if no key gets written after all.
      *
      * @param algo The type of the key
+     * @return The filename for the private key.
      */
-    public string? new_filename_for_algorithm(Algorithm algo) {
+    public string reserve_filename_for_algorithm(Algorithm algo) throws GLib.Error {
         string type = algo.to_string() ?? "unk";
         string basename = "id_%s".printf(type.down());
 
-        string? filename = null;
-        for (int i = 0; i < int.MAX; i++) {
+        // Don't start over at the first filename each time
+        for (int i = this.next_filename_suffix[basename]; i < int.MAX; i++) {
             string t = (i == 0) ? basename : "%s.%d".printf(basename, i);
-            filename = Path.build_filename(this.base_directory, t);
+            string filename = Path.build_filename(this.base_directory, t);
+
+            if (FileUtils.test(filename, FileTest.EXISTS))
+                continue;
 
-            if (!FileUtils.test(filename, FileTest.EXISTS))
-                break;
+            int fd = Posix.open(filename + ".pub", Posix.O_WRONLY | Posix.O_CREAT | Posix.O_EXCL, 0644);
+            if (fd < 0) {
+                if (errno == Posix.EEXIST)
+                    continue;
+                throw new Error.GENERAL("Couldn't create %s.pub: %s".printf(filename, strerror(errno)));
+            }
+            Posix.close(fd);
 
-            filename = null;
+            this.next_filename_suffix[basename] = i + 1;
+            return filename;
         }
 
-        return filename;
+        throw new Error.GENERAL("Couldn't find a filename for a new %s key".printf(type));
+    }
+
+    /**
+     * Gives up a filename from reserve_filename_for_algorithm(), if no key
+     * was written to it.
+     */
+    public void release_filename(string filename) {
+        if (FileUtils.test(filename, FileTest.EXISTS))
+            return;
+
+        FileUtils.unlink(filename + ".pub");
+        // So the filename can be handed out again
+        this.next_filename_suffix.remove_all();
     }
 
     /**
@@ -379,9 +694,34 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
      * @param authorize Whether the specified key needs to be (de-)authorized.
      */
     public async void authorize_async(Key key, bool authorize) throws GLib.Error {
-        SourceFunc callback = authorize_async.callback;
+        Key[] keys = { key };
+        yield authorize_many_async(keys, authorize);
+    }
+
+    /**
+     * Adds/Removes public keys to/from the authorized keys. Each of the two
+     * files is rewritten only once, however many keys there are.
+     *
+     * @param keys The keys that need to be authorized.
+     * @param authorize Whether the specified keys need to be (de-)authorized.
+     * @param cancellable Allows the operation to be cancelled.
+     */
+    public async void authorize_many_async(Key[] keys,
+                                           bool authorize,
+                                           Cancellable? cancellable = null) throws GLib.Error {
+        SourceFunc callback = authorize_many_async.callback;
         GLib.Error? err = null;
 
+        KeyData[] keydatas = {};
+        foreach (unowned var key in keys) {
+            if (key.key_data == null)
+                throw new Error.GENERAL("Can't authorize empty key.");
+            keydatas += key.key_data;
+        }
+
+        if (keydatas.length == 0)
+            return;
+
         // Authorized key → add to authorized_keys
         // otherwise      → add to other_keys.seahorse
         string from, to;
@@ -395,21 +735,13 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
 
         Thread<void*> thread = new Thread<void*>("authorize-async", () => {
             try {
-                KeyData? keydata = key.key_data;
-                if (keydata == null)
-                    throw new Error.GENERAL("Can't authorize empty key.");
+                // Filter the public keys out of the file, if it exists
+                if (FileUtils.test(from, FileTest.EXISTS))
+                    KeyData.filter_file_many(from, new KeyData[0], keydatas, cancellable);
 
-                // Filter the public key out of the file, if it exists
-                if (FileUtils.test(from, FileTest.EXISTS)) {
-                    KeyData.filter_file(from, null, keydata);
-                }
-
-                // Now put it into the correct one (make sure that it exists at this point)
+                // Now put them into the correct one (make sure that it exists at this point)
                 ensure_file_exists(to);
-                KeyData.filter_file(to, keydata, null);
-
-                // Just reload that one key
-                key.refresh();
+                KeyData.filter_file_many(to, keydatas, new KeyData[0], cancellable);
             } catch (GLib.Error e) {
                 err = e;
             }
@@ -424,6 +756,14 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
 
         if (err != null)
             throw err;
+
+        // The keys notify their flags and trust themselves, so the rows
+        // update without the whole model changing
+        foreach (unowned var key in keys) {
+            if (key.key_data.partial)
+                key.key_data.pubfile = to;
+            key.update_authorized(authorize);
+        }
     }
 
     private void ensure_file_exists(string filename) {
@@ -432,11 +772,6 @@ public class Seahorse.Ssh.Source : GLib.Object, GLib.ListModel, Seahorse.Place {
     }
 
     public Key? find_key_by_fingerprint(string fingerprint) {
-        for (uint i = 0; i < this.keys.length; i++) {
-            if (this.keys[i].fingerprint == fingerprint)
-                return this.keys[i];
-        }
-
-        return null;
+        return this.keys_by_fingerprint[fingerprint];
     }
 }
@@ -0,0 +1,135 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+void main(string[] args) {
+  Test.init(ref args);
+
+  Test.add_func("/ssh/key-data/filter-file", test_key_data_filter_file);
+  Test.add_func("/ssh/key-data/filter-file-new", test_key_data_filter_file_new);
+  Test.add_func("/ssh/key-data/filter-file-symlink", test_key_data_filter_file_symlink);
+
+  Test.run();
+}
+
+private Seahorse.Ssh.KeyData make_key_data(uint8 seed, string comment) {
+  try {
+    return Seahorse.Ssh.KeyData.parse_line(make_key_line(seed, comment));
+  } catch (Error err) {
+    error("Couldn't parse generated key: %s", err.message);
+  }
+}
+
+private string make_tmp_dir() {
+  try {
+    return DirUtils.make_tmp("seahorse-ssh-test-XXXXXX");
+  } catch (Error err) {
+    error("Couldn't create temporary directory: %s", err.message);
+  }
+}
+
+private void test_key_data_filter_file() {
+  var dir = make_tmp_dir();
+  var path = Path.build_filename(dir, "authorized_keys");
+
+  var contents = new StringBuilder();
+  contents.append("from=\"*.example.com\" " + make_key_line(0, "zero") + "\n");
+  contents.append(make_key_line(1, "one") + "\n");
+  contents.append(make_key_line(2, "two") + "\n");
+  contents.append("# A comment\n");
+  contents.append("  # " + make_key_line(2, "disabled") + "\n");
+  contents.append(make_key_line(3, "three"));
+
+  try {
+    FileUtils.set_contents(path, contents.str);
+    FileUtils.chmod(path, 0600);
+
+    // Also remove the one with options, and move "one" to the back
+    Seahorse.Ssh.KeyData[] add = { make_key_data(4, "four"), make_key_data(1, "one") };
+    Seahorse.Ssh.KeyData[] remove = { make_key_data(0, "zero"), make_key_data(2, "other comment") };
+    Seahorse.Ssh.KeyData.filter_file_many(path, add, remove);
+
+    string result;
+    FileUtils.get_contents(path, out result);
+    assert_cmpstr(result, CompareOperator.EQ,
+                  "# A comment\n" +
+                  "  # " + make_key_line(2, "disabled") + "\n" +
+                  make_key_line(3, "three") + "\n" +
+                  make_key_line(4, "four") + "\n" +
+                  make_key_line(1, "one") + "\n");
+
+    // The permissions stay the same
+    Posix.Stat st;
+    assert_cmpint(Posix.stat(path, out st), CompareOperator.EQ, 0);
+    assert_cmpuint(st.st_mode & 0777, CompareOperator.EQ, 0600);
+  } catch (Error err) {
+    error("Couldn't filter file: %s", err.message);
+  } finally {
+    FileUtils.unlink(path);
+    DirUtils.remove(dir);
+  }
+}
+
+private void test_key_data_filter_file_new() {
+  var dir = make_tmp_dir();
+  var path = Path.build_filename(dir, "other_keys.seahorse");
+
+  try {
+    // Adding the same key twice, to a file that isn't there yet
+    Seahorse.Ssh.KeyData[] add = { make_key_data(5, "five"), make_key_data(5, "five") };
+    Seahorse.Ssh.KeyData.filter_file_many(path, add, new Seahorse.Ssh.KeyData[0]);
+
+    string result;
+    FileUtils.get_contents(path, out result);
+    assert_cmpstr(result, CompareOperator.EQ, make_key_line(5, "five") + "\n");
+  } catch (Error err) {
+    error("Couldn't filter file: %s", err.message);
+  } finally {
+    FileUtils.unlink(path);
+    DirUtils.remove(dir);
+  }
+}
+
+private void test_key_data_filter_file_symlink() {
+  var dir = make_tmp_dir();
+  var target = Path.build_filename(dir, "keys");
+  var path = Path.build_filename(dir, "authorized_keys");
+
+  try {
+    FileUtils.set_contents(target, make_key_line(6, "six") + "\n");
+    FileUtils.symlink("keys", path);
+
+    Seahorse.Ssh.KeyData[] add = { make_key_data(7, "seven") };
+    Seahorse.Ssh.KeyData.filter_file_many(path, add, new Seahorse.Ssh.KeyData[0]);
+
+    // The link stays, and the file it points to gets changed
+    assert_true(FileUtils.test(path, FileTest.IS_SYMLINK));
+
+    string result;
+    FileUtils.get_contents(target, out result);
+    assert_cmpstr(result, CompareOperator.EQ,
+                  make_key_line(6, "six") + "\n" +
+                  make_key_line(7, "seven") + "\n");
+  } catch (Error err) {
+    error("Couldn't filter file: %s", err.message);
+  } finally {
+    FileUtils.unlink(path);
+    FileUtils.unlink(target);
+    DirUtils.remove(dir);
+  }
+}
@@ -27,6 +27,10 @@ void main(string[] args) {
   Test.add_func("/ssh/key-parse/private-key-simple", test_key_parse_private_key_simple);
   Test.add_func("/ssh/key-parse/private-key-pw-protected", test_key_parse_private_key_pw_protected);
 
+  // Only with -m perf, so it doesn't slow down a normal test run
+  if (Test.perf())
+    Test.add_func("/ssh/key-parse/benchmark", test_key_parse_benchmark);
+
   Test.run();
 }
 
@@ -229,3 +233,45 @@ private void test_key_parse_private_key_pw_protected() {
   });
   mainloop.run();
 }
+
+const uint BENCHMARK_N_KEYS = 100000;
+
+private void test_key_parse_benchmark() {
+  var contents = new StringBuilder();
+  for (uint i = 0; i < BENCHMARK_N_KEYS; i++) {
+    // Throw in some of the things that appear in a real authorized_keys
+    if (i % 1000 == 0)
+      contents.append("# Keys of team %u\n\n".printf(i / 1000));
+    contents.append(make_key_line(i, "user%u@example.com".printf(i)));
+    contents.append_c('\n');
+  }
+  var input = new MemoryInputStream.from_data(contents.str.data);
+
+  var mainloop = new GLib.MainLoop();
+  var timer = new Timer();
+  Seahorse.Ssh.Key.parse.begin(input, null, (obj, res) => {
+      try {
+          var parse_result = Seahorse.Ssh.Key.parse.end(res);
+          timer.stop();
+
+          assert_true(parse_result.public_keys.length == BENCHMARK_N_KEYS);
+          assert_true(parse_result.secret_keys.length == 0);
+
+          unowned var last = parse_result.public_keys[BENCHMARK_N_KEYS - 1];
+          assert_true(last.comment == "user%u@example.com".printf(BENCHMARK_N_KEYS - 1));
+          assert_true(last.algo == Seahorse.Ssh.Algorithm.ED25519);
+          assert_true(last.fingerprint != parse_result.public_keys[0].fingerprint);
+
+          double elapsed = timer.elapsed();
+          Test.minimized_result(elapsed, "Parsed %u keys (%d bytes) in %.3f s",
+                                BENCHMARK_N_KEYS, (int) contents.len, elapsed);
+          Test.maximized_result(BENCHMARK_N_KEYS / elapsed, "%.0f keys/s",
+                                BENCHMARK_N_KEYS / elapsed);
+      } catch (Error err) {
+          error("Couldn't parse keys: %s", err.message);
+      } finally {
+          mainloop.quit();
+      }
+  });
+  mainloop.run();
+}
@@ -0,0 +1,221 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+void main(string[] args) {
+  Test.init(ref args);
+
+  Test.add_func("/ssh/known-hosts/load", test_known_hosts_load);
+  Test.add_func("/ssh/known-hosts/lookup-host", test_known_hosts_lookup_host);
+  Test.add_func("/ssh/known-hosts/lookup-fingerprint", test_known_hosts_lookup_fingerprint);
+  Test.add_func("/ssh/known-hosts/remove", test_known_hosts_remove);
+  Test.add_func("/ssh/known-hosts/remove-changed", test_known_hosts_remove_changed);
+
+  Test.run();
+}
+
+// Hashes a hostname like "ssh-keygen -H" does
+private string hash_host(string host) {
+  var salt = new uint8[20];
+  for (uint i = 0; i < salt.length; i++)
+    salt[i] = (uint8) (i * 7);
+
+  var hmac = new Hmac(ChecksumType.SHA1, salt);
+  hmac.update(host.data);
+  var digest = new uint8[20];
+  size_t digest_len = digest.length;
+  hmac.get_digest(digest, ref digest_len);
+
+  return "|1|%s|%s".printf(Base64.encode(salt), Base64.encode(digest));
+}
+
+private string write_known_hosts() {
+  var contents = new StringBuilder();
+  contents.append("# Some hosts\n");
+  contents.append("server.example.com,192.0.2.1 " + make_ed25519_key(0) + "\n");
+  contents.append("\n");
+  contents.append("[server.example.com]:2222 " + make_ed25519_key(1) + "\n");
+  contents.append(hash_host("hidden.example.com") + " " + make_ed25519_key(2) + "\n");
+  contents.append("*.internal.example.com " + make_ed25519_key(3) + "\n");
+  contents.append("@revoked other.example.com " + make_ed25519_key(0) + "\n");
+  contents.append("broken.example.com ssh-ed25519");
+
+  try {
+    var dir = DirUtils.make_tmp("seahorse-ssh-test-XXXXXX");
+    var path = Path.build_filename(dir, "known_hosts");
+    FileUtils.set_contents(path, contents.str);
+    return path;
+  } catch (Error err) {
+    error("Couldn't write known_hosts: %s", err.message);
+  }
+}
+
+private void remove_known_hosts(string path) {
+  FileUtils.unlink(path);
+  DirUtils.remove(Path.get_dirname(path));
+}
+
+private Seahorse.Ssh.KnownHosts load_known_hosts(string path) {
+  var known_hosts = new Seahorse.Ssh.KnownHosts(path);
+
+  var mainloop = new GLib.MainLoop();
+  known_hosts.load.begin(null, (obj, res) => {
+      try {
+          known_hosts.load.end(res);
+      } catch (Error err) {
+          error("Couldn't load known_hosts: %s", err.message);
+      } finally {
+          mainloop.quit();
+      }
+  });
+  mainloop.run();
+
+  return known_hosts;
+}
+
+private void test_known_hosts_load() {
+  var path = write_known_hosts();
+  var known_hosts = load_known_hosts(path);
+
+  // Comments and empty lines are skipped
+  assert_cmpuint(known_hosts.get_n_items(), CompareOperator.EQ, 7);
+
+  var key = (Seahorse.Ssh.Key) known_hosts.get_item(0);
+  assert_cmpstr(key.comment, CompareOperator.EQ, "server.example.com, 192.0.2.1");
+  assert_true(key.algo == Seahorse.Ssh.Algorithm.ED25519);
+  assert_nonnull(key.fingerprint);
+  assert_true(key.place == known_hosts);
+
+  // The same row gives the same key, as long as it's in use
+  assert_true(known_hosts.get_item(0) == key);
+  assert_cmpint(known_hosts.get_position(key), CompareOperator.EQ, 0);
+
+  // Broken entries are still there, so they can be removed
+  var broken = (Seahorse.Ssh.Key) known_hosts.get_item(6);
+  assert_null(broken.fingerprint);
+
+  remove_known_hosts(path);
+}
+
+private void test_known_hosts_lookup_host() {
+  var path = write_known_hosts();
+  var known_hosts = load_known_hosts(path);
+
+  var positions = known_hosts.lookup_host("Server.Example.com");
+  assert_cmpint(positions.length, CompareOperator.EQ, 1);
+  assert_cmpuint(positions[0], CompareOperator.EQ, 0);
+
+  positions = known_hosts.lookup_host("server.example.com", 2222);
+  assert_cmpint(positions.length, CompareOperator.EQ, 1);
+  assert_cmpuint(positions[0], CompareOperator.EQ, 1);
+
+  positions = known_hosts.lookup_host("hidden.example.com");
+  assert_cmpint(positions.length, CompareOperator.EQ, 1);
+  assert_cmpuint(positions[0], CompareOperator.EQ, 2);
+
+  positions = known_hosts.lookup_host("db.internal.example.com");
+  assert_cmpint(positions.length, CompareOperator.EQ, 1);
+  assert_cmpuint(positions[0], CompareOperator.EQ, 3);
+
+  positions = known_hosts.lookup_host("unknown.example.com");
+  assert_cmpint(positions.length, CompareOperator.EQ, 0);
+
+  remove_known_hosts(path);
+}
+
+private void test_known_hosts_lookup_fingerprint() {
+  var path = write_known_hosts();
+  var known_hosts = load_known_hosts(path);
+
+  // The revoked entry has the same key as the first one
+  var key = (Seahorse.Ssh.Key) known_hosts.get_item(0);
+  var positions = known_hosts.lookup_fingerprint(key.fingerprint);
+  assert_cmpint(positions.length, CompareOperator.EQ, 2);
+  assert_cmpuint(positions[0], CompareOperator.EQ, 0);
+  assert_cmpuint(positions[1], CompareOperator.EQ, 5);
+
+  remove_known_hosts(path);
+}
+
+private void remove_entries(Seahorse.Ssh.KnownHosts known_hosts, uint[] positions) {
+  var mainloop = new GLib.MainLoop();
+  known_hosts.remove_entries_async.begin(positions, null, (obj, res) => {
+      try {
+          known_hosts.remove_entries_async.end(res);
+      } catch (Error err) {
+          error("Couldn't remove entries: %s", err.message);
+      } finally {
+          mainloop.quit();
+      }
+  });
+  mainloop.run();
+}
+
+private void test_known_hosts_remove() {
+  var path = write_known_hosts();
+  var known_hosts = load_known_hosts(path);
+
+  uint n_changes = 0;
+  known_hosts.items_changed.connect((pos, removed, added) => n_changes++);
+
+  remove_entries(known_hosts, { 1, 2, 6 });
+
+  assert_cmpuint(n_changes, CompareOperator.EQ, 1);
+  assert_cmpuint(known_hosts.get_n_items(), CompareOperator.EQ, 4);
+  assert_cmpint(known_hosts.lookup_host("hidden.example.com").length, CompareOperator.EQ, 0);
+
+  try {
+    string result;
+    FileUtils.get_contents(path, out result);
+    assert_cmpstr(result, CompareOperator.EQ,
+                  "# Some hosts\n" +
+                  "server.example.com,192.0.2.1 " + make_ed25519_key(0) + "\n" +
+                  "\n" +
+                  "*.internal.example.com " + make_ed25519_key(3) + "\n" +
+                  "@revoked other.example.com " + make_ed25519_key(0) + "\n");
+  } catch (Error err) {
+    error("Couldn't read known_hosts: %s", err.message);
+  }
+
+  remove_known_hosts(path);
+}
+
+private void test_known_hosts_remove_changed() {
+  var path = write_known_hosts();
+  var known_hosts = load_known_hosts(path);
+
+  // Somebody else adds a host in front, after it was loaded
+  try {
+    string contents;
+    FileUtils.get_contents(path, out contents);
+    FileUtils.set_contents(path, "new.example.com " + make_ed25519_key(4) + "\n" + contents);
+  } catch (Error err) {
+    error("Couldn't change known_hosts: %s", err.message);
+  }
+
+  // The entries that were asked for are removed, and the new one is kept
+  remove_entries(known_hosts, { 1, 2, 6 });
+
+  assert_cmpuint(known_hosts.get_n_items(), CompareOperator.EQ, 5);
+  assert_cmpint(known_hosts.lookup_host("new.example.com").length, CompareOperator.EQ, 1);
+  assert_cmpint(known_hosts.lookup_host("server.example.com").length, CompareOperator.EQ, 1);
+  assert_cmpint(known_hosts.lookup_host("server.example.com", 2222).length, CompareOperator.EQ, 0);
+  assert_cmpint(known_hosts.lookup_host("hidden.example.com").length, CompareOperator.EQ, 0);
+
+  remove_known_hosts(path);
+}
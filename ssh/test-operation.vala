@@ -0,0 +1,201 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+void main(string[] args) {
+  Test.init(ref args);
+
+  Test.add_func("/ssh/operation/upload-target-parse", test_upload_target_parse);
+  Test.add_func("/ssh/operation/upload-command", test_upload_command);
+  Test.add_func("/ssh/operation/generate-command", test_generate_command);
+  Test.add_func("/ssh/operation/batch-schedule", test_batch_schedule);
+  Test.add_func("/ssh/operation/batch-cancel", test_batch_cancel);
+
+  Test.run();
+}
+
+// Doesn't spawn anything: each job just waits a bit, and every third fails
+private class FakeBatchOperation : Seahorse.Ssh.BatchOperation {
+  public uint n_running = 0;
+  public uint max_running = 0;
+  public uint[] started = {};
+  public uint[] failed = {};
+  public Cancellable? cancel_after_first = null;
+
+  public async void run_all(uint n_jobs, Cancellable? cancellable) {
+    yield run_jobs(n_jobs, cancellable);
+  }
+
+  protected override async void run_job(uint index, Cancellable? cancellable) throws GLib.Error {
+    this.started += index;
+    this.max_running = uint.max(this.max_running, ++this.n_running);
+
+    Timeout.add(5 + (index % 4), run_job.callback);
+    yield;
+
+    this.n_running--;
+    if (this.cancel_after_first != null)
+      this.cancel_after_first.cancel();
+    if (index % 3 == 0)
+      throw new Seahorse.Ssh.Error.GENERAL("Job %u failed", index);
+  }
+
+  protected override void job_done(uint index, GLib.Error? error) {
+    if (error != null)
+      this.failed += index;
+  }
+}
+
+private void run_fake_batch(FakeBatchOperation op, uint n_jobs, Cancellable? cancellable) {
+  var mainloop = new GLib.MainLoop();
+  op.run_all.begin(n_jobs, cancellable, (obj, res) => {
+      op.run_all.end(res);
+      mainloop.quit();
+  });
+  mainloop.run();
+}
+
+private void test_upload_target_parse() {
+  var target = new Seahorse.Ssh.UploadTarget.parse("user", "server.example.com");
+  assert_cmpstr(target.username, CompareOperator.EQ, "user");
+  assert_cmpstr(target.hostname, CompareOperator.EQ, "server.example.com");
+  assert_null(target.port);
+  assert_cmpstr(target.to_string(), CompareOperator.EQ, "user@server.example.com");
+
+  target = new Seahorse.Ssh.UploadTarget.parse("user", "server.example.com:2222");
+  assert_cmpstr(target.hostname, CompareOperator.EQ, "server.example.com");
+  assert_cmpstr(target.port, CompareOperator.EQ, "2222");
+  assert_cmpstr(target.to_string(), CompareOperator.EQ, "user@server.example.com:2222");
+
+  // An IPv6 address only has a port between brackets
+  target = new Seahorse.Ssh.UploadTarget.parse("user", "2001:db8::1");
+  assert_cmpstr(target.hostname, CompareOperator.EQ, "2001:db8::1");
+  assert_null(target.port);
+
+  target = new Seahorse.Ssh.UploadTarget.parse("user", "[2001:db8::1]:2222");
+  assert_cmpstr(target.hostname, CompareOperator.EQ, "2001:db8::1");
+  assert_cmpstr(target.port, CompareOperator.EQ, "2222");
+  assert_cmpstr(target.to_string(), CompareOperator.EQ, "user@[2001:db8::1]:2222");
+
+  target = new Seahorse.Ssh.UploadTarget.parse("user", "[2001:db8::1]");
+  assert_cmpstr(target.hostname, CompareOperator.EQ, "2001:db8::1");
+  assert_null(target.port);
+}
+
+private string[] parse_command(string cmd) {
+  try {
+    string[] argv;
+    Shell.parse_argv(cmd, out argv);
+    return argv;
+  } catch (GLib.Error err) {
+    error("Couldn't parse command '%s': %s", cmd, err.message);
+  }
+}
+
+private bool has_option(string[] argv, string option) {
+  for (int i = 0; i + 1 < argv.length; i++) {
+    if (argv[i] == "-o" && argv[i + 1] == option)
+      return true;
+  }
+  return false;
+}
+
+private void test_upload_command() {
+  var argv = parse_command(Seahorse.Ssh.UploadOperation.build_command("user", "server.example.com", null));
+  assert_cmpstr(argv[1], CompareOperator.EQ, "user@server.example.com");
+  assert_false("-p" in argv);
+  assert_true(has_option(argv, "StrictHostKeyChecking=no"));
+  assert_cmpstr(argv[argv.length - 1], CompareOperator.EQ,
+                "umask 077; test -d .ssh || mkdir .ssh ; cat >> .ssh/authorized_keys");
+
+  // Nothing the user typed can end up as a separate argument
+  argv = parse_command(Seahorse.Ssh.UploadOperation.build_command("it's me", "server.example.com", "22 -v"));
+  assert_cmpstr(argv[1], CompareOperator.EQ, "it's me@server.example.com");
+  assert_cmpstr(argv[2], CompareOperator.EQ, "-p");
+  assert_cmpstr(argv[3], CompareOperator.EQ, "22 -v");
+
+  // The control socket directory can have spaces and quotes in it
+  var dir = "/run/user/1000/it's a dir";
+  var options = Seahorse.Ssh.FleetUploadOperation.build_control_options(dir);
+  argv = parse_command(Seahorse.Ssh.UploadOperation.build_command("user", "server.example.com", "2222", options));
+  assert_true(has_option(argv, "ControlMaster=auto"));
+  assert_true(has_option(argv, "ControlPath=" + dir + "/%C"));
+  assert_true(has_option(argv, "ControlPersist=60"));
+  assert_cmpstr(argv[3], CompareOperator.EQ, "2222");
+}
+
+private void test_generate_command() {
+  // The passphrase is asked for through askpass, never on the command line
+  var argv = parse_command(Seahorse.Ssh.GenerateOperation.build_command("/tmp/id_ed25519", "it's me",
+                                                                         Seahorse.Ssh.Algorithm.ED25519, 0));
+  assert_false("-N" in argv);
+  assert_false("-b" in argv);
+  assert_true("it's me" in argv);
+
+  argv = parse_command(Seahorse.Ssh.GenerateOperation.build_command("/tmp/id_rsa", "deploy",
+                                                                     Seahorse.Ssh.Algorithm.RSA, 4096, true));
+  int i = 0;
+  while (i < argv.length && argv[i] != "-N")
+    i++;
+  assert_cmpint(i + 1, CompareOperator.LT, argv.length);
+  assert_cmpstr(argv[i + 1], CompareOperator.EQ, "");
+  assert_true("4096" in argv);
+}
+
+private void test_batch_schedule() {
+  var op = new FakeBatchOperation();
+  op.max_concurrent = 3;
+  run_fake_batch(op, 10, null);
+
+  // Every job ran once, in order, and never more than 3 at the same time
+  assert_cmpint(op.started.length, CompareOperator.EQ, 10);
+  for (uint i = 0; i < op.started.length; i++)
+    assert_cmpuint(op.started[i], CompareOperator.EQ, i);
+  assert_cmpuint(op.max_running, CompareOperator.EQ, 3);
+  assert_cmpuint(op.n_running, CompareOperator.EQ, 0);
+
+  // A failing job doesn't stop the others
+  assert_cmpuint(op.n_total, CompareOperator.EQ, 10);
+  assert_cmpuint(op.n_done, CompareOperator.EQ, 10);
+  assert_cmpuint(op.n_failed, CompareOperator.EQ, 4);
+  assert_cmpint(op.failed.length, CompareOperator.EQ, 4);
+
+  // Fewer jobs than workers, or none at all
+  op = new FakeBatchOperation();
+  op.max_concurrent = 8;
+  run_fake_batch(op, 2, null);
+  assert_cmpuint(op.max_running, CompareOperator.EQ, 2);
+  assert_cmpuint(op.n_done, CompareOperator.EQ, 2);
+
+  op = new FakeBatchOperation();
+  run_fake_batch(op, 0, null);
+  assert_cmpuint(op.n_done, CompareOperator.EQ, 0);
+}
+
+private void test_batch_cancel() {
+  var cancellable = new Cancellable();
+  var op = new FakeBatchOperation();
+  op.max_concurrent = 2;
+  op.cancel_after_first = cancellable;
+  run_fake_batch(op, 10, cancellable);
+
+  // The jobs that were running get to finish, but no new ones start
+  assert_cmpint(op.started.length, CompareOperator.EQ, 2);
+  assert_cmpuint(op.n_done, CompareOperator.EQ, 2);
+  assert_cmpuint(op.n_total, CompareOperator.EQ, 10);
+}
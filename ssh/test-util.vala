@@ -0,0 +1,43 @@
+/*
+ * Seahorse
+ *
+ * Copyright (C) 2026 Seahorse contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+// Helpers that are shared between the SSH tests
+
+// Builds a (fake, but well-formed) ed25519 public key, as it appears in
+// authorized_keys or known_hosts. Each seed gives a different key.
+internal string make_ed25519_key(uint seed) {
+  uint8[] type_length = { 0, 0, 0, 11 };
+  uint8[] key_length = { 0, 0, 0, 32 };
+  var key = new uint8[32];
+  for (uint i = 0; i < key.length; i++)
+    key[i] = (uint8) ((seed >> (8 * (i % 4))) + i);
+
+  var blob = new ByteArray();
+  blob.append(type_length);
+  blob.append("ssh-ed25519".data);
+  blob.append(key_length);
+  blob.append(key);
+
+  return "ssh-ed25519 %s".printf(Base64.encode(blob.data));
+}
+
+// Builds a public key line with the given comment
+internal string make_key_line(uint seed, string comment) {
+  return "%s %s".printf(make_ed25519_key(seed), comment);
+}
@@ -58,21 +58,23 @@ public class Seahorse.Ssh.UploadRemoteDialog : Adw.Dialog {
 
     private void action_submit(string action_name, Variant? param) {
         string user = this.user_row.text.strip();
-        string host_port = this.host_row.text.strip();
+        string hosts = this.host_row.text.strip();
 
-        if (!user.validate() || host_port == "" || !host_port.validate())
+        if (!user.validate() || hosts == "" || !hosts.validate())
             return;
 
-        // Port is anything past a colon
-        string[] host_port_split = host_port.split(":", 2);
-        string host = host_port_split[0];
-        string? port = (host_port_split.length == 2)? host_port_split[1] : null;
+        // Several hosts can be given at once, each with an optional port
+        UploadTarget[] targets = {};
+        foreach (unowned var host_port in hosts.split_set(", \t")) {
+            if (host_port != "")
+                targets += new UploadTarget.parse(user, host_port);
+        }
 
         this.cancellable = new Cancellable();
 
         // Start the upload process
-        UploadOperation op = new UploadOperation();
-        op.upload_async.begin(keys, user, host, port, this.cancellable, (obj, res) => {
+        var op = new FleetUploadOperation();
+        op.upload_async.begin(keys, targets, this.cancellable, (obj, res) => {
             close();
             try {
                 op.upload_async.end(res);
@@ -97,13 +99,14 @@ public class Seahorse.Ssh.UploadRemoteDialog : Adw.Dialog {
         if (!user.validate() || !host.validate())
             return;
 
-        // Take off port if necessary
-        int port_pos = host.index_of_char(':');
-        if (port_pos > 0) {
-            host = host.substring(0, port_pos);
+        // Take off the separators and ports
+        bool has_host = false;
+        foreach (unowned var host_port in host.split_set(", \t")) {
+            if (host_port.split(":", 2)[0] != "")
+                has_host = true;
         }
 
-        action_set_enabled("submit", (host.strip() != "") && (user.strip() != ""));
+        action_set_enabled("submit", has_host && (user.strip() != ""));
     }
 
     [GtkCallback]